@@ -7,6 +7,8 @@
 #include "../Typedefs.h"
 
 class CodeGenerator;
+class AstSimplifier;
+class AstTypeChecker;
 namespace llvm {
     class Value;
     class Type;
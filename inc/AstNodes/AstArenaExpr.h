@@ -0,0 +1,21 @@
+#ifndef _AST_ARENA_EXPR_H
+#define _AST_ARENA_EXPR_H
+
+#include "IAstExpression.h"
+#include <vector>
+
+// 'arena { ... }' allocates everything 'new'd within the block from a region which is freed all at
+// once when the block is left, including by a 'return'. Nothing allocated in it may be used afterwards.
+class AstArenaExpr : public IAstExpression {
+    std::vector<IAstExpression*> Body;
+public:
+    AstArenaExpr(const std::vector<IAstExpression*> &body, int line, int column);
+    ~AstArenaExpr();
+    virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    const std::vector<IAstExpression*> &getBody() const;
+    // Emits the destruction of an arena.
+    static llvm::Value *CodegenDestroy(CodeGenerator *codegen, llvm::Value *arena);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _AST_ATOMIC_EXPR_H
+#define _AST_ATOMIC_EXPR_H
+
+#include "IAstExpression.h"
+#include <vector>
+#include <string>
+
+// A call to one of the atomic builtins, whose first argument is the variable or array element operated on
+// and whose optional last argument is the memory ordering, one of 'relaxed', 'acquire', 'release', 
+// 'acq_rel' or 'seq_cst' (the default):
+//     atomic_load(x), atomic_store(x, v), atomic_exchange(x, v), atomic_cas(x, expected, desired),
+//     atomic_add(x, v), atomic_sub(x, v), atomic_and(x, v), atomic_or(x, v), atomic_xor(x, v), atomic_fence()
+// The read-modify-write builtins evaluate to the previous value and 'atomic_cas' to whether it succeeded.
+class AstAtomicExpr : public IAstExpression {
+    std::string Name;
+    std::vector<IAstExpression*> Args;
+public:
+    AstAtomicExpr(const std::string &name, const std::vector<IAstExpression*> &args, int line, int column);
+    ~AstAtomicExpr();
+    virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    const std::string &getName() const;
+    const std::vector<IAstExpression*> &getArgs() const;
+    // Returns whether a call to 'name' is an atomic builtin.
+    static bool IsAtomicBuiltin(const std::string &name);
+};
+
+#endif
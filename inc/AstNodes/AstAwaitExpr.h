@@ -0,0 +1,18 @@
+#ifndef _AST_AWAIT_EXPR_H
+#define _AST_AWAIT_EXPR_H
+
+#include "IAstExpression.h"
+
+// 'await f' waits for the future created by a 'spawn' to finish, frees it and evaluates to the
+// spawned call's result. Each future must be awaited exactly once.
+class AstAwaitExpr : public IAstExpression {
+    IAstExpression *Future;
+public:
+    AstAwaitExpr(IAstExpression *future, int line, int column);
+    ~AstAwaitExpr();
+    virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    IAstExpression *getFuture() const;
+};
+
+#endif
@@ -4,17 +4,39 @@
 #include "IAstExpression.h"
 #include <string>
 
+class AstCallExpression;
+class ClassAst;
+
 class AstBinaryOperatorExpr : public IAstExpression {
     std::string OperatorString;
     TokenType Operator;
     IAstExpression *LHS, *RHS;
+    AstNodeType OperandType;
 public:
     AstBinaryOperatorExpr(const std::string &operStr, TokenType oper, IAstExpression *lhs,
         IAstExpression *rhs, int line, int column);
     ~AstBinaryOperatorExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
     virtual llvm::Value *VariableAssignment(CodeGenerator *codegen);
     virtual llvm::Value *VariableOpAssignment(CodeGenerator *codegen);
+    virtual llvm::Value *AtomicOpAssignment(CodeGenerator *codegen, TokenType operation, const std::string &operStr);
+    virtual llvm::Value *MemberAccess(CodeGenerator *codegen);
+    // Returns the address of the field a '.' operator refers to. A string's only member is its 'length', which isn't
+    // addressable: when reading it, 'string' is passed and set to the address of the string, which is returned.
+    llvm::Value *MemberAddress(CodeGenerator *codegen, llvm::Value **string = nullptr);
+    // Returns the address of the instance on the left of a '.' operator given its address if it has one, and sets 'classAst',
+    // to nullptr when the instance is a string.
+    llvm::Value *InstanceAddress(CodeGenerator *codegen, llvm::Value *instance, ClassAst **classAst);
+    // Calls a method on the instance on the left of a '.' operator.
+    llvm::Value *MethodCall(CodeGenerator *codegen, AstCallExpression *call);
+    TokenType getOperator() const;
+    IAstExpression *getLHS() const;
+    IAstExpression *getRHS() const;
+    // The type both operands are converted to, set by the AstTypeChecker. Left as node_default the code generator
+    // works it out from the operands' values.
+    AstNodeType getOperandType() const;
+    void setOperandType(AstNodeType type);
 };
 
 #endif
@@ -2,17 +2,44 @@
 #define _AST_CALL_EXPR_H
 
 #include "IAstExpression.h"
+#include "../Lexer/NameTable.h"
 #include <vector>
 #include <string>
 
+class GenericFunctionAst;
+struct FunctionOverload;
+
 class AstCallExpression : public IAstExpression {
-    std::string Name;
+    NameTable::NameId Name;
     std::vector<IAstExpression*> Args;
 public:
-    AstCallExpression(const std::string &name, const std::vector<IAstExpression*> &args, int line, int column);
+    AstCallExpression(NameTable::NameId name, const std::vector<IAstExpression*> &args, int line, int column);
     ~AstCallExpression();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
     const std::string &getName() const;
+    NameTable::NameId getNameId() const;
+    unsigned getArgCount() const;
+    const std::vector<IAstExpression*> &getArgs() const;
+    // Looks up the function being called and checks the argument count, returns nullptr on failure.
+    llvm::Function *GetCallee(CodeGenerator *codegen);
+    // Emits the arguments cast to the callee's parameter types, returns false on failure. Values already in 'argsvals',
+    // e.g. a method's 'this', are matched against the first parameters.
+    bool CodegenArguments(CodeGenerator *codegen, llvm::Function *callee, std::vector<llvm::Value*> &argsvals);
+    // Casts the value of argument 'arg' to the type of parameter 'param', returns nullptr on failure.
+    llvm::Value *CastArgument(CodeGenerator *codegen, llvm::Function *callee, unsigned param, llvm::Value *val, IAstExpression *arg);
+    // Emits the arguments as they are, for calls whose callee depends on their types. Returns false on failure.
+    bool CodegenArgumentValues(CodeGenerator *codegen, std::vector<llvm::Value*> &vals);
+    // Calls 'callee' with values from CodegenArgumentValues cast to its parameter types.
+    llvm::Value *CodegenCall(CodeGenerator *codegen, llvm::Function *callee, const std::vector<llvm::Value*> &vals);
+    // Calls the instantiation of a generic function for the types of the arguments.
+    llvm::Value *CodegenGenericCall(CodeGenerator *codegen, GenericFunctionAst *generic);
+    // Calls the overload whose parameters match the arguments' types exactly, or else the one needing the fewest
+    // implicit number conversions.
+    llvm::Value *CodegenOverloadedCall(CodeGenerator *codegen, const std::vector<FunctionOverload> &overloads);
+    // Returns the value of a call: a string result is owned by the caller and a C string returned for a 'string' is
+    // copied into one, pointers are kept where the collector can see them.
+    llvm::Value *CodegenResult(CodeGenerator *codegen, llvm::Function *callee, llvm::Value *result);
 };
 
 #endif
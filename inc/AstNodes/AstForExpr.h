@@ -3,16 +3,35 @@
 
 #include "IAstExpression.h"
 #include <vector>
+#include <string>
+
+// A 'reduce(<op>: <name>)' clause attached to a loop. The named variable is given a private
+// accumulator for the duration of the loop which is combined back into it when the loop exits.
+struct AstReductionClause {
+    PossiblePosition Pos;
+    TokenType Operator;         // '+', '*', '&', '|', '^', or '<' for 'min' and '>' for 'max'
+    std::string OperatorString;
+    std::string VariableName;
+    AstNodeType VariableType;   // set by the type checker, node_default if it couldn't tell.
+};
 
 class AstForExpr : public IAstExpression {
     IAstExpression *Condition;
     std::vector<IAstExpression*> Init, Afterthought, Body;
+    std::vector<AstReductionClause> Reductions;
 public:
     AstForExpr(const std::vector<IAstExpression*> &init, IAstExpression *condition,
         const std::vector<IAstExpression*> &afterThought, const std::vector<IAstExpression*> &body,
-        int line, int column);
+        const std::vector<AstReductionClause> &reductions, int line, int column);
     ~AstForExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    const std::vector<IAstExpression*> &getInit() const;
+    IAstExpression *getCondition() const;
+    const std::vector<IAstExpression*> &getAfterthought() const;
+    const std::vector<IAstExpression*> &getBody() const;
+    const std::vector<AstReductionClause> &getReductions() const;
+    void setReductionType(unsigned index, AstNodeType type);
 };
 
 #endif
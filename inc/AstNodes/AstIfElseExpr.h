@@ -12,6 +12,10 @@ public:
         const std::vector<IAstExpression*> &elseBody, int line, int column);
     ~AstIfElseExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    IAstExpression *getCondition() const;
+    const std::vector<IAstExpression*> &getIfBody() const;
+    const std::vector<IAstExpression*> &getElseBody() const;
 };
 
 #endif
@@ -7,10 +7,14 @@ class AstIntegerNode : public IAstExpression {
     // The reason this is unsigned is because rather than trying to parse a negative number
     // we will rely on the negate, '-', operator to create negative numbers.
     demi_int Val;
+    unsigned BitWidth;
 public:
     AstIntegerNode(demi_int value, int line, int column);
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
     demi_int getValue() const;
+    // Literals are 32 bit, an evaluated constant has the width of the expression it replaces.
+    unsigned getBitWidth() const;
+    void setBitWidth(unsigned bitWidth);
 };
 
 #endif
@@ -15,6 +15,10 @@ typedef enum tag_AstNodeType {
     node_ifelse,
     node_while,
     node_for,
+    node_spawn,
+    node_await,
+    node_atomic,
+    node_arena,
     node_boolean,
     node_double,
     node_float,
@@ -9,6 +9,10 @@ public:
     AstReturnExpr(IAstExpression *expr, int line, int column);
     ~AstReturnExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    IAstExpression *getExpr() const;
+private:
+    void CodegenLeaveArenas(CodeGenerator *codegen);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#ifndef _AST_SPAWN_EXPR_H
+#define _AST_SPAWN_EXPR_H
+
+#include "IAstExpression.h"
+
+class AstCallExpression;
+
+// 'spawn f(x)' hands the call to the task scheduler and evaluates to a future, a pointer to a
+// 'future.f' frame holding the result followed by the arguments, which 'await' joins.
+class AstSpawnExpr : public IAstExpression {
+    AstCallExpression *Call;
+public:
+    AstSpawnExpr(AstCallExpression *call, int line, int column);
+    ~AstSpawnExpr();
+    virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    AstCallExpression *getCall() const;
+};
+
+#endif
@@ -9,6 +9,8 @@ class AstTypeNode {
     PossiblePosition Pos;
     AstNodeType TypeType;
     bool IsArray = false;
+    bool IsAtomic = false;
+    bool IsSoa = false;
     demi_int ArraySize = 0;
     IAstExpression *Subscript;
     std::string TypeName;
@@ -17,12 +19,20 @@ public:
     AstTypeNode(AstNodeType type, const std::string &typeName, bool isArray, IAstExpression *subscript, int line, int column);
     AstTypeNode(AstNodeType type, const std::string &typeName, bool isArray, demi_int arraySize, int line, int column);
     llvm::Type *GetLLVMType(CodeGenerator *codegen);
+    // Simplifies the subscript, an array whose size folds to a positive integer becomes a static array.
+    void Simplify(AstSimplifier *simplifier);
     PossiblePosition getPos() const;
     AstNodeType getTypeType() const;
     bool getIsArray() const;
     IAstExpression *getArraySubscript() const;
     demi_int getArraySize() const;
     std::string getTypeName() const;
+    // Atomic types are only read and written with atomic instructions, for arrays this applies to the elements.
+    bool getIsAtomic() const;
+    void setIsAtomic(bool isAtomic);
+    // Struct-of-arrays, an array of a class laid out as one array per field.
+    bool getIsSoa() const;
+    void setIsSoa(bool isSoa);
 private:
     void init(AstNodeType type, const std::string &typeName, bool isArray, demi_int arraySize, IAstExpression *subscript, int line, int column);
 };
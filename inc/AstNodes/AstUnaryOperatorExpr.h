@@ -17,6 +17,7 @@ public:
     AstUnaryOperatorExpr(const std::string &operStr, TokenType oper, AstTypeNode *operand, bool isPostfix, int line, int column);
     ~AstUnaryOperatorExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
     virtual llvm::Value *ArrayAssignment(CodeGenerator *codegen, IAstExpression *rhs);
     virtual llvm::Value *newMalloc(CodeGenerator *codegen);
     virtual llvm::Value *positive(CodeGenerator *codegen);
@@ -26,8 +27,16 @@ public:
     virtual llvm::Value *increment(CodeGenerator *codegen);
     virtual llvm::Value *decrement(CodeGenerator *codegen);
     virtual llvm::Value *accessElement(CodeGenerator *codegen);
+    // Returns the address of the element an index operator refers to.
+    // For a struct-of-arrays operand 'field' picks the array to index and 'usedField' is set.
+    llvm::Value *ElementAddress(CodeGenerator *codegen, const std::string &field = "", bool *usedField = nullptr);
 
     TokenType getOperator() const;
+    IAstExpression *getOperand() const;
+    // The index of an element access.
+    IAstExpression *getIndex() const;
+    // The type allocated by 'new'.
+    AstTypeNode *getTypeNode() const;
     bool getIsPostfix() const;
     bool getIsPrefix() const;
 
@@ -3,18 +3,21 @@
 
 #include "IAstExpression.h"
 #include "AstTypeNode.h"
+#include "../Lexer/NameTable.h"
 #include <string>
 
 class AstVarExpr : public IAstExpression {
-    std::string Name;
+    NameTable::NameId Name;
     AstTypeNode *InferredType;
     IAstExpression *AssignmentExpression;
 public:
-    AstVarExpr(const std::string &name, IAstExpression *assignmentExpression, AstTypeNode *inferredType,
+    AstVarExpr(NameTable::NameId name, IAstExpression *assignmentExpression, AstTypeNode *inferredType,
         int line, int column);
     ~AstVarExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
     const std::string &getName() const;
+    NameTable::NameId getNameId() const;
     AstTypeNode *getInferredType() const;
     IAstExpression *getAssignmentExpression() const;
 };
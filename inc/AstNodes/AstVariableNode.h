@@ -2,14 +2,17 @@
 #define _AST_VARIABLE_NODE_H
 
 #include "IAstExpression.h"
+#include "../Lexer/NameTable.h"
 #include <string>
 
 class AstVariableNode : public IAstExpression {
-    std::string Name;
+    NameTable::NameId Name;
 public:
-    AstVariableNode(const std::string &name, int line, int column);
+    AstVariableNode(NameTable::NameId name, int line, int column);
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
     const std::string &getName() const;
+    NameTable::NameId getNameId() const;
 };
 
 #endif
\ No newline at end of file
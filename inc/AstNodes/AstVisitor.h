@@ -0,0 +1,118 @@
+#ifndef _AST_VISITOR_H
+#define _AST_VISITOR_H
+
+#include "IAstExpression.h"
+#include "AstArenaExpr.h"
+#include "AstAtomicExpr.h"
+#include "AstAwaitExpr.h"
+#include "AstBinaryOperatorExpr.h"
+#include "AstBooleanNode.h"
+#include "AstCallExpr.h"
+#include "AstDoubleNode.h"
+#include "AstForExpr.h"
+#include "AstIfElseExpr.h"
+#include "AstIntegerNode.h"
+#include "AstReturnExpr.h"
+#include "AstSpawnExpr.h"
+#include "AstStringNode.h"
+#include "AstUnaryOperatorExpr.h"
+#include "AstVarExpr.h"
+#include "AstVariableNode.h"
+#include "AstWhileExpr.h"
+
+/*
+ *  Which node types each expression class is tagged with, every node type belongs to at most one class.
+ */
+template <typename T> struct AstNodeKind;
+template <> struct AstNodeKind<AstArenaExpr> { static bool Is(AstNodeType type) { return type == node_arena; } };
+template <> struct AstNodeKind<AstAtomicExpr> { static bool Is(AstNodeType type) { return type == node_atomic; } };
+template <> struct AstNodeKind<AstAwaitExpr> { static bool Is(AstNodeType type) { return type == node_await; } };
+template <> struct AstNodeKind<AstBinaryOperatorExpr> { static bool Is(AstNodeType type) { return type == node_binary_operation; } };
+template <> struct AstNodeKind<AstBooleanNode> { static bool Is(AstNodeType type) { return type == node_boolean; } };
+template <> struct AstNodeKind<AstCallExpression> { static bool Is(AstNodeType type) { return type == node_call; } };
+template <> struct AstNodeKind<AstDoubleNode> { static bool Is(AstNodeType type) { return type == node_double || type == node_float; } };
+template <> struct AstNodeKind<AstForExpr> { static bool Is(AstNodeType type) { return type == node_for; } };
+template <> struct AstNodeKind<AstIfElseExpr> { static bool Is(AstNodeType type) { return type == node_ifelse; } };
+template <> struct AstNodeKind<AstIntegerNode> {
+    static bool Is(AstNodeType type) { return type >= node_signed_integer8 && type <= node_unsigned_integer64; }
+};
+template <> struct AstNodeKind<AstReturnExpr> { static bool Is(AstNodeType type) { return type == node_return; } };
+template <> struct AstNodeKind<AstSpawnExpr> { static bool Is(AstNodeType type) { return type == node_spawn; } };
+template <> struct AstNodeKind<AstStringNode> { static bool Is(AstNodeType type) { return type == node_string; } };
+template <> struct AstNodeKind<AstUnaryOperatorExpr> {
+    static bool Is(AstNodeType type) { return type == node_unary_operation_pre || type == node_unary_operation_post; }
+};
+template <> struct AstNodeKind<AstVarExpr> { static bool Is(AstNodeType type) { return type == node_var; } };
+template <> struct AstNodeKind<AstVariableNode> { static bool Is(AstNodeType type) { return type == node_variable; } };
+template <> struct AstNodeKind<AstWhileExpr> { static bool Is(AstNodeType type) { return type == node_while; } };
+
+// Returns the expression as a T if it's tagged as one, or else nullptr. Stands in for dynamic_cast: a compare of
+// the node type instead of a walk of the class hierarchy.
+template <typename T>
+T *AstCast(IAstExpression *expr) {
+    return expr != nullptr && AstNodeKind<T>::Is(expr->getNodeType()) ? static_cast<T*>(expr) : nullptr;
+}
+
+/*
+ *  Dispatches an expression to the Visit method for its class with a switch on its node type. A pass derives from
+ *  AstVisitor<Pass, Result> and defines the Visit methods for the nodes it handles, hiding the ones here: nothing
+ *  is virtual, so the calls are resolved at compile time. The nodes it doesn't handle go to VisitExpression, which
+ *  returns Result() unless the pass defines it too.
+ */
+template <typename Derived, typename Result>
+class AstVisitor {
+    Derived *derived() { return static_cast<Derived*>(this); }
+public:
+    Result Visit(IAstExpression *expr) {
+        switch (expr->getNodeType()) {
+        default: return derived()->VisitExpression(expr);
+        case node_arena: return derived()->VisitArena(static_cast<AstArenaExpr*>(expr));
+        case node_atomic: return derived()->VisitAtomic(static_cast<AstAtomicExpr*>(expr));
+        case node_await: return derived()->VisitAwait(static_cast<AstAwaitExpr*>(expr));
+        case node_binary_operation: return derived()->VisitBinaryOperator(static_cast<AstBinaryOperatorExpr*>(expr));
+        case node_boolean: return derived()->VisitBoolean(static_cast<AstBooleanNode*>(expr));
+        case node_call: return derived()->VisitCall(static_cast<AstCallExpression*>(expr));
+        case node_float:
+        case node_double: return derived()->VisitDouble(static_cast<AstDoubleNode*>(expr));
+        case node_for: return derived()->VisitFor(static_cast<AstForExpr*>(expr));
+        case node_ifelse: return derived()->VisitIfElse(static_cast<AstIfElseExpr*>(expr));
+        case node_signed_integer8:
+        case node_signed_integer16:
+        case node_signed_integer32:
+        case node_signed_integer64:
+        case node_unsigned_integer8:
+        case node_unsigned_integer16:
+        case node_unsigned_integer32:
+        case node_unsigned_integer64: return derived()->VisitInteger(static_cast<AstIntegerNode*>(expr));
+        case node_return: return derived()->VisitReturn(static_cast<AstReturnExpr*>(expr));
+        case node_spawn: return derived()->VisitSpawn(static_cast<AstSpawnExpr*>(expr));
+        case node_string: return derived()->VisitString(static_cast<AstStringNode*>(expr));
+        case node_unary_operation_pre:
+        case node_unary_operation_post: return derived()->VisitUnaryOperator(static_cast<AstUnaryOperatorExpr*>(expr));
+        case node_var: return derived()->VisitVar(static_cast<AstVarExpr*>(expr));
+        case node_variable: return derived()->VisitVariable(static_cast<AstVariableNode*>(expr));
+        case node_while: return derived()->VisitWhile(static_cast<AstWhileExpr*>(expr));
+        }
+    }
+
+    Result VisitExpression(IAstExpression *expr) { return Result(); }
+    Result VisitArena(AstArenaExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitAtomic(AstAtomicExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitAwait(AstAwaitExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitBinaryOperator(AstBinaryOperatorExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitBoolean(AstBooleanNode *expr) { return derived()->VisitExpression(expr); }
+    Result VisitCall(AstCallExpression *expr) { return derived()->VisitExpression(expr); }
+    Result VisitDouble(AstDoubleNode *expr) { return derived()->VisitExpression(expr); }
+    Result VisitFor(AstForExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitIfElse(AstIfElseExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitInteger(AstIntegerNode *expr) { return derived()->VisitExpression(expr); }
+    Result VisitReturn(AstReturnExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitSpawn(AstSpawnExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitString(AstStringNode *expr) { return derived()->VisitExpression(expr); }
+    Result VisitUnaryOperator(AstUnaryOperatorExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitVar(AstVarExpr *expr) { return derived()->VisitExpression(expr); }
+    Result VisitVariable(AstVariableNode *expr) { return derived()->VisitExpression(expr); }
+    Result VisitWhile(AstWhileExpr *expr) { return derived()->VisitExpression(expr); }
+};
+
+#endif
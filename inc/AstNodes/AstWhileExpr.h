@@ -12,6 +12,9 @@ public:
         int line, int column);
     ~AstWhileExpr();
     virtual llvm::Value *Codegen(CodeGenerator *codegen);
+    virtual IAstExpression *Simplify(AstSimplifier *simplifier);
+    IAstExpression *getCondition() const;
+    const std::vector<IAstExpression*> &getBody() const;
 };
 
 #endif
\ No newline at end of file
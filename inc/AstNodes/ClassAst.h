@@ -5,16 +5,33 @@
 //#include "FunctionAst.h"
 //#include "AstVarExpr.h"
 #include <vector>
+#include <map>
+#include <set>
 #include <string>
 
 class FunctionAst;
 class AstVarExpr;
+namespace llvm {
+    class Function;
+    class StructType;
+    class Type;
+}
 
 class ClassAst {
+    PossiblePosition Pos;
     FunctionAst *Constructor;
     std::vector<AstVarExpr*> PublicFields, PrivateFields;
+    std::vector<AstVarExpr*> Fields; // public and private fields in declaration order.
     std::vector<FunctionAst*> PublicFunctions, PrivateFunctions;
+    std::set<FunctionAst*> VirtualFunctions; // called directly as well until classes can be derived from.
     std::string Name;
+    bool IsPacked, IsOrdered;
+    
+    llvm::StructType *StructTy;
+    std::map<std::string, unsigned> FieldIndices;
+    std::map<demi_int, llvm::StructType*> SoaTypes; // by array size.
+    bool IsLayingOut;
+    std::map<std::string, llvm::Function*> Methods;
 
 public:
     ClassAst();
@@ -22,17 +39,55 @@ public:
         const std::vector<FunctionAst*> &publicFunctions, const std::vector<FunctionAst*> &privateFunctions);
     ~ClassAst();
 
+    // Creates the class's struct type without a body so that it can be referred to before it's laid out.
+    llvm::StructType *Declare(CodeGenerator *codegen);
+    // Lays out the fields of the class and returns the struct type.
+    llvm::StructType *Codegen(CodeGenerator *codegen);
+    // Returns the struct-of-arrays type for an array of 'size' instances: one array per field, in the same order
+    // as the fields of the class so that field indices are shared.
+    llvm::StructType *GetSoaType(CodeGenerator *codegen, demi_int size);
+    // Returns whether the type is one of the class's struct-of-arrays types.
+    bool IsSoaType(llvm::Type *type) const;
+    // Stores the fields' initial values, for those declared with one, into a newly declared instance.
+    bool CodegenFieldInitializers(CodeGenerator *codegen, llvm::Value *instance);
+    // Declares the methods as functions named 'Class.method' taking 'this' first.
+    bool DeclareMethods(CodeGenerator *codegen);
+    // Generates the bodies of the methods.
+    bool CodegenMethods(CodeGenerator *codegen);
+    // Simplifies the fields' initial values and the methods.
+    void Simplify(AstSimplifier *simplifier);
+    // Checks the types in the constructor and the methods, returns false after reporting type errors.
+    bool Check(AstTypeChecker *checker);
+
+    void setPos(PossiblePosition pos);
+    PossiblePosition getPos() const;
+
     void setName(const std::string &name);
     std::string getName() const;
 
+    // Packed classes keep their declared field order and have no padding between fields.
+    void setIsPacked(bool isPacked);
+    bool getIsPacked() const;
+    // Ordered classes keep their declared field order, otherwise fields are reordered to minimize padding.
+    void setIsOrdered(bool isOrdered);
+    bool getIsOrdered() const;
+
+    llvm::StructType *getStructType() const;
+    // Returns the index of a field in the struct type, or -1 if there is no such field.
+    int getFieldIndex(const std::string &name) const;
+    // Returns the function a method was declared as, or nullptr if there is no such method.
+    llvm::Function *getMethod(const std::string &name) const;
+    // Returns whether a field or method is private, these can only be used from the class's own methods.
+    bool getIsPrivate(const std::string &name) const;
+
     bool setConstructor(FunctionAst *ctor);
 
     bool pushPublicField(AstVarExpr *publicField);
     bool pushPrivateField(AstVarExpr *privateField);
 
-    bool pushPublicFunction(FunctionAst *publicFunction);
-    bool pushPrivateFunction(FunctionAst *privateFunction);
+    bool pushPublicFunction(FunctionAst *publicFunction, bool isVirtual = false);
+    bool pushPrivateFunction(FunctionAst *privateFunction, bool isVirtual = false);
 
 };
 
-#endif
\ No newline at end of file
+#endif
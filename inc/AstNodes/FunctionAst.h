@@ -9,12 +9,18 @@ class FunctionAst {
     PossiblePosition Pos;
     PrototypeAst *Prototype;
     std::vector<IAstExpression*> FunctionBody;
+    bool IsConst;
 public:
     FunctionAst(PrototypeAst *prototype, const std::vector<IAstExpression*> &functionBody, int line, int column);
-    ~FunctionAst();
+    virtual ~FunctionAst();
     virtual llvm::Function *Codegen(CodeGenerator *codegen);
+    void Simplify(AstSimplifier *simplifier);
     PossiblePosition getPos() const;
     PrototypeAst *getPrototype() const;
+    const std::vector<IAstExpression*> &getBody() const;
+    // A 'const' function is pure and evaluated at compile time when called on literals.
+    bool getIsConst() const;
+    void setIsConst(bool isConst);
 };
 
 #endif
\ No newline at end of file
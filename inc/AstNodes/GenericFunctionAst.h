@@ -0,0 +1,32 @@
+#ifndef _GENERIC_FUNCTION_AST_H
+#define _GENERIC_FUNCTION_AST_H
+
+#include "AST_DEPENDENCIES.h"
+#include "../Lexer/Token.h"
+#include <vector>
+#include <string>
+
+class FunctionAst;
+
+/*
+ *  A function with type parameters, e.g. 'func max<T>(a : T, b : T) : T'. It isn't generated itself: a call binds
+ *  the type parameters to the types of its arguments and gets the instantiation for them, a function of its own
+ *  named 'max<int64>', which is parsed from the definition's tokens with the type parameters replaced,
+ *  simplified and type checked like the file's functions were, declared, and generated along with the other
+ *  functions. Each set of types is instantiated once per module.
+ */
+class GenericFunctionAst {
+    FunctionAst *Definition; // parsed with the type parameters as class names.
+    std::vector<Token> Tokens;
+public:
+    GenericFunctionAst(FunctionAst *definition, const std::vector<Token> &tokens);
+    ~GenericFunctionAst();
+    // Returns the instantiation called with arguments of 'argTypes', nullptr after an error. 'argNodeTypes' are the
+    // types the type checker resolved for them, which tell unsigned integers apart, node_default where it couldn't.
+    llvm::Function *Instantiate(CodeGenerator *codegen, const std::vector<llvm::Type*> &argTypes,
+        const std::vector<AstNodeType> &argNodeTypes, PossiblePosition pos);
+    PossiblePosition getPos() const;
+    const std::string &getName() const;
+};
+
+#endif
@@ -6,13 +6,19 @@
 class IAstExpression {
     PossiblePosition Pos;
     AstNodeType NodeType;
+    AstNodeType ResolvedType;
 public:
-    IAstExpression() : NodeType(node_default){}
+    IAstExpression() : NodeType(node_default), ResolvedType(node_default){}
     virtual ~IAstExpression(){}
     virtual llvm::Value *Codegen(CodeGenerator *codegen) = 0;
+    // Simplifies the expression's operands and returns what replaces the expression, itself unless it was folded.
+    virtual IAstExpression *Simplify(AstSimplifier *) { return this; }
     void setNodeType(AstNodeType type) { NodeType = type; }
     void setPos(PossiblePosition pos) { Pos = pos; }
     AstNodeType getNodeType() const { return NodeType; }
+    // The type of the expression's value set by the AstTypeChecker, node_default if it couldn't be resolved.
+    void setResolvedType(AstNodeType type) { ResolvedType = type; }
+    AstNodeType getResolvedType() const { return ResolvedType; }
     PossiblePosition getPos() const { return Pos; }
 };
 
@@ -3,25 +3,40 @@
 
 #include "AstTypeNode.h"
 #include "IAstExpression.h"
+#include "../Lexer/NameTable.h"
 #include <vector>
 #include <string>
 
 class PrototypeAst {
     PossiblePosition Pos;
-    std::string Name;
+    NameTable::NameId Name;
     std::vector<std::pair<std::string, AstTypeNode*>> Args;
     AstTypeNode *ReturnType;
     bool IsVarArgs;
+    bool IsExtern;
+    std::vector<std::string> TypeParameters;
 public:
-    PrototypeAst(const std::string &name, AstTypeNode *returnType, const std::vector<std::pair<std::string, AstTypeNode*>> &args,
+    PrototypeAst(NameTable::NameId name, AstTypeNode *returnType, const std::vector<std::pair<std::string, AstTypeNode*>> &args,
         bool isVarArgs, int line, int column);
     ~PrototypeAst();
     virtual llvm::Function *Codegen(CodeGenerator *codegen);
     void CreateArgumentAllocas(CodeGenerator *codegen, llvm::Function *func);
+    // Turns the prototype into a method of a class: the name is qualified with the class name and 'this',
+    // a reference to the instance, becomes the first parameter.
+    void BindToClass(const std::string &className);
 
     PossiblePosition getPos() const;
     const std::string &getName() const;
     AstTypeNode *getReturnType() const;
+    const std::vector<std::pair<std::string, AstTypeNode*>> &getArgs() const;
+    // Marks the prototype as the declaration of a C function, which takes and returns C strings for strings.
+    // 'print' and 'println' are the runtime's and take the address of the string instead.
+    void setIsExtern(bool isExtern);
+    // Renames an overloaded function after its parameter types, e.g. 'abs(uint)', calls pick it by their arguments.
+    void Overload();
+    // The names of a generic function's type parameters, 'T' in 'func max<T>(a : T, b : T) : T'.
+    const std::vector<std::string> &getTypeParameters() const;
+    void setTypeParameters(const std::vector<std::string> &typeParameters);
 };
 
 #endif
\ No newline at end of file
@@ -3,17 +3,25 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <string>
 
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/IRBuilder.h"
 
+#include "AstNodes/AstNodeTypes.h"
+#include "CodeGenerator/SymbolTable.h"
+
 // TODO: Module and module component container.
 // TODO: vector of the a module component containers.
 
 struct TreeContainer;
+class AstSimplifier;
+class AstTypeChecker;
 class FunctionAst;
+class GenericFunctionAst;
+class ClassAst;
 /*
 namespace llvm {
     class ExecutionEngine;
@@ -21,6 +29,13 @@ namespace llvm {
 }
 */
 
+// A definition of an overloaded function, with the types its parameters are declared as, which tell unsigned
+// integers apart.
+struct FunctionOverload {
+    llvm::Function *Func;
+    std::vector<AstNodeType> ParamTypes;
+};
+
 class CodeGenerator {
 public:
     // Initializes the code generator.
@@ -70,52 +85,117 @@ public:
     // Clears the named values
     void clearNamedValues();
     
-    // Returns the AllocaInst at a given key
+    // Returns the innermost variable in scope with a given name, or nullptr.
     llvm::AllocaInst *getNamedValue(const std::string &key) const;
+    llvm::AllocaInst *getNamedValue(NameTable::NameId id) const;
     
-    // Pushes the key to the Scope Stack and sets the AllocaInst at a given key 
-    // if it does not exist yet, and returns a <itr, bool> pair
-    std::pair<std::map<std::string, llvm::AllocaInst*>::iterator, bool> setNamedValue(std::string key, llvm::AllocaInst *val);
-    // Erases an AllocaInst from the map.
-    void eraseNamedValue(const std::string &key);
+    // Declares a variable in the current scope, shadowing any outer one with the same name.
+    void setNamedValue(const std::string &key, llvm::AllocaInst *val);
+    void setNamedValue(NameTable::NameId id, llvm::AllocaInst *val);
+    // Rebinds an existing key to another AllocaInst without declaring anything
+    // and returns the AllocaInst previously bound to it.
+    llvm::AllocaInst *replaceNamedValue(const std::string &key, llvm::AllocaInst *val);
+    // Marks a variable as declared with an atomic type.
+    void setIsAtomic(llvm::AllocaInst *val);
+    // Returns whether a variable was declared with an atomic type.
+    bool getIsAtomic(llvm::Value *val) const;
+    // Marks a variable or temporary as holding references to strings, a string or an instance or array of them,
+    // released when the function returns.
+    void setOwnsString(llvm::AllocaInst *val);
+    // Returns the variables and temporaries of the current function holding references to strings.
+    const std::vector<llvm::AllocaInst*> &getOwnedStrings() const;
     
-    // Clears the Scope Stack for the local scope and removes them from the NamedValues set.
+    // Removes the last variables declared, restoring the ones they shadowed.
     void popFromScopeStack(unsigned howMany);
 
-    // Increment the variable count
-    void incrementVarCount();
     // Increment the nest/scope depth
     void incrementNestDepth();
     // Decrement the nest/scope depth
     void decrementNestDepth();
     // Returns the nest/scope depth
     unsigned getNestDepth() const;
-    // Returns the variable count.
+    // Returns the number of variables in scope, including parameters.
     unsigned getVarCount() const;
     // Returns the function currently being created.
     llvm::Function *getCurrentFunction() const;
     // Sets the currently being generated function.
     void setCurrentFunction(llvm::Function* func);
+    // Returns the class whose method is being created, or nullptr outside of methods.
+    ClassAst *getCurrentClass() const;
+    // Sets the class whose method is being created.
+    void setCurrentClass(ClassAst *classAst);
+    // Enters an 'arena' block, 'new' allocates from the innermost arena.
+    void pushArena(llvm::Value *arena);
+    // Leaves the innermost 'arena' block.
+    void popArena();
+    // Returns the arena 'new' allocates from, or nullptr to allocate from the heap.
+    llvm::Value *getArena() const;
+    // Returns the arenas of the enclosing 'arena' blocks, innermost last.
+    const std::vector<llvm::Value*> &getArenas() const;
     // Returns whether the codegenerator can dump on fail or not.
     bool getDumpOnFail() const;
+    // Returns the class with the given name, or nullptr if there is none.
+    ClassAst *getClass(const std::string &name) const;
+    // Returns the class a struct-of-arrays type was made for, or nullptr if the type isn't one.
+    ClassAst *getSoaClass(llvm::Type *type) const;
+    // Returns the generic function with the given name, or nullptr if there is none.
+    GenericFunctionAst *getGenericFunction(const std::string &name) const;
+    // Takes an instantiation of a generic function whose prototype is declared, its body is generated later.
+    void addInstantiation(FunctionAst *instance);
+    // Sets the passes the trees go through before code generation, instantiations go through them when they're made.
+    void setPasses(AstSimplifier *simplifier, AstTypeChecker *typeChecker);
+    AstSimplifier *getSimplifier() const;
+    AstTypeChecker *getTypeChecker() const;
+    // Returns the functions defined with the given name if it's overloaded, or nullptr.
+    const std::vector<FunctionOverload> *getOverloads(const std::string &name) const;
+    // Returns whether 'new' allocates from the garbage collected heap.
+    bool getUseGC() const;
+    // Sets whether 'new' allocates from the garbage collected heap.
+    void setUseGC(bool useGC);
+    // Returns the collector's description of where the pointers are in an element of a type, as an i8*.
+    llvm::Constant *getGCTypeInfo(llvm::Type *type);
+    // Returns the type 'string' is lowered to, laid out as the runtime's DemiString.
+    llvm::StructType *getStringType() const;
+    // Returns the chars of a string literal, every occurrence of the same literal in the module shares one constant.
+    llvm::Constant *getStringLiteral(const std::string &val);
+    // Marks an external function whose 'string' result is a C string.
+    void setReturnsCString(llvm::Function *func);
+    // Returns whether a function is external and returns a C string for a 'string'.
+    bool getReturnsCString(llvm::Function *func) const;
 private:
     llvm::LLVMContext &_context;
     llvm::IRBuilder<> _builder;
     llvm::Module *_theModule;
+    llvm::StructType *_stringType;
     llvm::legacy::FunctionPassManager *_theFPM;
     llvm::ExecutionEngine *_theExecutionEngine;
     llvm::BasicBlock *_outsideBlock;
     llvm::BasicBlock *_returnBlock;
-    std::map<std::string, llvm::AllocaInst*> _namedValues;
+    SymbolTable _namedValues;
+    std::set<llvm::Value*> _atomicValues;
+    std::vector<llvm::AllocaInst*> _ownedStrings;
+    std::set<llvm::Function*> _cStringFunctions;
+    std::map<std::string, llvm::Constant*> _stringLiterals;
+    std::map<std::string, ClassAst*> _classes;
+    std::map<std::string, GenericFunctionAst*> _genericFunctions;
+    std::map<std::string, std::vector<FunctionOverload>> _overloads;
+    std::vector<FunctionAst*> _instantiations;          // owned, the ones from '_generatedInstantiations' on are pending.
+    unsigned _generatedInstantiations;
+    AstSimplifier *_simplifier;
+    AstTypeChecker *_typeChecker;
+    std::vector<llvm::Value*> _arenas;
+    std::map<llvm::Type*, llvm::Constant*> _gcTypeInfos;
     
-    std::vector<std::string> _scopeStack;
     llvm::Function *_currentFunction;
-    unsigned _varCount;
+    ClassAst *_currentClass;
     unsigned _nestDepth;
     bool _dumpOnFail;
+    bool _useGC;
 
     void initJitOutputFunctions();
+    bool declareClasses(TreeContainer *trees);
     bool declareFunctions(TreeContainer *trees);
+    bool generateInstantiations();
 };
 
 #endif
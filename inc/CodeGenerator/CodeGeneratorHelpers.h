@@ -1,7 +1,9 @@
 #ifndef _CODE_GENERATOR_HELPERS_H
 #define _CODE_GENERATOR_HELPERS_H
 #include <map>
+#include <set>
 #include <vector>
+#include "llvm/IR/Instructions.h"
 #include "../AstNodes/IAstExpression.h"
 #include "../AstNodes/AstTypeNode.h"
 #include "../Lexer/PossiblePosition.h"
@@ -12,6 +14,8 @@ namespace llvm {
     class Type;
     class Function;
     class AllocaInst;
+    class Constant;
+    class DataLayout;
 }
 
 namespace Helpers {
@@ -51,9 +55,11 @@ namespace Helpers {
         llvm::Value *intintEQ(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *intintNE(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
 
-        // int:double | double:int
+        // int:double | double:int, also with floats and float:double
         llvm::Value *intToDouble(CodeGenerator *codegen, llvm::Value *intValue);
         llvm::Value *doubleToInt(CodeGenerator *codegen, llvm::Value *doubleValue);
+        // Converts an integer operand to the floating point type of the other, and a float next to a double to a double.
+        void matchFloatingOperands(CodeGenerator *codegen, llvm::Value *&lhs, llvm::Value *&rhs);
 
         llvm::Value *intdoubleAdd(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *intdoubleSub(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
@@ -67,7 +73,7 @@ namespace Helpers {
         llvm::Value *intdoubleEQ(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *intdoubleNE(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
 
-        // double:double
+        // double:double | float:float, also elementwise on vectors of them
         llvm::Value *doubledoubleAdd(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *doubledoubleSub(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *doubledoubleMul(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
@@ -79,11 +85,24 @@ namespace Helpers {
         llvm::Value *doubledoubleGE(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *doubledoubleEQ(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
         llvm::Value *doubledoubleNE(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
+
+        // ptr:ptr
+        llvm::Value *ptrptrEQ(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
+        llvm::Value *ptrptrNE(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
     }
 
-    // Returns a pointer to a function which will generate the proper LLVM code to handle the operator and types passed.
+    // Returns a pointer to a function which will generate the proper LLVM code to handle the operator and types passed,
+    // or nullptr if the operator doesn't exist for them.
     BinOperations::BinOpCodeGenFuncPtr GetBinopCodeGenFuncPointer(TokenType Operator, llvm::Type *lType, llvm::Type *rType, bool isUnsigned = false);
 
+    // Returns the identity value of a reduction operator for the type passed, e.g. 0 for '+' and 1 for '*',
+    // returns nullptr if the operator cannot be used as a reduction on that type.
+    llvm::Value *GetReductionIdentity(CodeGenerator *codegen, TokenType Operator, llvm::Type *type, bool isUnsigned);
+
+    // Combines the partial results of a reduction pairwise as a balanced tree and returns the final value,
+    // '<' and '>' are treated as 'min' and 'max'. Returns nullptr if the partials could not be combined.
+    llvm::Value *CreateReductionTree(CodeGenerator *codegen, TokenType Operator, std::vector<llvm::Value*> partials, bool isUnsigned);
+
     // EmitScopeBlock - Emits a std::vector of ast::IAstExpr* expressions and returns their value
     // in a std::vector<llvm::Value*>
     std::vector<llvm::Value*> EmitScopeBlock(CodeGenerator *codegen, const std::vector<IAstExpression*> &block, 
@@ -102,9 +121,6 @@ namespace Helpers {
     // Creates a LLVM::Value* of float type from the llvm::Value passed.
     llvm::Value *GetFloat(CodeGenerator *codegen, double val);
 
-    // Normalizes integer bitwidths, basically just casts up to the larger.
-    void NormalizeIntegerWidths(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
-
     // Creates a LLVM::Value* of signed integer type with specified width from the value passed.
     llvm::Value *GetInt(CodeGenerator *codegen, demi_int val, int bitwidth);
 
@@ -181,12 +197,15 @@ namespace Helpers {
     // Creates a LLVM::Value* of signed integer8 type with a value of two.
     llvm::Value *GetTwo_8(CodeGenerator *codegen);
 
-    // Creates a LLVM::Value* of integer8* type from the llvm::Value passed.
+    // Creates a string constant of the value passed, its chars are never freed.
     llvm::Value *GetString(CodeGenerator *codegen, std::string val);
 
     // Returns a string representation of the passed llvm type.
     std::string GetLLVMTypeName(llvm::Type *Ty);
 
+    // Returns the type as LLVM writes it, e.g. 'i64' or '%string', which tells integer widths apart.
+    std::string GetLLVMTypeSignature(llvm::Type *type);
+
     // Returns true if the value is a pointer to a pointer
     bool IsPtrToPtr(llvm::Value *val);
 
@@ -230,6 +249,114 @@ namespace Helpers {
     llvm::Value *CreateMallocCall(CodeGenerator *codegen, llvm::Value *size);
     // Creates a call to free
     llvm::Value *CreateFreeCall(CodeGenerator *codegen, llvm::Value *ptr);
+
+    // Returns the declaration of a function exported by the compiler's runtime, declaring it if needed.
+    llvm::Constant *GetRuntimeFunction(CodeGenerator *codegen, const std::string &name, llvm::Type *returnType,
+        const std::vector<llvm::Type*> &argTypes);
+
+    // Defines a builtin function calling into the runtime, returns null if there's no builtin named 'name'.
+    // Builtins are only defined when called and nothing else has the name, so they never shadow a function.
+    llvm::Function *GetBuiltinFunction(CodeGenerator *codegen, const std::string &name);
+
+    // Returns whether an expression is a variable or an element of an array declared with an atomic type.
+    bool IsAtomicLValue(CodeGenerator *codegen, IAstExpression *expr);
+
+    // Returns the address of an assignable expression, a variable, an array element or a field, and sets 'isAtomic'
+    // to whether it was declared with an atomic type. Returns nullptr if the expression can't be assigned to.
+    llvm::Value *GetLValueAddress(CodeGenerator *codegen, IAstExpression *expr, bool *isAtomic = nullptr);
+
+    // Returns the strongest ordering a failed compare-exchange may have for a given success ordering.
+    llvm::AtomicOrdering GetCmpXchgFailureOrdering(llvm::AtomicOrdering ordering);
+
+    // Creates an atomic load of an integer with the given ordering.
+    llvm::Value *CreateAtomicLoad(CodeGenerator *codegen, llvm::Value *ptr, llvm::AtomicOrdering ordering);
+
+    // Creates an atomic store of an integer with the given ordering, 'val' is implicitly cast to the destination type.
+    llvm::Value *CreateAtomicStore(CodeGenerator *codegen, llvm::Value *val, llvm::Value *ptr, llvm::AtomicOrdering ordering);
+
+    // Atomically replaces the integer at 'ptr' with the result of 'Operator' applied to it and 'val', using atomicrmw
+    // when LLVM has an equivalent operation and a cmpxchg loop otherwise. Returns the previous value and sets 'updated'
+    // to the new one, returns nullptr if the operator doesn't exist for the types.
+    llvm::Value *CreateAtomicUpdate(CodeGenerator *codegen, TokenType Operator, llvm::Value *ptr, llvm::Value *val,
+        bool isUnsigned, llvm::AtomicOrdering ordering, llvm::Value **updated = nullptr);
+
+    // Returns whether a pointer, or one derived from it, can outlive the function: it is passed to a call, returned,
+    // stored anywhere but a variable or turned into an integer. Variables it's stored into are followed.
+    bool PointerEscapes(llvm::Value *ptr, std::set<llvm::Value*> &visited);
+
+    // Replaces the 'new' allocations of a function which are of a small constant size, outside of any loop and
+    // never escape with stack memory in the entry block.
+    void PromoteNonEscapingAllocations(CodeGenerator *codegen, llvm::Function *function);
+
+    // Appends the offsets of every pointer within a value of a type, starting at 'base', to 'offsets'.
+    void GetPointerOffsets(const llvm::DataLayout *layout, llvm::Type *type, uint64_t base, std::vector<uint64_t> &offsets);
+
+    // With '-gc', keeps a pointer which isn't in a variable, e.g. the result of a call, visible to the collector
+    // until the function returns. Returns the pointer.
+    llvm::Value *CreateGCTempRoot(CodeGenerator *codegen, llvm::Value *val);
+
+    // Moves the variables of a function which hold pointers into a frame the collector can find, the frame is linked
+    // into the thread's chain of roots on entry and unlinked before every return.
+    void InsertGCFrame(CodeGenerator *codegen, llvm::Function *function);
+
+    // Returns whether a type is 'string'.
+    bool IsStringType(CodeGenerator *codegen, llvm::Type *type);
+
+    // Returns whether a type is 'string' or an array or class holding strings.
+    bool ContainsString(CodeGenerator *codegen, llvm::Type *type);
+
+    // Returns an address holding a string value for the runtime's string functions, the address it was loaded
+    // from if it was loaded, otherwise a temporary copy which doesn't own a reference. A loaded string must not have
+    // been written since, a value used after other code runs is captured with CreateStringCapture first.
+    llvm::Value *GetStringAddress(CodeGenerator *codegen, llvm::Value *str);
+
+    // Returns a temporary for a string made by the runtime, or a value holding strings, which owns references to
+    // them. What the temporary held the last time the code ran is released first.
+    llvm::AllocaInst *CreateStringTemp(CodeGenerator *codegen, llvm::Type *type);
+    llvm::AllocaInst *CreateStringTemp(CodeGenerator *codegen);
+
+    // Takes ownership of the strings in a value the caller owns references to, e.g. the result of a call, and
+    // returns it.
+    llvm::Value *CreateOwnedString(CodeGenerator *codegen, llvm::Value *str);
+
+    // Copies a string into a temporary with a reference of its own, so that code run before it's used can't change
+    // or free it, and returns it.
+    llvm::Value *CreateStringCapture(CodeGenerator *codegen, llvm::Value *str);
+
+    // Adds a reference to the string at an address, or to every string of the instance or array there.
+    void CreateStringRetain(CodeGenerator *codegen, llvm::Value *address);
+
+    // Drops the reference of the string at an address, or of every string of the instance or array there, and
+    // empties them.
+    void CreateStringRelease(CodeGenerator *codegen, llvm::Value *address);
+
+    // Stores a value into a variable, field or element. A string is shared by adding a reference to it and
+    // releasing the string it replaces, an instance or array does the same for every string it holds, anything
+    // else is a plain store.
+    void CreateAssignmentStore(CodeGenerator *codegen, llvm::Value *val, llvm::Value *address);
+
+    // Returns the concatenation of two strings.
+    llvm::Value *CreateStringConcat(CodeGenerator *codegen, llvm::Value *lhs, llvm::Value *rhs);
+
+    // Appends a string to the string at an address, in place when possible, and returns the result.
+    llvm::Value *CreateStringAppend(CodeGenerator *codegen, llvm::Value *address, llvm::Value *str);
+
+    // Returns the length of the string at an address.
+    llvm::Value *CreateStringLength(CodeGenerator *codegen, llvm::Value *address);
+
+    // Returns the NUL terminated chars of a string for C functions, valid until the code runs again or returns.
+    llvm::Value *CreateStringCStr(CodeGenerator *codegen, llvm::Value *str);
+
+    // Returns a string copied from a C string.
+    llvm::Value *CreateStringFromCStr(CodeGenerator *codegen, llvm::Value *cstr);
+
+    // Empties the variables and temporaries of the current function owning strings on entry, and releases
+    // them before every return.
+    void ReleaseOwnedStrings(CodeGenerator *codegen, llvm::Function *function);
+
+    // Turns the variables of a function that are only loaded and stored, never having their address taken, into
+    // SSA values, with phis where control flow merges. Runs last, once nothing needs their allocas.
+    void PromoteVariablesToRegisters(CodeGenerator *codegen, llvm::Function *function);
 }
 
 #endif
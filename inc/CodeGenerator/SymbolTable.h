@@ -0,0 +1,34 @@
+#ifndef _SYMBOL_TABLE_H
+#define _SYMBOL_TABLE_H
+
+#include <vector>
+
+#include "Lexer/NameTable.h"
+
+namespace llvm {
+    class AllocaInst;
+}
+
+/*
+ *  The variables in scope while a function is generated, by interned name. Each name's innermost variable is kept
+ *  in a flat array indexed by its id, so looking one up is a single index. Declarations are pushed on a stack along
+ *  with the variable they shadow, which popping them restores.
+ */
+class SymbolTable {
+    std::vector<llvm::AllocaInst*> _variables;                              // by name id, nullptr if not in scope.
+    std::vector<std::pair<NameTable::NameId, llvm::AllocaInst*>> _declarations; // and the variables they shadow.
+public:
+    // Returns the innermost variable declared with the name, or nullptr.
+    llvm::AllocaInst *Lookup(NameTable::NameId id) const;
+    // Declares a variable, shadowing any declared with the same name until it's popped.
+    void Declare(NameTable::NameId id, llvm::AllocaInst *variable);
+    // Rebinds the innermost variable declared with the name and returns the previous one, or nullptr if there's none.
+    llvm::AllocaInst *Replace(NameTable::NameId id, llvm::AllocaInst *variable);
+    // Removes the last 'count' declarations.
+    void Pop(unsigned count);
+    void Clear();
+    // Returns the number of declarations in scope.
+    unsigned GetDepth() const;
+};
+
+#endif
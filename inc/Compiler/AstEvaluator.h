@@ -0,0 +1,75 @@
+#ifndef _AST_EVALUATOR_H
+#define _AST_EVALUATOR_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "AstNodes/AST_DEPENDENCIES.h"
+
+class AstCallExpression;
+class AstTypeNode;
+class FunctionAst;
+class IAstExpression;
+
+// A number or a boolean known at compile time, booleans are 1 bit integers like in the generated code.
+struct ConstantValue {
+    bool IsDouble;
+    unsigned BitWidth;  // of an integer.
+    uint64_t Bits;      // of an integer, zero extended from its width.
+    double Number;
+
+    static ConstantValue Integer(uint64_t bits, unsigned bitWidth);
+    static ConstantValue Double(double number);
+    int64_t getSigned() const;
+    bool isBoolean() const;
+};
+
+/*
+ *  Evaluates calls of 'const' functions on literals at compile time by interpreting their trees. A 'const'
+ *  function only works on numbers and booleans, calling nothing but other 'const' functions, which is
+ *  checked when it's added. Evaluation follows the code generator: integers wrap at their width, casts
+ *  are signed, and an operation the program would trap on or leave undefined isn't evaluated, the call is
+ *  then made at run time instead.
+ */
+class AstEvaluator {
+    std::map<std::string, FunctionAst*> _functions;
+    std::vector<std::map<std::string, ConstantValue>> _scopes;  // of the function being evaluated.
+    unsigned _steps, _depth;
+    bool _isReturning;
+    ConstantValue _returnValue;
+public:
+    AstEvaluator();
+    // Adds a 'const' function, its body is only checked by CheckFunctions once they're all added.
+    void AddFunction(FunctionAst *func);
+    // Checks that the 'const' functions only use what can be evaluated, returns false after reporting any that don't.
+    bool CheckFunctions();
+    bool IsConstFunction(const std::string &name) const;
+    // Returns the literal a call of a 'const' function on literals evaluates to, or nullptr if it can't be evaluated.
+    IAstExpression *EvaluateCall(AstCallExpression *call);
+
+    // Returns false if 'expr' isn't a number or boolean literal.
+    static bool GetLiteral(IAstExpression *expr, ConstantValue &value);
+    // Returns the literal for the result of an expression, which is signed like any expression that isn't a literal.
+    static IAstExpression *MakeLiteral(const ConstantValue &value, PossiblePosition pos);
+    // Returns false if the operation can't be evaluated, 'isUnsigned' is whether both operands are unsigned.
+    static bool EvaluateBinary(TokenType oper, const ConstantValue &lhs, const ConstantValue &rhs, bool isUnsigned,
+        ConstantValue &result);
+    static bool EvaluateUnary(TokenType oper, const ConstantValue &operand, ConstantValue &result);
+
+private:
+    bool checkBlock(FunctionAst *func, const std::vector<IAstExpression*> &block);
+    bool checkExpression(FunctionAst *func, IAstExpression *expr);
+    bool checkType(FunctionAst *func, AstTypeNode *type, PossiblePosition pos);
+
+    bool call(FunctionAst *func, const std::vector<ConstantValue> &args, ConstantValue &result);
+    bool executeBlock(const std::vector<IAstExpression*> &block);
+    bool execute(const std::vector<IAstExpression*> &block);
+    bool evaluate(IAstExpression *expr, ConstantValue &result);
+    bool evaluateCondition(IAstExpression *expr, bool &result);
+    bool assign(IAstExpression *lvalue, const ConstantValue &value, ConstantValue &result);
+    ConstantValue *lookup(const std::string &name);
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef _AST_SIMPLIFIER_H
+#define _AST_SIMPLIFIER_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AstNodes/AST_DEPENDENCIES.h"
+#include "Compiler/AstEvaluator.h"
+#include "Lexer/NameTable.h"
+
+class IAstExpression;
+class AstCallExpression;
+class FunctionAst;
+struct TreeContainer;
+
+/*
+ *  Simplifies the trees between parsing and code generation: expressions on number and boolean literals are
+ *  folded into a literal, and variables initialized with a literal that are never assigned again are replaced
+ *  by it where they're read. Folding follows the code generator, integer literals are 32 bit and compared
+ *  unsigned only against each other, so a folded expression evaluates exactly as it would have unfolded.
+ *  Calls of 'const' functions on literals are evaluated by the AstEvaluator.
+ *
+ *  The variables assigned or declared more than once in a function are found by a scan of its FlatAst before
+ *  it's walked, the walk replaces the others.
+ */
+class AstSimplifier {
+    std::set<NameTable::NameId> _assigned;              // in the current function, never replaced.
+    std::vector<std::map<NameTable::NameId, IAstExpression*>> _scopes; // constant variables and their literals.
+    AstEvaluator _evaluator;
+public:
+    AstSimplifier();
+    // Returns false if a 'const' function uses something that can't be evaluated.
+    bool Simplify(TreeContainer *trees);
+    // Simplifies a function's body, 'params' are its parameters' names.
+    void SimplifyFunction(const std::vector<std::string> &params, std::vector<IAstExpression*> &body);
+    // Returns the simplified expression, 'expr' is deleted if it was replaced.
+    IAstExpression *Simplify(IAstExpression *expr);
+    // Like Simplify for an expression that's assigned to, which is never replaced by a constant.
+    IAstExpression *SimplifyLValue(IAstExpression *expr);
+    // Simplifies the expressions of a block, which is a scope of its own.
+    void SimplifyBlock(std::vector<IAstExpression*> &block);
+
+    void PushScope();
+    void PopScope();
+    // Declares a variable in the current scope, 'value' is its initial value if it has one.
+    void DeclareVariable(NameTable::NameId name, IAstExpression *value);
+    // Returns a copy of the literal a variable is known to hold at 'pos', or nullptr.
+    IAstExpression *GetConstant(NameTable::NameId name, PossiblePosition pos);
+
+    // Returns the literal an operation on literals evaluates to, or nullptr if it can't be folded.
+    IAstExpression *FoldBinary(TokenType oper, IAstExpression *lhs, IAstExpression *rhs, PossiblePosition pos);
+    IAstExpression *FoldUnary(TokenType oper, IAstExpression *operand, PossiblePosition pos);
+    // Returns the literal a call of a 'const' function on literals evaluates to, or nullptr.
+    IAstExpression *EvaluateCall(AstCallExpression *call);
+
+private:
+    // Sets '_assigned' to the variables of a function that are written to after their declaration.
+    void findAssigned(const std::vector<std::string> &params, const std::vector<IAstExpression*> &body);
+};
+
+#endif
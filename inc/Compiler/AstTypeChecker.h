@@ -0,0 +1,84 @@
+#ifndef _AST_TYPE_CHECKER_H
+#define _AST_TYPE_CHECKER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "AstNodes/AstVisitor.h"
+#include "Lexer/NameTable.h"
+
+class AstTypeNode;
+class FunctionAst;
+struct TreeContainer;
+
+/*
+ *  Resolves the type of the expressions in functions before code generation and annotates them with it, so the
+ *  code generator knows the type binary operators work on without inspecting the values it generated. Types are
+ *  node types like those of AstTypeNode and follow the code generator: integers of different widths are widened
+ *  to the larger one, and are operated on unsigned only if both are. Variables, parameters and results keep the
+ *  signedness they're declared with. Integer literals are unsigned, but a variable inferred from one or its
+ *  negation is signed, as the literal was written without a signedness of its own.
+ *  Types it can't tell, e.g. of classes, methods and builtins, are left as node_default and worked out by the
+ *  code generator. Operations that mix strings and numbers are reported, as are widening conversions of a
+ *  variable repeated by every iteration of a loop.
+ */
+class AstTypeChecker : public AstVisitor<AstTypeChecker, AstNodeType> {
+    friend class AstVisitor<AstTypeChecker, AstNodeType>;
+
+    // A variable's type as it's read, and whether it's an array of it.
+    struct Variable {
+        AstNodeType Type;
+        bool IsArray;
+    };
+    std::map<std::string, AstNodeType> _functions;     // return types of the functions called by name.
+    std::vector<std::map<NameTable::NameId, Variable>> _scopes;
+    AstNodeType _returnType;
+    unsigned _loopDepth;
+    bool _isValid;
+public:
+    AstTypeChecker();
+    // Annotates the trees, returns false after reporting type errors.
+    bool Check(TreeContainer *trees);
+    // Annotates a function of the trees last checked, e.g. an instantiation of a generic function or a method.
+    // Returns false after reporting type errors.
+    bool CheckFunction(FunctionAst *func);
+
+    // Returns the type both operands of a binary operator are converted to, node_default if it can't be told.
+    static AstNodeType GetOperandType(AstNodeType lhs, AstNodeType rhs);
+    // Returns the type of an expression, its node type for literals that weren't annotated.
+    static AstNodeType GetType(IAstExpression *expr);
+    // Returns the type of an argument as it's matched against parameters, a literal's is signed like a variable
+    // inferred from it.
+    static AstNodeType GetArgumentType(IAstExpression *arg);
+    static bool IsInteger(AstNodeType type);
+    static bool IsNumber(AstNodeType type);
+    static unsigned GetBitWidth(AstNodeType type);
+    static const char *GetTypeName(AstNodeType type);
+
+private:
+    void checkBlock(const std::vector<IAstExpression*> &block);
+    // Annotates an expression with its type and returns it.
+    AstNodeType check(IAstExpression *expr);
+    AstNodeType VisitExpression(IAstExpression *expr);
+    AstNodeType VisitVariable(AstVariableNode *variable);
+    AstNodeType VisitVar(AstVarExpr *var);
+    AstNodeType VisitBinaryOperator(AstBinaryOperatorExpr *binop);
+    AstNodeType VisitUnaryOperator(AstUnaryOperatorExpr *unary);
+    AstNodeType VisitCall(AstCallExpression *call);
+    AstNodeType VisitIfElse(AstIfElseExpr *ifElse);
+    AstNodeType VisitWhile(AstWhileExpr *loop);
+    AstNodeType VisitFor(AstForExpr *loop);
+    AstNodeType VisitReturn(AstReturnExpr *ret);
+    AstNodeType VisitArena(AstArenaExpr *arena);
+    AstNodeType VisitSpawn(AstSpawnExpr *spawn);
+    AstNodeType VisitAwait(AstAwaitExpr *await);
+    AstNodeType VisitAtomic(AstAtomicExpr *atomic);
+    // Warns about a variable converted from 'type' to 'operandType' by an operation repeated in a loop.
+    void checkConversion(IAstExpression *operand, AstNodeType type, AstNodeType operandType);
+
+    void declare(NameTable::NameId name, AstNodeType type, bool isArray);
+    const Variable *lookup(NameTable::NameId name) const;
+};
+
+#endif
@@ -22,6 +22,8 @@
 
 class Lexer;
 class Parser;
+class AstSimplifier;
+class AstTypeChecker;
 class CodeGenerator;
 
 class DemiurgeCompiler {
@@ -45,6 +47,8 @@ public:
 
     Lexer *_lexer;
     Parser *_parser;
+    AstSimplifier *_simplifier;
+    AstTypeChecker *_typeChecker;
     CodeGenerator *_codeGenerator;
 
     /* compiler state variables */
@@ -0,0 +1,77 @@
+#ifndef _FLAT_AST_H
+#define _FLAT_AST_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "AstNodes/AST_DEPENDENCIES.h"
+#include "Compiler/AstEvaluator.h"
+
+class IAstExpression;
+
+// A node of a FlatAst, 16 bytes. Its children follow it in the array, each one's subtree ending where the
+// next one starts.
+struct FlatNode {
+    uint8_t Type;       // the AstNodeType, or FlatAst::node_block for a list of statements.
+    uint8_t Flags;
+    uint16_t Operator;  // the TokenType of operators, reductions and 'new'.
+    uint32_t End;       // the index after the node's subtree, where its next sibling starts.
+    uint32_t Pos;       // the line and column packed by FlatAst::PackPos.
+    uint32_t Value;     // the NameId of names, the index of literals in the FlatAst's constants or strings.
+
+    enum {
+        IsAssigned = 1 << 0,        // a variable written to: assigned, incremented, updated atomically or reduced into.
+        HasInitializer = 1 << 1,    // a 'var' whose first child is its initial value.
+        HasSubscript = 1 << 2,      // a 'var' or 'new' whose last child is the size of its array type.
+    };
+};
+
+/*
+ *  A function body encoded as one array of nodes in pre-order, so a pass over every node is a loop over the array.
+ *  Children are found by position rather than through pointers: the first is the node after its parent, and
+ *  each child's End is where the next one starts. Lists of statements are node_block nodes, their statements as
+ *  children, and a missing expression, e.g. a 'for' without a condition, is a node_default node without children.
+ *  Nodes the encoding doesn't look into, e.g. class member accesses' fields, are node_default too.
+ *
+ *  The children of each node type, in order:
+ *      node_var                    the initial value, the array size
+ *      node_binary_operation       the left and right operands
+ *      node_unary_operation_*      the operand and the index of '[', the array size of 'new'
+ *      node_call, node_atomic      the arguments
+ *      node_ifelse                 the condition, the 'if' block, the 'else' block
+ *      node_while                  the condition, the body block
+ *      node_for                    the init block, the condition, the afterthought block, the body block and a
+ *                                  block of the reduced variables
+ *      node_return, node_await     the value
+ *      node_spawn                  the call
+ *      node_arena                  the body block
+ */
+class FlatAst {
+    std::vector<FlatNode> _nodes;
+    std::vector<ConstantValue> _constants;
+    std::vector<std::string> _strings;
+public:
+    static const uint8_t node_block = 0xff;
+
+    // Encodes a list of statements, the block is node 0.
+    explicit FlatAst(const std::vector<IAstExpression*> &body);
+
+    unsigned getSize() const;
+    const FlatNode &operator[](unsigned node) const;
+    PossiblePosition getPos(unsigned node) const;
+    // The value of a number or boolean literal.
+    const ConstantValue &getConstant(unsigned node) const;
+    const std::string &getString(unsigned node) const;
+
+    // Lines above 2^20 and columns above 2^12 are clamped, unknown positions are 0.
+    static uint32_t PackPos(PossiblePosition pos);
+    static PossiblePosition UnpackPos(uint32_t pos);
+
+private:
+    friend class FlatAstEncoder;
+    // Appends a node without children, returns its index.
+    unsigned add(uint8_t type, PossiblePosition pos);
+};
+
+#endif
@@ -6,6 +6,7 @@
 class ClassAst;
 class PrototypeAst;
 class FunctionAst;
+class GenericFunctionAst;
 class IAstExpression;
 
 struct TreeContainer {
@@ -13,6 +14,7 @@ struct TreeContainer {
     std::vector<PrototypeAst*> ExternalDeclarations;
     std::vector<IAstExpression*> TopLevelExpressions;
     std::vector<FunctionAst*> FunctionDefinitions;
+    std::vector<GenericFunctionAst*> GenericFunctions;
     std::vector<ClassAst*> ClassDefinitions;
 };
 
@@ -1,6 +1,8 @@
 #ifndef _DEFINES_H
 #define _DEFINES_H
 
-#define COMPILER_RETURN_VALUE_STRING "__return_value__"
+#define FUTURE_TYPE_PREFIX "future."
+// Largest 'new' allocation, in bytes, moved to the stack when it doesn't escape its function.
+#define STACK_PROMOTION_LIMIT 4096
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef _NAME_TABLE_H
+#define _NAME_TABLE_H
+
+#include <string>
+
+/*
+ *  Interns names: every distinct name is given a small integer id, the same for each occurrence, so names can be
+ *  compared and looked up as integers. Ids are dense, counting up from 0, and are never released.
+ */
+namespace NameTable {
+    typedef unsigned NameId;
+
+    // Returns the id of a name, giving it the next one if it's new.
+    NameId Intern(const std::string &name);
+    // Returns the name an id was given to.
+    const std::string &GetName(NameId id);
+    // Returns the number of ids given out, every id is below it.
+    unsigned GetCount();
+}
+
+#endif
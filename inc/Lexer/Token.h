@@ -2,19 +2,26 @@
 #define _TOKEN_H
 
 #include <string>
+#include "NameTable.h"
+#include "TokenTypes.h"
+
 class Token {
 public:
+    // Identifiers are interned as the token is made, so names compare by their id from then on.
     Token(int type, const std::string &value, int line = -1, int column = -1, bool isUnaryOperator = false)
         : _type(type)
         , _lineNumber(line)
         , _columnNumber(column)
+        , _isUnaryOperator(isUnaryOperator)
         , _value(value)
-        , _isUnaryOperator(isUnaryOperator) {}
+        , _name(type == tok_identifier ? NameTable::Intern(value) : 0) {}
     ~Token(){}
     int Type() const { return _type; }
     int Line() const { return _lineNumber; }
     int Column() const { return _columnNumber; }
     std::string Value() const { return _value; }
+    // The interned name of an identifier.
+    NameTable::NameId Name() const { return _name; }
 
     bool AsBool() const { return _value != "false"; } // anything not 'false' equates to true.
     double AsDouble() const { return strtod(_value.c_str(), nullptr); }
@@ -28,6 +35,7 @@ private:
     int _columnNumber;
     bool _isUnaryOperator;
     std::string _value;
+    NameTable::NameId _name;
 };
 
 #endif
\ No newline at end of file
@@ -19,6 +19,10 @@ typedef enum tag_TokenType {
     tok_while,              // 'while'
     tok_for,                // 'for'
     tok_new,                // 'new'
+    tok_reduce,             // 'reduce'
+    tok_spawn,              // 'spawn'
+    tok_await,              // 'await'
+    tok_atomic,             // 'atomic'
     
     tok_typeint8,           // 'char', 'int8'
     tok_typeint16,          // 'short', 'int16'
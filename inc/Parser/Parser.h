@@ -11,6 +11,7 @@ class AstTypeNode;
 class ClassAst;
 class FunctionAst;
 class PrototypeAst;
+struct AstReductionClause;
 
 class Parser {
 public:
@@ -39,6 +40,9 @@ private:
     IAstExpression *parseVarExpression();
     IAstExpression *parseParenExpression();
     IAstExpression *parseIdentifierExpression();
+    IAstExpression *parseSpawnExpression();
+    IAstExpression *parseAwaitExpression();
+    IAstExpression *parseArenaExpression();
     IAstExpression *parseNumberExpression();
     IAstExpression *parseStringExpression();
     IAstExpression *parseBooleanExpression();
@@ -46,11 +50,13 @@ private:
     IAstExpression *parseIfElseExpression();
     IAstExpression *parseWhileExpression();
     IAstExpression *parseForExpression();
+    bool parseReductionClause(std::vector<AstReductionClause> &reductions);
     IAstExpression *parseArraySubscript();
     IAstExpression *parseBinOpRhs(int precedence, IAstExpression *lhs);
     IAstExpression *parsePrefixUnaryExpr();
     IAstExpression *parsePostfixUnaryExpr(IAstExpression *operand);
     
+    void addFunctionDefinition(TreeContainer *trees, FunctionAst *func, int start);
     FunctionAst *parseFunctionDefinition();
     PrototypeAst *parsePrototype();
     PrototypeAst *parseExternDeclaration();
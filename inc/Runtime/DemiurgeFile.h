@@ -0,0 +1,38 @@
+#ifndef _DEMIURGE_FILE_H
+#define _DEMIURGE_FILE_H
+
+/*
+ *  Reading files, behind the 'open', 'read_line', 'eof', 'close' and 'map_file' builtins.
+ *
+ *  Regular files are memory mapped and read sequentially, anything that can't be mapped (pipes,
+ *  devices) is read into memory whole when opened. Lines are handed out as views into that
+ *  memory instead of being copied. The file is the owner of the views, so its memory is only
+ *  unmapped or freed once it is closed and no line read from it is left. A file that failed to
+ *  open is null, which reads as an empty file.
+ */
+
+#include <stdint.h>
+
+struct DemiString;
+
+extern "C" {
+
+    // Opens a file for reading, returns null if it can't be opened.
+    void *demi_file_open(const DemiString *path);
+
+    // Writes a view of the next line, without its line ending, to 'line'. Past the end the line is empty.
+    void demi_file_read_line(void *file, DemiString *line);
+
+    // Returns whether every line of a file has been read.
+    bool demi_file_eof(void *file);
+
+    // Closes a file, its contents stay until the lines read from it are released.
+    void demi_file_close(void *file);
+
+    // Writes a view of a whole file to 'result', empty if it can't be opened. The file stays mapped
+    // until the string and every copy of it are released.
+    void demi_file_map(DemiString *result, const DemiString *path);
+
+}
+
+#endif
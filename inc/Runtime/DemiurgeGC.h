@@ -0,0 +1,63 @@
+#ifndef _DEMIURGE_GC_H
+#define _DEMIURGE_GC_H
+
+/*
+ *  Precise tracing garbage collector used by 'new' when compiling with '-gc'.
+ *
+ *  Objects are bump allocated into 1MB blocks, the block being allocated into is the nursery.
+ *  Collections mark everything reachable in parallel and sweep block by block: blocks left
+ *  without a live object, most nursery blocks, are reused wholesale while blocks holding
+ *  survivors are kept as they are (objects never move) until everything in them has died.
+ *
+ *  Roots are precise. Every function with pointer variables keeps them in a frame which it
+ *  links into a per-thread chain on entry and unlinks on return, the frame's map tells the
+ *  collector where the pointers are. Heap objects carry the type info of their elements in
+ *  the same form. A pointer is only followed if it points into an object of the heap, so
+ *  pointers to string literals or foreign memory in pointer slots are harmless.
+ *
+ *  Collections only happen while no 'spawn'ed task is alive, as other threads' frames and
+ *  task payloads aren't traced.
+ */
+
+#include <stdint.h>
+
+// Where the pointers are in an element of a type, the compiler emits one per allocated type.
+struct DemiTypeInfo {
+    uint64_t Size;          // bytes per element.
+    uint64_t PointerCount;
+    uint64_t Offsets[1];    // 'PointerCount' offsets of pointers within an element.
+};
+
+struct DemiGCRootInfo {
+    uint64_t Offset;        // from the start of the frame.
+    const DemiTypeInfo *Type;
+};
+
+struct DemiGCFrameMap {
+    uint64_t RootCount;
+    DemiGCRootInfo Roots[1];
+};
+
+// The start of a function's frame, its roots follow at the offsets given by the map.
+struct DemiGCFrame {
+    DemiGCFrame *Prev;
+    const DemiGCFrameMap *Map;
+};
+
+extern "C" {
+
+    // Allocates 'count' zeroed elements of a type from the collected heap, may collect first.
+    void *demi_gc_alloc(const DemiTypeInfo *type, uint64_t count);
+
+    // Links a frame into this thread's chain of roots, on function entry.
+    void demi_gc_push_frame(DemiGCFrame *frame);
+
+    // Unlinks the most recently pushed frame, on function return.
+    void demi_gc_pop_frame(DemiGCFrame *frame);
+
+    // Collects now, unless a spawned task is alive.
+    void demi_gc_collect();
+
+}
+
+#endif
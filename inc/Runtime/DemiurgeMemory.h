@@ -0,0 +1,31 @@
+#ifndef _DEMIURGE_MEMORY_H
+#define _DEMIURGE_MEMORY_H
+
+/*
+ *  Heap and region allocation used by 'new' and 'arena { ... }'.
+ *
+ *  Outside of an arena 'new' allocates from the heap. Inside one it bump allocates from the
+ *  arena's chunks, nothing allocated from an arena is freed on its own: leaving the 'arena'
+ *  block frees everything at once. Chunks of the default size are kept in a per-thread cache
+ *  when an arena is destroyed so that an arena entered over and over doesn't go back to malloc.
+ */
+
+#include <stdint.h>
+
+extern "C" {
+
+    // Allocates from the heap, never returns null.
+    void *demi_alloc(uint64_t size);
+
+    // Creates an empty arena.
+    void *demi_arena_create();
+
+    // Allocates from an arena, the memory is 16 byte aligned and lives until the arena is destroyed.
+    void *demi_arena_alloc(void *arena, uint64_t size);
+
+    // Frees an arena along with everything allocated from it.
+    void demi_arena_destroy(void *arena);
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef _DEMIURGE_OUTPUT_H
+#define _DEMIURGE_OUTPUT_H
+
+/*
+ *  Buffered standard output used by the print functions and by 'printf' in JIT'd code.
+ *
+ *  Every thread writes into a buffer of its own which goes to stdout when it fills up, when a
+ *  spawned task finishes and when main returns, so output of one thread stays in order while
+ *  the output of concurrent tasks is interleaved at most at those points. Integers and doubles
+ *  are formatted by hand instead of through printf's format parsing.
+ *
+ *  Declaring 'printf' in a script binds it to demi_output_printf so that it shares the buffer
+ *  with the other functions. 'print' and 'println' take the script's string itself and write
+ *  its stored length of chars, so they neither scan for a NUL nor copy views.
+ */
+
+#include <stdint.h>
+
+struct DemiString;
+
+extern "C" {
+
+    // Writes this thread's buffered output to stdout.
+    void demi_output_flush();
+
+    // Formats like printf into this thread's buffer.
+    int demi_output_printf(const char *format, ...);
+
+    // Prints a string, returns its length.
+    int print(const DemiString *string);
+
+    // Prints a string and a new line, returns the length of the string.
+    int println(const DemiString *string);
+
+    // Prints a double like "%f".
+    double printd(double x);
+
+    // Prints an unsigned integer.
+    uint64_t printi(uint64_t x);
+
+    // Prints the low byte of 'x' as a char.
+    uint64_t printc(uint64_t x);
+
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _DEMIURGE_SCHEDULER_H
+#define _DEMIURGE_SCHEDULER_H
+
+/*
+ *  Fork-join task runtime used by 'spawn' and 'await'.
+ *
+ *  Every worker owns a Chase-Lev work-stealing deque: spawning pushes onto the bottom of the
+ *  spawning worker's deque, idle workers steal from the top of a random victim's deque, and a
+ *  worker awaiting a task runs other tasks until it has finished. The thread that first uses
+ *  the runtime (the JIT'd main) becomes worker 0, the other workers are started lazily.
+ *
+ *  A task is a payload allocated through demi_task_alloc, the header in front of it is managed
+ *  by the runtime. The compiler fills in the payload, spawns it, and once awaited reads the
+ *  result out of it and frees it.
+ */
+
+#include <stdint.h>
+
+typedef void(*demi_task_fn)(void *payload);
+
+extern "C" {
+
+    // Allocates a task which will run 'fn' on its payload, returns the payload.
+    void *demi_task_alloc(demi_task_fn fn, uint64_t payloadSize);
+
+    // Makes a task available to be run by any worker.
+    void demi_task_spawn(void *payload);
+
+    // Returns once the task has been run, running other tasks in the meantime.
+    void demi_task_await(void *payload);
+
+    // Frees a task allocated with demi_task_alloc.
+    void demi_task_free(void *payload);
+
+    // Returns the number of tasks allocated and not yet freed, the garbage collector only runs when there are none.
+    uint64_t demi_task_live();
+
+}
+
+#endif
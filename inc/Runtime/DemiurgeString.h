@@ -0,0 +1,83 @@
+#ifndef _DEMIURGE_STRING_H
+#define _DEMIURGE_STRING_H
+
+/*
+ *  The runtime representation of 'string'.
+ *
+ *  A string is 24 bytes passed around by value and comes in four kinds:
+ *    - inline: up to 22 chars stored in the string itself followed by a NUL, the last byte holds the length.
+ *    - heap: chars in a reference counted buffer shared by every copy of the string.
+ *    - static: chars of a literal, never freed.
+ *    - view: chars inside memory owned by something else, e.g. a line of a mapped file, with no NUL after them.
+ *  The kind lives in the top bits of the last byte, which on little endian targets is the top byte of
+ *  'Capacity', so a zeroed string is the empty inline string. The rest of a view's 'Capacity' points to
+ *  the reference counted owner of its chars, which every copy of the view keeps alive.
+ *
+ *  Buffers are copy on write: appending to a string whose buffer is only referenced by it grows the buffer
+ *  in place geometrically, anything else copies first. Chars other than a view's are NUL terminated so a
+ *  string can be handed to C as is, a view is copied for C.
+ *
+ *  Generated code passes strings by address: 'result' arguments are written without releasing what they held.
+ */
+
+#include <atomic>
+#include <stdint.h>
+
+struct DemiString {
+    char *Data;
+    uint64_t Length;
+    uint64_t Capacity;
+};
+
+// Kinds, tagged in the top byte of 'Capacity'. The compiler builds static strings for literals itself.
+#define DEMI_STRING_KIND_MASK   (0xC0ull << 56)
+#define DEMI_STRING_KIND_HEAP   (0x80ull << 56)
+#define DEMI_STRING_KIND_STATIC (0x40ull << 56)
+#define DEMI_STRING_KIND_VIEW   (0xC0ull << 56)
+
+// What the chars of views belong to, embedded at the start of e.g. an open file. It starts out with one reference,
+// its creator's, every view holds another and 'Destroy' runs when the last one is dropped.
+struct DemiStringOwner {
+    std::atomic<uint64_t> RefCount;
+    void (*Destroy)(DemiStringOwner *owner);
+};
+
+extern "C" {
+
+    // Adds a reference to a string's buffer, or to the owner of a view's chars.
+    void demi_string_retain(const DemiString *str);
+
+    // Drops a reference to a string's buffer or a view's owner, freeing it with the last one, and empties the string.
+    void demi_string_release(DemiString *str);
+
+    // Makes 'dst' share 'src', releasing what 'dst' held.
+    void demi_string_assign(DemiString *dst, const DemiString *src);
+
+    // Writes 'lhs' followed by 'rhs' to 'result'.
+    void demi_string_concat(DemiString *result, const DemiString *lhs, const DemiString *rhs);
+
+    // Appends 'src' to 'dst', in place when 'dst' owns its buffer alone.
+    void demi_string_append(DemiString *dst, const DemiString *src);
+
+    // Returns the NUL terminated chars of a string, valid while the string is. A view is copied into 'copy'
+    // first, which must be empty and is left empty otherwise.
+    const char *demi_string_cstr(const DemiString *str, DemiString *copy);
+
+    // Returns the length of a string.
+    uint64_t demi_string_length(const DemiString *str);
+
+    // Returns the chars of a string, 'length' of them, valid while the string is. A view's aren't NUL terminated.
+    const char *demi_string_data(const DemiString *str);
+
+    // Writes a copy of a C string to 'result'.
+    void demi_string_from_cstr(DemiString *result, const char *cstr);
+
+    // Writes a view of 'length' chars belonging to 'owner' to 'result', adding a reference to 'owner'.
+    void demi_string_view(DemiString *result, DemiStringOwner *owner, const char *chars, uint64_t length);
+
+    // Drops a reference to the owner of views, destroying it with the last one.
+    void demi_string_owner_release(DemiStringOwner *owner);
+
+}
+
+#endif
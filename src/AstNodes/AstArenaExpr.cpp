@@ -0,0 +1,53 @@
+#include "llvm/IR/Module.h"
+
+#include "AstNodes/AstArenaExpr.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+
+using namespace llvm;
+
+AstArenaExpr::AstArenaExpr(const std::vector<IAstExpression*> &body, int line, int column)
+    : Body(body) {
+    setNodeType(node_arena);
+    setPos(PossiblePosition{ line, column });
+}
+AstArenaExpr::~AstArenaExpr() {
+    while (!Body.empty()) delete Body.back(), Body.pop_back();
+}
+
+Value *AstArenaExpr::CodegenDestroy(CodeGenerator *codegen, Value *arena) {
+    IRBuilder<> &builder = codegen->getBuilder();
+    std::vector<Type*> arenaArg(1, builder.getInt8PtrTy());
+    Constant *arenaDestroy = Helpers::GetRuntimeFunction(codegen, "demi_arena_destroy", builder.getVoidTy(), arenaArg);
+    return builder.CreateCall(arenaDestroy, arena);
+}
+
+Value *AstArenaExpr::Codegen(CodeGenerator *codegen) {
+    IRBuilder<> &builder = codegen->getBuilder();
+    if (codegen->getUseGC()) {
+        Helpers::Warning(this->getPos(), "'arena' has no effect with -gc, 'new' allocates from the collected heap.");
+    }
+    Constant *arenaCreate = Helpers::GetRuntimeFunction(codegen, "demi_arena_create", builder.getInt8PtrTy(), std::vector<Type*>());
+    Value *arena = builder.CreateCall(arenaCreate, "arena");
+
+    codegen->pushArena(arena);
+    std::vector<Value*> vals = Helpers::EmitScopeBlock(codegen, this->Body);
+    codegen->popArena();
+    if (vals.empty() && !this->Body.empty()) {
+        return nullptr;
+    }
+    if (builder.GetInsertBlock()->getTerminator() != nullptr) { // left by a 'return', which already freed the arena.
+        return arena;
+    }
+    return CodegenDestroy(codegen, arena);
+}
+
+IAstExpression *AstArenaExpr::Simplify(AstSimplifier *simplifier) {
+    simplifier->SimplifyBlock(this->Body);
+    return this;
+}
+
+const std::vector<IAstExpression*> &AstArenaExpr::getBody() const {
+    return Body;
+}
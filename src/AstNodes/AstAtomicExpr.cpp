@@ -0,0 +1,144 @@
+#include "llvm/IR/Module.h"
+
+#include "AstNodes/AstAtomicExpr.h"
+#include "AstNodes/AstVariableNode.h"
+#include "AstNodes/AstVisitor.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+
+using namespace llvm;
+
+AstAtomicExpr::AstAtomicExpr(const std::string &name, const std::vector<IAstExpression*> &args, int line, int column)
+    : Name(name)
+    , Args(args) {
+    setNodeType(node_atomic);
+    setPos(PossiblePosition{ line, column });
+}
+AstAtomicExpr::~AstAtomicExpr() {
+    while (!Args.empty()) delete Args.back(), Args.pop_back();
+}
+
+// Number of arguments each builtin takes, not counting the ordering.
+static const std::map<std::string, unsigned> &getAtomicBuiltins() {
+    static const std::map<std::string, unsigned> builtins = {
+        { "atomic_fence", 0 },
+        { "atomic_load", 1 },
+        { "atomic_store", 2 },
+        { "atomic_exchange", 2 },
+        { "atomic_add", 2 },
+        { "atomic_sub", 2 },
+        { "atomic_and", 2 },
+        { "atomic_or", 2 },
+        { "atomic_xor", 2 },
+        { "atomic_cas", 3 },
+    };
+    return builtins;
+}
+
+bool AstAtomicExpr::IsAtomicBuiltin(const std::string &name) {
+    return getAtomicBuiltins().count(name) != 0;
+}
+
+// Sets 'ordering' and returns true if the expression names a memory ordering.
+static bool tryGetOrdering(IAstExpression *expr, AtomicOrdering *ordering) {
+    AstVariableNode *variable = AstCast<AstVariableNode>(expr);
+    if (variable == nullptr) {
+        return false;
+    }
+    const std::string &name = variable->getName();
+    if (name == "relaxed") { *ordering = Monotonic; }
+    else if (name == "acquire") { *ordering = Acquire; }
+    else if (name == "release") { *ordering = Release; }
+    else if (name == "acq_rel") { *ordering = AcquireRelease; }
+    else if (name == "seq_cst") { *ordering = SequentiallyConsistent; }
+    else { return false; }
+    return true;
+}
+
+Value *AstAtomicExpr::Codegen(CodeGenerator *codegen) {
+    IRBuilder<> &builder = codegen->getBuilder();
+    AtomicOrdering ordering = SequentiallyConsistent;
+    unsigned argCount = this->Args.size();
+    if (argCount != 0 && tryGetOrdering(this->Args.back(), &ordering)) {
+        argCount--;
+    }
+    if (argCount != getAtomicBuiltins().at(this->Name)) {
+        return Helpers::Error(this->getPos(), "Incorrect number of arguments passed to '%s'.", this->Name.c_str());
+    }
+
+    if (this->Name == "atomic_fence") {
+        if (ordering == Monotonic) {
+            return Helpers::Error(this->getPos(), "'atomic_fence' cannot be relaxed.");
+        }
+        return builder.CreateFence(ordering);
+    }
+
+    Value *address = Helpers::GetLValueAddress(codegen, this->Args[0]);
+    if (address == nullptr) {
+        return Helpers::Error(this->Args[0]->getPos(), "First argument of '%s' must be a variable or an array element.", this->Name.c_str());
+    }
+    Type *type = address->getType()->getPointerElementType();
+    if (!type->isIntegerTy() || type->isIntegerTy(1)) {
+        return Helpers::Error(this->Args[0]->getPos(), "'%s' needs an integer, got '%s'.", this->Name.c_str(),
+            Helpers::GetLLVMTypeName(type).c_str());
+    }
+
+    if (this->Name == "atomic_load") {
+        if (ordering == Release || ordering == AcquireRelease) {
+            return Helpers::Error(this->getPos(), "'atomic_load' cannot have release ordering.");
+        }
+        return Helpers::CreateAtomicLoad(codegen, address, ordering);
+    }
+
+    std::vector<Value*> vals;
+    for (unsigned i = 1; i < argCount; ++i) {
+        Value *val = this->Args[i]->Codegen(codegen);
+        if (val == nullptr) {
+            return Helpers::Error(this->Args[i]->getPos(), "Argument of '%s' could not be evaluated.", this->Name.c_str());
+        }
+        val = Helpers::CreateImplicitCast(codegen, val, type);
+        if (val == nullptr) {
+            return Helpers::Error(this->Args[i]->getPos(), "Argument of '%s' could not be cast to '%s'.", this->Name.c_str(),
+                Helpers::GetLLVMTypeName(type).c_str());
+        }
+        vals.push_back(val);
+    }
+
+    if (this->Name == "atomic_store") {
+        if (ordering == Acquire || ordering == AcquireRelease) {
+            return Helpers::Error(this->getPos(), "'atomic_store' cannot have acquire ordering.");
+        }
+        return Helpers::CreateAtomicStore(codegen, vals[0], address, ordering);
+    }
+    if (this->Name == "atomic_exchange") {
+        return builder.CreateAtomicRMW(AtomicRMWInst::Xchg, address, vals[0], ordering);
+    }
+    if (this->Name == "atomic_cas") {
+        Value *result = builder.CreateAtomicCmpXchg(address, vals[0], vals[1], ordering, 
+            Helpers::GetCmpXchgFailureOrdering(ordering));
+        return builder.CreateExtractValue(result, 1, "cas");
+    }
+
+    TokenType operation;
+    if (this->Name == "atomic_add") { operation = (TokenType)'+'; }
+    else if (this->Name == "atomic_sub") { operation = (TokenType)'-'; }
+    else if (this->Name == "atomic_and") { operation = (TokenType)'&'; }
+    else if (this->Name == "atomic_or") { operation = (TokenType)'|'; }
+    else { operation = (TokenType)'^'; } // atomic_xor
+    return Helpers::CreateAtomicUpdate(codegen, operation, address, vals[0], false, ordering);
+}
+
+IAstExpression *AstAtomicExpr::Simplify(AstSimplifier *simplifier) {
+    for (unsigned i = 0, size = this->Args.size(); i < size; ++i) { // the first argument is operated on.
+        this->Args[i] = i == 0 ? simplifier->SimplifyLValue(this->Args[i]) : simplifier->Simplify(this->Args[i]);
+    }
+    return this;
+}
+
+const std::string &AstAtomicExpr::getName() const {
+    return Name;
+}
+const std::vector<IAstExpression*> &AstAtomicExpr::getArgs() const {
+    return Args;
+}
@@ -0,0 +1,61 @@
+#include "llvm/IR/Module.h"
+
+#include "AstNodes/AstAwaitExpr.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "DEFINES.h"
+#include "Compiler/AstSimplifier.h"
+
+using namespace llvm;
+
+AstAwaitExpr::AstAwaitExpr(IAstExpression *future, int line, int column)
+    : Future(future) {
+    setNodeType(node_await);
+    setPos(PossiblePosition{ line, column });
+}
+AstAwaitExpr::~AstAwaitExpr() {
+    delete Future;
+}
+
+Value *AstAwaitExpr::Codegen(CodeGenerator *codegen) {
+    Value *future = this->Future->Codegen(codegen);
+    if (future == nullptr) {
+        return nullptr;
+    }
+    StructType *futureType = nullptr;
+    if (future->getType()->isPointerTy()) {
+        futureType = dyn_cast<StructType>(future->getType()->getPointerElementType());
+    }
+    if (futureType == nullptr || !futureType->hasName() || !futureType->getName().startswith(FUTURE_TYPE_PREFIX)) {
+        return Helpers::Error(this->getPos(), "Cannot await '%s', expected the result of a 'spawn'.",
+            Helpers::GetLLVMTypeName(future->getType()).c_str());
+    }
+
+    IRBuilder<> &builder = codegen->getBuilder();
+    Type *payloadType = builder.getInt8PtrTy();
+    std::vector<Type*> payloadArg(1, payloadType);
+    Constant *taskAwait = Helpers::GetRuntimeFunction(codegen, "demi_task_await", builder.getVoidTy(), payloadArg);
+    Constant *taskFree = Helpers::GetRuntimeFunction(codegen, "demi_task_free", builder.getVoidTy(), payloadArg);
+
+    Value *payload = builder.CreateBitCast(future, payloadType);
+    Value *result = builder.CreateCall(taskAwait, payload);
+    Type *resultType = futureType->getElementType(0);
+    bool isVoidResult = resultType->isStructTy() && cast<StructType>(resultType)->getNumElements() == 0;
+    if (!isVoidResult) {
+        result = builder.CreateLoad(builder.CreateStructGEP(future, 0), "awaited");
+        if (Helpers::ContainsString(codegen, resultType)) { // the task's references are handed over.
+            result = Helpers::CreateOwnedString(codegen, result);
+        }
+    }
+    builder.CreateCall(taskFree, payload);
+    return result;
+}
+
+IAstExpression *AstAwaitExpr::Simplify(AstSimplifier *simplifier) {
+    this->Future = simplifier->Simplify(this->Future);
+    return this;
+}
+
+IAstExpression *AstAwaitExpr::getFuture() const {
+    return Future;
+}
@@ -1,11 +1,18 @@
 //#include "llvm/IR/Type.h"
 //#include "llvm/IR/Value.h"
+#include <algorithm>
 
 #include "AstNodes/AstBinaryOperatorExpr.h"
+#include "AstNodes/AstCallExpr.h"
+#include "AstNodes/AstStringNode.h"
 #include "AstNodes/AstUnaryOperatorExpr.h"
 #include "AstNodes/AstVariableNode.h"
+#include "AstNodes/ClassAst.h"
+#include "AstNodes/AstVisitor.h"
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+#include "Compiler/AstTypeChecker.h"
 
 using namespace llvm;
 
@@ -14,7 +21,8 @@ AstBinaryOperatorExpr::AstBinaryOperatorExpr(const std::string &operStr, TokenTy
     : OperatorString(operStr)
     , Operator(oper)
     , LHS(lhs)
-    , RHS(rhs) {
+    , RHS(rhs)
+    , OperandType(node_default) {
     setNodeType(node_binary_operation);
     setPos(PossiblePosition{ line, column });
 }
@@ -27,7 +35,7 @@ Value *AstBinaryOperatorExpr::VariableAssignment(CodeGenerator *codegen) {
         return nullptr;
     }
 
-    if (AstUnaryOperatorExpr *unary = dynamic_cast<AstUnaryOperatorExpr*>(this->LHS)) {
+    if (AstUnaryOperatorExpr *unary = AstCast<AstUnaryOperatorExpr>(this->LHS)) {
         if (unary->getOperator() == '[') {
             return unary->ArrayAssignment(codegen, this->RHS); // Array assignment.
         }
@@ -36,7 +44,22 @@ Value *AstBinaryOperatorExpr::VariableAssignment(CodeGenerator *codegen) {
         }
     }
 
-    AstVariableNode *lhse = dynamic_cast<AstVariableNode*>(this->LHS);
+    AstBinaryOperatorExpr *member = AstCast<AstBinaryOperatorExpr>(this->LHS);
+    if (member != nullptr && member->getOperator() == '.') { // Field assignment.
+        Value *val = this->RHS->Codegen(codegen);
+        if (val == nullptr) {
+            return Helpers::Error(this->RHS->getPos(), "Right operand could not be evaluated.");
+        }
+        Value *field = member->MemberAddress(codegen);
+        if (field == nullptr) {
+            return nullptr;
+        }
+        val = Helpers::CreateImplicitCast(codegen, val, field->getType()->getPointerElementType());
+        Helpers::CreateAssignmentStore(codegen, val, field);
+        return val;
+    }
+
+    AstVariableNode *lhse = AstCast<AstVariableNode>(this->LHS);
     if (lhse == nullptr) { // left side of assign operator isn't a variable.
         return Helpers::Error(this->LHS->getPos(), "Destination of assignment operator must be variable.");
     }
@@ -49,16 +72,20 @@ Value *AstBinaryOperatorExpr::VariableAssignment(CodeGenerator *codegen) {
 
     // Lookup the name of the variable
     
-    Value *variable = codegen->getNamedValue(lhse->getName());
+    Value *variable = codegen->getNamedValue(lhse->getNameId());
     if (variable == nullptr) {
         return Helpers::Error(this->getPos(), "Unknown variable name '%s'", lhse->getName().c_str());
     }
 
+    if (Helpers::IsAtomicLValue(codegen, lhse)) {
+        return Helpers::CreateAtomicStore(codegen, val, variable, SequentiallyConsistent);
+    }
+
     // Implicit casting to destination type when assigning to variables.
     Type *varType = variable->getType()->getContainedType(0);
     val = Helpers::CreateImplicitCast(codegen, val, varType);
 
-    codegen->getBuilder().CreateStore(val, variable);
+    Helpers::CreateAssignmentStore(codegen, val, variable);
     return val;
 }
 
@@ -108,16 +135,190 @@ Value *AstBinaryOperatorExpr::VariableOpAssignment(CodeGenerator *codegen) {
         operStr = ">>";
         break;
     }
+    if (Helpers::IsAtomicLValue(codegen, this->LHS)) { // the read, operation and write must happen as one.
+        return AtomicOpAssignment(codegen, operation, operStr);
+    }
+    AstVariableNode *variable = AstCast<AstVariableNode>(this->LHS);
+    AllocaInst *address = variable != nullptr ? codegen->getNamedValue(variable->getNameId()) : nullptr;
+    if (operation == '+' && address != nullptr && Helpers::IsStringType(codegen, address->getAllocatedType())) {
+        // appended in place rather than building a new string and assigning it.
+        Value *val = this->RHS->Codegen(codegen);
+        if (val == nullptr) {
+            return Helpers::Error(this->RHS->getPos(), "Right operand could not be evaluated.");
+        }
+        if (!Helpers::IsStringType(codegen, val->getType())) {
+            return Helpers::Error(this->RHS->getPos(), "Only a string can be appended to a string, got '%s'.",
+                Helpers::GetLLVMTypeName(val->getType()).c_str());
+        }
+        return Helpers::CreateStringAppend(codegen, address, val);
+    }
     int line = this->LHS->getPos().LineNumber;
     int column = this->LHS->getPos().ColumnNumber;
     // Doing a trick here where we just expand the operation. e.g x += 5 -> x = (x + 5)
     AstBinaryOperatorExpr *eval = new AstBinaryOperatorExpr(operStr, operation, this->LHS, this->RHS, line, column);
+    eval->setOperandType(this->OperandType);
     AstBinaryOperatorExpr *assign = new AstBinaryOperatorExpr("=", (TokenType)'=', this->LHS, eval, line, column);
     return assign->Codegen(codegen);
 }
 
+Value *AstBinaryOperatorExpr::AtomicOpAssignment(CodeGenerator *codegen, TokenType operation, const std::string &operStr) {
+    Value *val = this->RHS->Codegen(codegen);
+    if (val == nullptr) {
+        return Helpers::Error(this->RHS->getPos(), "Right operand could not be evaluated.");
+    }
+    Value *address = Helpers::GetLValueAddress(codegen, this->LHS);
+    if (address == nullptr) {
+        return nullptr;
+    }
+    bool isUnsigned = Helpers::IsUnsigned(AstTypeChecker::GetType(this->LHS)) && Helpers::IsUnsigned(AstTypeChecker::GetType(this->RHS));
+    Value *updated = nullptr;
+    if (Helpers::CreateAtomicUpdate(codegen, operation, address, val, isUnsigned, SequentiallyConsistent, &updated) == nullptr) {
+        return Helpers::Error(this->getPos(), "Operator '%s' does not exist for atomic '%s' and '%s'", operStr.c_str(),
+            Helpers::GetLLVMTypeName(address->getType()->getPointerElementType()).c_str(), Helpers::GetLLVMTypeName(val->getType()).c_str());
+    }
+    return updated;
+}
+
+Value *AstBinaryOperatorExpr::MemberAddress(CodeGenerator *codegen, Value **string) {
+    AstVariableNode *fieldName = AstCast<AstVariableNode>(this->RHS);
+    if (fieldName == nullptr) {
+        return Helpers::Error(this->RHS->getPos(), "Expected a field name after '.'.");
+    }
+    IRBuilder<> &builder = codegen->getBuilder();
+    Value *instance;
+    AstUnaryOperatorExpr *element = AstCast<AstUnaryOperatorExpr>(this->LHS);
+    if (element != nullptr && element->getOperator() == '[') {
+        // Elements of a struct-of-arrays only exist field by field, so the field selects the array to index.
+        bool usedField = false;
+        instance = element->ElementAddress(codegen, fieldName->getName(), &usedField);
+        if (instance == nullptr || usedField) {
+            return instance;
+        }
+    }
+    else {
+        instance = Helpers::GetLValueAddress(codegen, this->LHS);
+    }
+    ClassAst *classAst = nullptr;
+    instance = this->InstanceAddress(codegen, instance, &classAst);
+    if (instance == nullptr) {
+        return nullptr;
+    }
+    if (classAst == nullptr) { // a string.
+        if (fieldName->getName() != "length") {
+            return Helpers::Error(this->RHS->getPos(), "A string has no field '%s', only a 'length'.", fieldName->getName().c_str());
+        }
+        if (string == nullptr) {
+            return Helpers::Error(this->RHS->getPos(), "The 'length' of a string can't be assigned.");
+        }
+        *string = instance;
+        return instance;
+    }
+    int index = classAst->getFieldIndex(fieldName->getName());
+    if (index < 0) {
+        return Helpers::Error(this->RHS->getPos(), "Class '%s' has no field '%s'.", classAst->getName().c_str(), fieldName->getName().c_str());
+    }
+    if (classAst->getIsPrivate(fieldName->getName()) && codegen->getCurrentClass() != classAst) {
+        return Helpers::Error(this->RHS->getPos(), "Field '%s' of class '%s' is private.", fieldName->getName().c_str(), classAst->getName().c_str());
+    }
+    return builder.CreateStructGEP(instance, index, fieldName->getName());
+}
+
+Value *AstBinaryOperatorExpr::InstanceAddress(CodeGenerator *codegen, Value *instance, ClassAst **classAst) {
+    IRBuilder<> &builder = codegen->getBuilder();
+    if (instance == nullptr) { // not assignable, e.g. the result of a call, so give it a temporary home.
+        Value *val = this->LHS->Codegen(codegen);
+        if (val == nullptr) {
+            return nullptr;
+        }
+        instance = Helpers::CreateEntryBlockAlloca(codegen, codegen->getCurrentFunction(), "tmp", val->getType());
+        builder.CreateStore(val, instance);
+    }
+    Type *type = instance->getType()->getPointerElementType();
+    if (Helpers::IsStringType(codegen, type)) {
+        *classAst = nullptr;
+        return instance;
+    }
+    if (type->isPointerTy()) { // a reference to an instance is implicitly dereferenced.
+        instance = builder.CreateLoad(instance);
+        type = type->getPointerElementType();
+    }
+    StructType *structType = dyn_cast<StructType>(type);
+    *classAst = structType != nullptr && structType->hasName() ? codegen->getClass(structType->getName()) : nullptr;
+    if (*classAst == nullptr) {
+        return Helpers::Error(this->getPos(), "Left side of '.' is not a class instance, got '%s'.", 
+            Helpers::GetLLVMTypeName(type).c_str());
+    }
+    return instance;
+}
+
+Value *AstBinaryOperatorExpr::MethodCall(CodeGenerator *codegen, AstCallExpression *call) {
+    ClassAst *classAst = nullptr;
+    Value *instance = this->InstanceAddress(codegen, Helpers::GetLValueAddress(codegen, this->LHS), &classAst);
+    if (instance == nullptr) {
+        return nullptr;
+    }
+    if (classAst == nullptr) {
+        return Helpers::Error(call->getPos(), "A string has no method '%s'.", call->getName().c_str());
+    }
+    Function *method = classAst->getMethod(call->getName());
+    if (method == nullptr) {
+        return Helpers::Error(call->getPos(), "Class '%s' has no method '%s'.", classAst->getName().c_str(), call->getName().c_str());
+    }
+    if (classAst->getIsPrivate(call->getName()) && codegen->getCurrentClass() != classAst) {
+        return Helpers::Error(call->getPos(), "Method '%s' of class '%s' is private.", call->getName().c_str(), classAst->getName().c_str());
+    }
+    if (method->arg_size() != call->getArgCount() + 1) {
+        return Helpers::Error(call->getPos(), "Incorrect number of arguments passed to method '%s'", call->getName().c_str());
+    }
+    std::vector<Value*> argsvals(1, instance);
+    if (!call->CodegenArguments(codegen, method, argsvals)) {
+        return nullptr;
+    }
+    // Nothing can derive from a class so an instance's dynamic class is always its static class, even virtual
+    // methods are called directly, which keeps every method call inlinable and instances free of a vtable pointer.
+    bool isVoidReturn = method->getReturnType()->isVoidTy();
+    return call->CodegenResult(codegen, method, codegen->getBuilder().CreateCall(method, argsvals, isVoidReturn ? "" : "call"));
+}
+
+Value *AstBinaryOperatorExpr::MemberAccess(CodeGenerator *codegen) {
+    Value *string = nullptr;
+    Value *field = this->MemberAddress(codegen, &string);
+    if (field == nullptr) {
+        return nullptr;
+    }
+    if (string != nullptr) { // 'length', kept by the string so reading it is constant time.
+        return Helpers::CreateStringLength(codegen, string);
+    }
+    if (Helpers::IsPtrToArray(field) || codegen->getSoaClass(field->getType()->getPointerElementType()) != nullptr) {
+        // arrays are referred to by address, same as array variables.
+        return field;
+    }
+    return codegen->getBuilder().CreateLoad(field, "field");
+}
+
+TokenType AstBinaryOperatorExpr::getOperator() const {
+    return Operator;
+}
+IAstExpression *AstBinaryOperatorExpr::getLHS() const {
+    return LHS;
+}
+IAstExpression *AstBinaryOperatorExpr::getRHS() const {
+    return RHS;
+}
+AstNodeType AstBinaryOperatorExpr::getOperandType() const {
+    return OperandType;
+}
+void AstBinaryOperatorExpr::setOperandType(AstNodeType type) {
+    OperandType = type;
+}
+
 Value *AstBinaryOperatorExpr::Codegen(CodeGenerator *codegen) {
     switch (this->Operator) {
+    case '.':
+        if (AstCallExpression *call = AstCast<AstCallExpression>(this->RHS)) {
+            return this->MethodCall(codegen, call);
+        }
+        return this->MemberAccess(codegen);
     case '=':
         return this->VariableAssignment(codegen);
     case tok_plusequals:            // '+='
@@ -133,16 +334,34 @@ Value *AstBinaryOperatorExpr::Codegen(CodeGenerator *codegen) {
         return this->VariableOpAssignment(codegen);
     }
     Value *l = this->LHS->Codegen(codegen);
+    bool isRHSPure = AstCast<AstStringNode>(this->RHS) != nullptr || AstCast<AstVariableNode>(this->RHS) != nullptr;
+    if (l != nullptr && isa<LoadInst>(l) && Helpers::IsStringType(codegen, l->getType()) && !isRHSPure) {
+        // the right operand may assign or append to where the string was loaded from, e.g. 'x + (x += "a")'.
+        l = Helpers::CreateStringCapture(codegen, l);
+    }
     Value *r = this->RHS->Codegen(codegen);
     if (l == nullptr || r == nullptr) {
         return Helpers::Error(this->getPos(), "Could not evaluate expression!");
     }
     Type *lType = l->getType();
     Type *rType = r->getType();
+    if (this->Operator == '+' && Helpers::IsStringType(codegen, lType) && Helpers::IsStringType(codegen, rType)) {
+        return Helpers::CreateStringConcat(codegen, l, r);
+    }
+    AstNodeType lResolved = AstTypeChecker::GetType(this->LHS);
+    AstNodeType rResolved = AstTypeChecker::GetType(this->RHS);
     if (lType->isIntegerTy() && rType->isIntegerTy()) {
-        Helpers::NormalizeIntegerWidths(codegen, l, r);
+        // widened to the type resolved by the type checker. Operands whose type it can't tell, e.g. fields, are
+        // widened to the larger of the two as signed.
+        unsigned bitWidth = AstTypeChecker::IsInteger(this->OperandType) ? AstTypeChecker::GetBitWidth(this->OperandType)
+            : std::max(lType->getIntegerBitWidth(), rType->getIntegerBitWidth());
+        Type *type = Type::getIntNTy(codegen->getContext(), bitWidth);
+        l = codegen->getBuilder().CreateIntCast(l, type, !Helpers::IsUnsigned(lResolved), "widen");
+        r = codegen->getBuilder().CreateIntCast(r, type, !Helpers::IsUnsigned(rResolved), "widen");
+        lType = l->getType();
+        rType = r->getType();
     }
-    bool isUnsigned = Helpers::IsUnsigned(this->LHS->getNodeType()) && Helpers::IsUnsigned(this->RHS->getNodeType());
+    bool isUnsigned = Helpers::IsUnsigned(lResolved) && Helpers::IsUnsigned(rResolved);
     auto funcPtr = Helpers::GetBinopCodeGenFuncPointer(this->Operator, lType, rType, isUnsigned);
     if (funcPtr == nullptr) {
         return Helpers::Error(this->getPos(), "Operator '%s' does not exist for '%s' and '%s'",
@@ -153,3 +372,32 @@ Value *AstBinaryOperatorExpr::Codegen(CodeGenerator *codegen) {
 
 
 
+
+IAstExpression *AstBinaryOperatorExpr::Simplify(AstSimplifier *simplifier) {
+    switch (this->Operator) {
+    case '.': // the right names a field, or is a method call whose arguments are simplified.
+        this->LHS = simplifier->Simplify(this->LHS);
+        if (AstCallExpression *call = AstCast<AstCallExpression>(this->RHS)) {
+            call->Simplify(simplifier);
+        }
+        return this;
+    case '=':
+    case tok_plusequals:
+    case tok_minusequals:
+    case tok_multequals:
+    case tok_divequals:
+    case tok_modequals:
+    case tok_andequals:
+    case tok_orequals:
+    case tok_xorequals:
+    case tok_leftshiftequal:
+    case tok_rightshiftequal:
+        this->LHS = simplifier->SimplifyLValue(this->LHS);
+        this->RHS = simplifier->Simplify(this->RHS);
+        return this;
+    }
+    this->LHS = simplifier->Simplify(this->LHS);
+    this->RHS = simplifier->Simplify(this->RHS);
+    IAstExpression *folded = simplifier->FoldBinary(this->Operator, this->LHS, this->RHS, this->getPos());
+    return folded != nullptr ? folded : this;
+}
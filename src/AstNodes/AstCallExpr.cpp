@@ -1,14 +1,65 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Module.h"
+#include <climits>
 
 #include "AstNodes/AstCallExpr.h"
+#include "AstNodes/GenericFunctionAst.h"
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+#include "Compiler/AstTypeChecker.h"
 
 
 using namespace llvm;
 
-AstCallExpression::AstCallExpression(const std::string &name, const std::vector<IAstExpression*> &args, int line, int column)
+namespace {
+
+    // What an implicit conversion of an argument costs. Any narrowing conversion costs more than widening every
+    // argument, so a call picks the overload that widens over one that narrows.
+    const unsigned CONVERSION_COST = 1;
+    const unsigned NARROWING_COST = 1 << 16;
+
+    // Returns whether converting a number of type 'type' to 'paramType' keeps every value.
+    bool isWidening(Type *type, Type *paramType) {
+        if (type->isIntegerTy() && paramType->isIntegerTy()) {
+            return type->getIntegerBitWidth() < paramType->getIntegerBitWidth();
+        }
+        return paramType->isDoubleTy() || (paramType->isFloatingPointTy() && !type->isDoubleTy());
+    }
+
+    // The cost of the implicit conversions needed to pass 'vals' to 'callee', 'argTypes' are the arguments' types
+    // resolved by the type checker. Returns UINT_MAX if they can't be passed.
+    unsigned conversionCost(const FunctionOverload &callee, const std::vector<Value*> &vals, const std::vector<AstNodeType> &argTypes) {
+        if (callee.Func->arg_size() != vals.size()) {
+            return UINT_MAX;
+        }
+        unsigned cost = 0;
+        FunctionType *funcType = callee.Func->getFunctionType();
+        for (unsigned i = 0, size = vals.size(); i < size; ++i) {
+            Type *type = vals[i]->getType();
+            Type *paramType = funcType->getParamType(i);
+            if (Helpers::IsPtrToArray(vals[i])) { // arrays are passed as a pointer to their first element.
+                type = type->getPointerElementType()->getArrayElementType()->getPointerTo();
+            }
+            if (type == paramType) { // the same integers of a different signedness are converted too.
+                bool isConverted = AstTypeChecker::IsInteger(argTypes[i]) && AstTypeChecker::IsInteger(callee.ParamTypes[i])
+                    && Helpers::IsUnsigned(argTypes[i]) != Helpers::IsUnsigned(callee.ParamTypes[i]);
+                cost += isConverted ? CONVERSION_COST : 0;
+                continue;
+            }
+            bool isNumber = type->isIntegerTy() || type->isFloatingPointTy();
+            bool isNumberParam = paramType->isIntegerTy() || paramType->isFloatingPointTy();
+            if (!isNumber || !isNumberParam) {
+                return UINT_MAX;
+            }
+            cost += isWidening(type, paramType) ? CONVERSION_COST : NARROWING_COST;
+        }
+        return cost;
+    }
+
+}
+
+AstCallExpression::AstCallExpression(NameTable::NameId name, const std::vector<IAstExpression*> &args, int line, int column)
     : Name(name)
     , Args(args) {
     setNodeType(node_call);
@@ -19,43 +70,189 @@ AstCallExpression::~AstCallExpression() {
 }
 
 const std::string &AstCallExpression::getName() const {
+    return NameTable::GetName(Name); 
+}
+NameTable::NameId AstCallExpression::getNameId() const {
     return Name; 
 }
+unsigned AstCallExpression::getArgCount() const {
+    return Args.size();
+}
+const std::vector<IAstExpression*> &AstCallExpression::getArgs() const {
+    return Args;
+}
 
-Value *AstCallExpression::Codegen(CodeGenerator *codegen) {
+Function *AstCallExpression::GetCallee(CodeGenerator *codegen) {
+    if (codegen->getGenericFunction(this->getName()) != nullptr) { // instantiated for the arguments' types by Codegen.
+        return Helpers::Error(this->getPos(), "Generic function '%s' can only be called directly.", this->getName().c_str());
+    }
+    if (codegen->getOverloads(this->getName()) != nullptr) { // resolved by the arguments' types by Codegen.
+        return Helpers::Error(this->getPos(), "Overloaded function '%s' can only be called directly.", this->getName().c_str());
+    }
     // Lookup the name in the global module table.
-    Function *CalleeF = codegen->getTheModule()->getFunction(this->Name);
+    Function *CalleeF = codegen->getTheModule()->getFunction(this->getName());
     if (CalleeF == nullptr) {
-        return Helpers::Error(this->getPos(), "Unknown function, '%s', referenced.", this->Name.c_str());
+        CalleeF = Helpers::GetBuiltinFunction(codegen, this->getName());
+    }
+    if (CalleeF == nullptr) {
+        return Helpers::Error(this->getPos(), "Unknown function, '%s', referenced.", this->getName().c_str());
     }
 
     // If argument count is mismatched
     if (CalleeF->arg_size() != Args.size() && !CalleeF->isVarArg()) {
-        return Helpers::Error(this->getPos(), "Incorrect number of arguments passed to function '%s'", this->Name.c_str());
+        return Helpers::Error(this->getPos(), "Incorrect number of arguments passed to function '%s'", this->getName().c_str());
     }
-    std::vector<Value*> argsvals;
+    return CalleeF;
+}
+
+bool AstCallExpression::CodegenArguments(CodeGenerator *codegen, Function *CalleeF, std::vector<Value*> &argsvals) {
     auto calleeArg = CalleeF->arg_begin();
-    for (unsigned i = 0, len = this->Args.size(); i < len; ++i, ++calleeArg){
+    std::advance(calleeArg, argsvals.size());
+    for (unsigned i = 0, len = this->Args.size(); i < len; ++i) {
         Value *val = this->Args[i]->Codegen(codegen);
         if (val == nullptr) {
-            return Helpers::Error(this->Args[i]->getPos(), "Function argument could not be evaulated.");
-        }
-        bool castSuccess = false;
-        if (!CalleeF->isVarArg() && Helpers::IsNumberType(val)) { // don't try to cast varargs or anything not a number.
-            val = Helpers::CreateImplicitCast(codegen, val, calleeArg->getType(), &castSuccess);
+            Helpers::Error(this->Args[i]->getPos(), "Function argument could not be evaulated.");
+            return false;
         }
-        if (Helpers::IsPtrToArray(val)) { // if the argument is a pointer to an array
-            val = Helpers::CreateArrayDecay(codegen, val); // converts the argument to a pointer to the first element in the array
+        val = CastArgument(codegen, CalleeF, argsvals.size(), val, this->Args[i]);
+        if (val == nullptr) {
+            return false;
         }
+        argsvals.push_back(val);
+    }
+    return true;
+}
+Value *AstCallExpression::CastArgument(CodeGenerator *codegen, Function *CalleeF, unsigned param, Value *val, IAstExpression *arg) {
+    Type *paramType = param < CalleeF->arg_size() ? CalleeF->getFunctionType()->getParamType(param) : nullptr;
+    if (Helpers::IsStringType(codegen, val->getType()) && paramType == codegen->getStringType()->getPointerTo()) {
+        val = Helpers::GetStringAddress(codegen, val); // the runtime's print functions read the string in place.
+    }
+    else if (Helpers::IsStringType(codegen, val->getType()) && (paramType == nullptr || !Helpers::IsStringType(codegen, paramType))) {
+        val = Helpers::CreateStringCStr(codegen, val); // C functions and varargs get the chars.
+    }
+    bool castSuccess = false;
+    if (!CalleeF->isVarArg() && Helpers::IsNumberType(val)) { // don't try to cast varargs or anything not a number.
+        val = Helpers::CreateImplicitCast(codegen, val, paramType, &castSuccess);
+    }
+    if (Helpers::IsPtrToArray(val)) { // if the argument is a pointer to an array
+        val = Helpers::CreateArrayDecay(codegen, val); // converts the argument to a pointer to the first element in the array
+    }
+    if (val == nullptr) {
+        return Helpers::Error(arg->getPos(), "Function argument not valid type, failed to cast to destination type.");
+    }
+    if (castSuccess) { // warn that we automatically casted and that there might be a loss of data.
+        Helpers::Warning(arg->getPos(), "Casting from %s to %s, possible loss of data.",
+            Helpers::GetLLVMTypeName(val->getType()).c_str(), Helpers::GetLLVMTypeName(paramType).c_str());
+    }
+    return val;
+}
+
+Value *AstCallExpression::Codegen(CodeGenerator *codegen) {
+    if (GenericFunctionAst *generic = codegen->getGenericFunction(this->getName())) {
+        return CodegenGenericCall(codegen, generic);
+    }
+    if (const std::vector<FunctionOverload> *overloads = codegen->getOverloads(this->getName())) {
+        return CodegenOverloadedCall(codegen, *overloads);
+    }
+    Function *CalleeF = GetCallee(codegen);
+    if (CalleeF == nullptr) {
+        return nullptr;
+    }
+    std::vector<Value*> argsvals;
+    if (!CodegenArguments(codegen, CalleeF, argsvals)) {
+        return nullptr;
+    }
+    bool isVoidReturn = CalleeF->getReturnType()->isVoidTy();
+    return CodegenResult(codegen, CalleeF, codegen->getBuilder().CreateCall(CalleeF, argsvals, isVoidReturn ? "" : "call"));
+}
+bool AstCallExpression::CodegenArgumentValues(CodeGenerator *codegen, std::vector<Value*> &vals) {
+    for (unsigned i = 0, len = this->Args.size(); i < len; ++i) {
+        Value *val = this->Args[i]->Codegen(codegen);
         if (val == nullptr) {
-            return Helpers::Error(this->Args[i]->getPos(), "Function argument not valid type, failed to cast to destination type.");
+            Helpers::Error(this->Args[i]->getPos(), "Function argument could not be evaulated.");
+            return false;
         }
-        if (castSuccess) { // warn that we automatically casted and that there might be a loss of data.
-            Helpers::Warning(this->Args[i]->getPos(), "Casting from %s to %s, possible loss of data.",
-                Helpers::GetLLVMTypeName(val->getType()).c_str(), Helpers::GetLLVMTypeName(calleeArg->getType()).c_str());
+        vals.push_back(val);
+    }
+    return true;
+}
+Value *AstCallExpression::CodegenCall(CodeGenerator *codegen, Function *CalleeF, const std::vector<Value*> &vals) {
+    std::vector<Value*> argsvals;
+    for (unsigned i = 0, len = vals.size(); i < len; ++i) {
+        Value *val = CastArgument(codegen, CalleeF, i, vals[i], this->Args[i]);
+        if (val == nullptr) {
+            return nullptr;
         }
         argsvals.push_back(val);
     }
     bool isVoidReturn = CalleeF->getReturnType()->isVoidTy();
-    return codegen->getBuilder().CreateCall(CalleeF, argsvals, isVoidReturn ? "" : "call");
+    return CodegenResult(codegen, CalleeF, codegen->getBuilder().CreateCall(CalleeF, argsvals, isVoidReturn ? "" : "call"));
+}
+Value *AstCallExpression::CodegenGenericCall(CodeGenerator *codegen, GenericFunctionAst *generic) {
+    std::vector<Value*> vals;
+    if (!CodegenArgumentValues(codegen, vals)) {
+        return nullptr;
+    }
+    std::vector<Type*> argTypes;
+    std::vector<AstNodeType> argNodeTypes;
+    for (unsigned i = 0, len = vals.size(); i < len; ++i) {
+        argTypes.push_back(vals[i]->getType());
+        argNodeTypes.push_back(AstTypeChecker::GetArgumentType(this->Args[i]));
+    }
+    Function *CalleeF = generic->Instantiate(codegen, argTypes, argNodeTypes, this->getPos());
+    if (CalleeF == nullptr) {
+        return nullptr;
+    }
+    return CodegenCall(codegen, CalleeF, vals);
+}
+Value *AstCallExpression::CodegenOverloadedCall(CodeGenerator *codegen, const std::vector<FunctionOverload> &overloads) {
+    std::vector<Value*> vals;
+    if (!CodegenArgumentValues(codegen, vals)) {
+        return nullptr;
+    }
+    std::vector<AstNodeType> argTypes;
+    for (unsigned i = 0, len = this->Args.size(); i < len; ++i) {
+        argTypes.push_back(AstTypeChecker::GetArgumentType(this->Args[i]));
+    }
+    Function *CalleeF = nullptr;
+    unsigned bestCost = UINT_MAX;
+    bool isAmbiguous = false;
+    for (unsigned i = 0, size = overloads.size(); i < size; ++i) {
+        unsigned cost = conversionCost(overloads[i], vals, argTypes);
+        if (cost == UINT_MAX || cost > bestCost) {
+            continue;
+        }
+        isAmbiguous = cost == bestCost;
+        CalleeF = overloads[i].Func;
+        bestCost = cost;
+    }
+    if (CalleeF == nullptr) {
+        std::string argTypes;
+        for (unsigned i = 0, len = vals.size(); i < len; ++i) {
+            argTypes += (i == 0 ? "" : ", ") + Helpers::GetLLVMTypeName(vals[i]->getType());
+        }
+        return Helpers::Error(this->getPos(), "No overload of function '%s' takes (%s).", this->getName().c_str(), argTypes.c_str());
+    }
+    if (isAmbiguous) {
+        return Helpers::Error(this->getPos(), "Call to overloaded function '%s' is ambiguous.", this->getName().c_str());
+    }
+    return CodegenCall(codegen, CalleeF, vals);
+}
+
+Value *AstCallExpression::CodegenResult(CodeGenerator *codegen, Function *callee, Value *result) {
+    if (codegen->getReturnsCString(callee)) {
+        return Helpers::CreateStringFromCStr(codegen, result);
+    }
+    if (Helpers::ContainsString(codegen, result->getType())) {
+        return Helpers::CreateOwnedString(codegen, result);
+    }
+    return Helpers::CreateGCTempRoot(codegen, result);
+}
+
+IAstExpression *AstCallExpression::Simplify(AstSimplifier *simplifier) {
+    for (unsigned i = 0, size = this->Args.size(); i < size; ++i) {
+        this->Args[i] = simplifier->Simplify(this->Args[i]);
+    }
+    IAstExpression *value = simplifier->EvaluateCall(this);
+    return value != nullptr ? value : this;
 }
@@ -2,15 +2,17 @@
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
 #include "llvm/IR/Function.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 AstForExpr::AstForExpr(const std::vector<IAstExpression*> &init, IAstExpression *condition,
     const std::vector<IAstExpression*> &afterThought, const std::vector<IAstExpression*> &body, 
-    int line, int column)
+    const std::vector<AstReductionClause> &reductions, int line, int column)
     : Condition(condition)
     , Init(init)
     , Afterthought(afterThought)
-    , Body(body) {
+    , Body(body)
+    , Reductions(reductions) {
     setNodeType(node_for);
     setPos(PossiblePosition{ line, column });
 }
@@ -19,6 +21,24 @@ AstForExpr::~AstForExpr() {
     while (!Init.empty()) delete Init.back(), Init.pop_back();
     while (!Afterthought.empty()) delete Afterthought.back(), Afterthought.pop_back();
 }
+const std::vector<IAstExpression*> &AstForExpr::getInit() const {
+    return Init;
+}
+IAstExpression *AstForExpr::getCondition() const {
+    return Condition;
+}
+const std::vector<IAstExpression*> &AstForExpr::getAfterthought() const {
+    return Afterthought;
+}
+const std::vector<IAstExpression*> &AstForExpr::getBody() const {
+    return Body;
+}
+const std::vector<AstReductionClause> &AstForExpr::getReductions() const {
+    return Reductions;
+}
+void AstForExpr::setReductionType(unsigned index, AstNodeType type) {
+    Reductions[index].VariableType = type;
+}
 Value *AstForExpr::Codegen(CodeGenerator *codegen) {
     auto x = this;
 
@@ -38,6 +58,28 @@ Value *AstForExpr::Codegen(CodeGenerator *codegen) {
     }
     unsigned varCountAfterInit = codegen->getVarCount();
 
+    // Give every reduction variable a private accumulator, the condition, body and afterthought
+    // only ever see the accumulator which is combined back into the variable once the loop exits.
+    std::vector<AllocaInst*> shared, accumulators;
+    for (unsigned i = 0, size = this->Reductions.size(); i < size; ++i) {
+        const AstReductionClause &reduction = this->Reductions[i];
+        AllocaInst *variable = codegen->getNamedValue(reduction.VariableName);
+        if (variable == nullptr) {
+            return Helpers::Error(reduction.Pos, "Unknown variable name '%s' in 'reduce' clause.", reduction.VariableName.c_str());
+        }
+        Type *varType = variable->getAllocatedType();
+        Value *identity = Helpers::GetReductionIdentity(codegen, reduction.Operator, varType, Helpers::IsUnsigned(reduction.VariableType));
+        if (identity == nullptr) {
+            return Helpers::Error(reduction.Pos, "Reduction operator '%s' does not exist for '%s'",
+                reduction.OperatorString.c_str(), Helpers::GetLLVMTypeName(varType).c_str());
+        }
+        AllocaInst *accumulator = Helpers::CreateEntryBlockAlloca(codegen, func, reduction.VariableName + ".reduce", varType);
+        codegen->getBuilder().CreateStore(identity, accumulator);
+        codegen->replaceNamedValue(reduction.VariableName, accumulator);
+        shared.push_back(variable);
+        accumulators.push_back(accumulator);
+    }
+
     if (this->Condition == nullptr) { // Disallow for loop without condition.
         return Helpers::Error(this->getPos(), "For loop must have a condition.");
     }
@@ -64,8 +106,34 @@ Value *AstForExpr::Codegen(CodeGenerator *codegen) {
 
     // Set insert point to the loop and and cleanup.
     codegen->getBuilder().SetInsertPoint(loopEndBB);
+
+    // Join: combine each private accumulator back into its variable and restore the binding.
+    for (unsigned i = 0, size = this->Reductions.size(); i < size; ++i) {
+        const AstReductionClause &reduction = this->Reductions[i];
+        std::vector<Value*> partials;
+        partials.push_back(codegen->getBuilder().CreateLoad(shared[i], reduction.VariableName));
+        partials.push_back(codegen->getBuilder().CreateLoad(accumulators[i], reduction.VariableName + ".partial"));
+        Value *combined = Helpers::CreateReductionTree(codegen, reduction.Operator, partials, Helpers::IsUnsigned(reduction.VariableType));
+        if (combined == nullptr) {
+            return Helpers::Error(reduction.Pos, "Could not combine 'reduce' clause for '%s'.", reduction.VariableName.c_str());
+        }
+        codegen->getBuilder().CreateStore(combined, shared[i]);
+        codegen->replaceNamedValue(reduction.VariableName, shared[i]);
+    }
     loopBodyBB = codegen->getBuilder().GetInsertBlock();
     loopEndBB = codegen->getBuilder().GetInsertBlock();
     codegen->setOutsideBlock(outsideBB);
     return loopEndBB;
 }
+
+IAstExpression *AstForExpr::Simplify(AstSimplifier *simplifier) {
+    simplifier->PushScope(); // for the variables declared in the init.
+    for (unsigned i = 0, size = this->Init.size(); i < size; ++i) {
+        this->Init[i] = simplifier->Simplify(this->Init[i]);
+    }
+    this->Condition = simplifier->Simplify(this->Condition);
+    simplifier->SimplifyBlock(this->Body);
+    simplifier->SimplifyBlock(this->Afterthought);
+    simplifier->PopScope();
+    return this;
+}
@@ -4,6 +4,7 @@
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
@@ -20,6 +21,15 @@ AstIfElseExpr::~AstIfElseExpr() {
     while (!IfBody.empty()) delete IfBody.back(), IfBody.pop_back();
     while (!ElseBody.empty()) delete ElseBody.back(), ElseBody.pop_back();
 }
+IAstExpression *AstIfElseExpr::getCondition() const {
+    return Condition;
+}
+const std::vector<IAstExpression*> &AstIfElseExpr::getIfBody() const {
+    return IfBody;
+}
+const std::vector<IAstExpression*> &AstIfElseExpr::getElseBody() const {
+    return ElseBody;
+}
 
 Value *AstIfElseExpr::Codegen(CodeGenerator *codegen) {
     
@@ -75,3 +85,10 @@ Value *AstIfElseExpr::Codegen(CodeGenerator *codegen) {
 
     return ifEndBB;
 }
+
+IAstExpression *AstIfElseExpr::Simplify(AstSimplifier *simplifier) {
+    this->Condition = simplifier->Simplify(this->Condition);
+    simplifier->SimplifyBlock(this->IfBody);
+    simplifier->SimplifyBlock(this->ElseBody);
+    return this;
+}
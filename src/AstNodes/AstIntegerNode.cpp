@@ -1,18 +1,25 @@
 #include "AstNodes/AstIntegerNode.h"
 
 #include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
 
 using namespace llvm;
 
 AstIntegerNode::AstIntegerNode(demi_int value, int line, int column)
-    : Val(value) {
+    : Val(value), BitWidth(32) {
     setNodeType(node_unsigned_integer32);
     setPos(PossiblePosition{ line, column });
 }
 demi_int AstIntegerNode::getValue() const { 
     return Val; 
 }
+unsigned AstIntegerNode::getBitWidth() const {
+    return BitWidth;
+}
+void AstIntegerNode::setBitWidth(unsigned bitWidth) {
+    BitWidth = bitWidth;
+}
 
 Value *AstIntegerNode::Codegen(CodeGenerator *codegen) {
-    return ConstantInt::get(Type::getInt32Ty(codegen->getContext()), this->Val, true);
+    return Helpers::GetInt(codegen, this->Val, this->BitWidth);
 }
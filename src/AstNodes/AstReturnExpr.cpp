@@ -1,8 +1,9 @@
 #include "AstNodes/AstReturnExpr.h"
+#include "AstNodes/AstArenaExpr.h"
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
-#include "DEFINES.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
@@ -14,6 +15,17 @@ AstReturnExpr::AstReturnExpr(IAstExpression *expr, int line, int column)
 AstReturnExpr::~AstReturnExpr() {
     delete Expr;
 }
+IAstExpression *AstReturnExpr::getExpr() const {
+    return Expr;
+}
+
+// Frees the arenas of every 'arena' block the return leaves, innermost first.
+void AstReturnExpr::CodegenLeaveArenas(CodeGenerator *codegen) {
+    const std::vector<Value*> &arenas = codegen->getArenas();
+    for (auto arena = arenas.rbegin(); arena != arenas.rend(); ++arena) {
+        AstArenaExpr::CodegenDestroy(codegen, *arena);
+    }
+}
 
 Value *AstReturnExpr::Codegen(CodeGenerator *codegen) {
     Type *returnType = codegen->getBuilder().getCurrentFunctionReturnType();
@@ -21,6 +33,7 @@ Value *AstReturnExpr::Codegen(CodeGenerator *codegen) {
         if (!returnType->isVoidTy()) { // function return type not void, but trying to return void : error.
             return Helpers::Error(this->getPos(), "Cannot return void on function of return type '%s'", Helpers::GetLLVMTypeName(returnType).c_str());
         }
+        CodegenLeaveArenas(codegen);
         return codegen->getBuilder().CreateRetVoid();
     }
     Value *val = this->Expr->Codegen(codegen);
@@ -40,10 +53,18 @@ Value *AstReturnExpr::Codegen(CodeGenerator *codegen) {
                 Helpers::GetLLVMTypeName(valType).c_str(), Helpers::GetLLVMTypeName(returnType).c_str());
         }
     }
-    AllocaInst *retVal = codegen->getNamedValue(COMPILER_RETURN_VALUE_STRING);
-    codegen->getBuilder().CreateStore(val, retVal);
+    if (Helpers::ContainsString(codegen, val->getType())) { // the caller gets references of its own, retained in place.
+        AllocaInst *retVal = Helpers::CreateEntryBlockAlloca(codegen, codegen->getCurrentFunction(), "retval", val->getType());
+        codegen->getBuilder().CreateStore(val, retVal);
+        Helpers::CreateStringRetain(codegen, retVal);
+        val = codegen->getBuilder().CreateLoad(retVal, "retval");
+    }
+    CodegenLeaveArenas(codegen);
+    codegen->getBuilder().CreateRet(val);
+    return val;
+}
 
-    Value *derefRetVal = codegen->getBuilder().CreateLoad(retVal, "retval");
-    codegen->getBuilder().CreateRet(derefRetVal);
-    return derefRetVal;
+IAstExpression *AstReturnExpr::Simplify(AstSimplifier *simplifier) {
+    this->Expr = simplifier->Simplify(this->Expr);
+    return this;
 }
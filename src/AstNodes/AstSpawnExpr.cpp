@@ -0,0 +1,117 @@
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+#include "AstNodes/AstSpawnExpr.h"
+#include "AstNodes/AstCallExpr.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+#include "DEFINES.h"
+
+using namespace llvm;
+
+AstSpawnExpr::AstSpawnExpr(AstCallExpression *call, int line, int column)
+    : Call(call) {
+    setNodeType(node_spawn);
+    setPos(PossiblePosition{ line, column });
+}
+AstSpawnExpr::~AstSpawnExpr() {
+    delete Call;
+}
+
+// Returns the frame type of futures of the function passed: { result, args... }, where the result
+// of a void function is an empty struct.
+static StructType *getFutureType(CodeGenerator *codegen, Function *callee) {
+    std::string name = FUTURE_TYPE_PREFIX + callee->getName().str();
+    if (StructType *existing = codegen->getTheModule()->getTypeByName(name)) {
+        return existing;
+    }
+    std::vector<Type*> fields;
+    Type *returnType = callee->getReturnType();
+    fields.push_back(returnType->isVoidTy() ? StructType::get(codegen->getContext()) : returnType);
+    for (auto arg = callee->arg_begin(), end = callee->arg_end(); arg != end; ++arg) {
+        fields.push_back(arg->getType());
+    }
+    return StructType::create(codegen->getContext(), fields, name);
+}
+
+// Returns the function the scheduler runs for a spawned call, 'void f.spawn(i8*)' unpacks the 
+// arguments from the future, calls the function and stores its result back into the future.
+static Function *getSpawnThunk(CodeGenerator *codegen, Function *callee, StructType *futureType) {
+    std::string name = callee->getName().str() + ".spawn";
+    if (Function *existing = codegen->getTheModule()->getFunction(name)) {
+        return existing;
+    }
+    IRBuilder<> &builder = codegen->getBuilder();
+    FunctionType *thunkType = FunctionType::get(builder.getVoidTy(), std::vector<Type*>(1, builder.getInt8PtrTy()), false);
+    Function *thunk = Function::Create(thunkType, Function::InternalLinkage, name, codegen->getTheModule());
+
+    IRBuilderBase::InsertPoint savedIP = builder.saveIP(); // we're in the middle of the spawning function.
+    builder.SetInsertPoint(BasicBlock::Create(codegen->getContext(), "entry", thunk));
+    Value *future = builder.CreateBitCast(thunk->arg_begin(), PointerType::getUnqual(futureType), "future");
+    std::vector<Value*> args;
+    for (unsigned i = 1, e = futureType->getNumElements(); i < e; ++i) {
+        args.push_back(builder.CreateLoad(builder.CreateStructGEP(future, i), "arg"));
+    }
+    if (callee->getReturnType()->isVoidTy()) {
+        builder.CreateCall(callee, args);
+    }
+    else {
+        builder.CreateStore(builder.CreateCall(callee, args, "call"), builder.CreateStructGEP(future, 0));
+    }
+    for (unsigned i = 1, e = futureType->getNumElements(); i < e; ++i) { // drop the references taken by 'spawn'.
+        if (Helpers::ContainsString(codegen, futureType->getElementType(i))) {
+            Helpers::CreateStringRelease(codegen, builder.CreateStructGEP(future, i));
+        }
+    }
+    builder.CreateRetVoid();
+    builder.restoreIP(savedIP);
+    return thunk;
+}
+
+Value *AstSpawnExpr::Codegen(CodeGenerator *codegen) {
+    Function *callee = this->Call->GetCallee(codegen);
+    if (callee == nullptr) {
+        return nullptr;
+    }
+    if (callee->isVarArg()) {
+        return Helpers::Error(this->getPos(), "Cannot spawn variadic function '%s'.", callee->getName().str().c_str());
+    }
+    std::vector<Value*> args;
+    if (!this->Call->CodegenArguments(codegen, callee, args)) {
+        return nullptr;
+    }
+    StructType *futureType = getFutureType(codegen, callee);
+    Function *thunk = getSpawnThunk(codegen, callee, futureType);
+
+    IRBuilder<> &builder = codegen->getBuilder();
+    Type *payloadType = builder.getInt8PtrTy();
+    std::vector<Type*> allocArgs{ thunk->getType(), builder.getInt64Ty() };
+    Constant *taskAlloc = Helpers::GetRuntimeFunction(codegen, "demi_task_alloc", payloadType, allocArgs);
+    Constant *taskSpawn = Helpers::GetRuntimeFunction(codegen, "demi_task_spawn", builder.getVoidTy(), 
+        std::vector<Type*>(1, payloadType));
+
+    uint64_t futureSize = codegen->getTheModule()->getDataLayout()->getTypeAllocSize(futureType);
+    std::vector<Value*> allocVals{ thunk, Helpers::GetUInt64(codegen, futureSize) };
+    Value *payload = builder.CreateCall(taskAlloc, allocVals, "task");
+    Value *future = builder.CreateBitCast(payload, PointerType::getUnqual(futureType), "future");
+    for (unsigned i = 0, e = args.size(); i < e; ++i) {
+        Value *arg = builder.CreateStructGEP(future, i + 1);
+        builder.CreateStore(args[i], arg);
+        if (Helpers::ContainsString(codegen, args[i]->getType())) { // the caller may let go of them before the task runs.
+            Helpers::CreateStringRetain(codegen, arg);
+        }
+    }
+    builder.CreateCall(taskSpawn, payload);
+    return future;
+}
+
+IAstExpression *AstSpawnExpr::Simplify(AstSimplifier *simplifier) {
+    this->Call->Simplify(simplifier);
+    return this;
+}
+
+AstCallExpression *AstSpawnExpr::getCall() const {
+    return Call;
+}
@@ -1,6 +1,7 @@
 #include "AstNodes/AstStringNode.h"
 
 #include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
 
 using namespace llvm;
 
@@ -15,5 +16,5 @@ const std::string &AstStringNode::getValue() const {
 }
 
 Value *AstStringNode::Codegen(CodeGenerator *codegen) {
-    return codegen->getBuilder().CreateGlobalStringPtr(this->Val, "globalstr_" + this->Val.substr(0, 10));
+    return Helpers::GetString(codegen, this->Val);
 }
@@ -1,7 +1,11 @@
 #include "AstNodes/AstTypeNode.h"
+#include "AstNodes/AstIntegerNode.h"
 
+#include "AstNodes/ClassAst.h"
+#include "AstNodes/AstVisitor.h"
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
@@ -45,6 +49,18 @@ IAstExpression *AstTypeNode::getArraySubscript() const {
 std::string AstTypeNode::getTypeName() const {
     return TypeName; 
 }
+bool AstTypeNode::getIsAtomic() const {
+    return IsAtomic;
+}
+void AstTypeNode::setIsAtomic(bool isAtomic) {
+    IsAtomic = isAtomic;
+}
+bool AstTypeNode::getIsSoa() const {
+    return IsSoa;
+}
+void AstTypeNode::setIsSoa(bool isSoa) {
+    IsSoa = isSoa;
+}
 
 Type *AstTypeNode::GetLLVMType(CodeGenerator *codegen) {
     Type *type;
@@ -65,8 +81,27 @@ Type *AstTypeNode::GetLLVMType(CodeGenerator *codegen) {
     case node_unsigned_integer32: type = Type::getInt32Ty(codegen->getContext()); break;
     case node_unsigned_integer64: type = Type::getInt64Ty(codegen->getContext()); break;
 
-    case node_string: type = Type::getInt8PtrTy(codegen->getContext()); break;
+    case node_string: type = codegen->getStringType(); break;
     case node_void: type = Type::getVoidTy(codegen->getContext()); break;
+    case node_struct: {
+        ClassAst *classAst = codegen->getClass(this->TypeName);
+        if (classAst == nullptr) {
+            return Helpers::Error(this->getPos(), "Unknown type '%s'.", this->TypeName.c_str());
+        }
+        if (this->IsSoa) { // one array per field instead of an array of structs.
+            return classAst->GetSoaType(codegen, this->ArraySize);
+        }
+        if (this->IsArray && this->ArraySize == 0) { // only a pointer, the class doesn't need to be laid out yet.
+            type = classAst->Declare(codegen);
+        }
+        else {
+            type = classAst->Codegen(codegen);
+        }
+        if (type == nullptr) {
+            return nullptr;
+        }
+        break;
+    }
     }
     if (this->IsArray && this->ArraySize > 0) {
         return ArrayType::get(type, this->ArraySize); // note this is array type
@@ -76,3 +111,16 @@ Type *AstTypeNode::GetLLVMType(CodeGenerator *codegen) {
     }
     return type;
 }
+
+void AstTypeNode::Simplify(AstSimplifier *simplifier) {
+    if (!this->IsArray || this->Subscript == nullptr || this->ArraySize > 0) {
+        return;
+    }
+    this->Subscript = simplifier->Simplify(this->Subscript);
+    if (AstIntegerNode *size = AstCast<AstIntegerNode>(this->Subscript)) {
+        int32_t value = int32_t(size->getValue()); // generated as a 32 bit integer.
+        if (value > 0) {
+            this->ArraySize = value;
+        }
+    }
+}
@@ -1,11 +1,13 @@
 #include "AstNodes/AstUnaryOperatorExpr.h"
 #include "AstNodes/AstIntegerNode.h"
 #include "AstNodes/AstBinaryOperatorExpr.h"
+#include "AstNodes/ClassAst.h"
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
 
 #include "llvm/IR/Module.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
@@ -109,6 +111,10 @@ Value *AstUnaryOperatorExpr::increment(CodeGenerator *codegen) {
     if (this->getIsPrefix()) {
         return expr->Codegen(codegen);
     }
+    if (Helpers::IsAtomicLValue(codegen, this->Operand)) { // reading first would race, recover the old value instead.
+        Value *val = expr->Codegen(codegen);
+        return val == nullptr ? nullptr : codegen->getBuilder().CreateSub(val, ConstantInt::get(val->getType(), 1));
+    }
     // we'll go ahead and evaluate the operand to return and then increment it.
     Value *val = this->Operand->Codegen(codegen);
     expr->Codegen(codegen);
@@ -129,53 +135,160 @@ Value *AstUnaryOperatorExpr::decrement(CodeGenerator *codegen) {
     if (this->getIsPrefix()) {
         return expr->Codegen(codegen);
     }
+    if (Helpers::IsAtomicLValue(codegen, this->Operand)) { // reading first would race, recover the old value instead.
+        Value *val = expr->Codegen(codegen);
+        return val == nullptr ? nullptr : codegen->getBuilder().CreateAdd(val, ConstantInt::get(val->getType(), 1));
+    }
     // we'll go ahead and evaluate the operand to return and then increment it.
     Value *val = this->Operand->Codegen(codegen);
     expr->Codegen(codegen);
     return val;
 }
-Value *AstUnaryOperatorExpr::accessElement(CodeGenerator *codegen) {
+Value *AstUnaryOperatorExpr::ElementAddress(CodeGenerator *codegen, const std::string &field, bool *usedField) {
     Value *operand = this->Operand->Codegen(codegen);
     Value *idx = this->IndexExpr->Codegen(codegen);
+    if (operand == nullptr || idx == nullptr) {
+        return nullptr;
+    }
     Value *gepzero = Helpers::GetDemiUInt(codegen, 0);
-    Value *gepaddr;
+    if (ClassAst *classAst = codegen->getSoaClass(operand->getType()->getPointerElementType())) {
+        if (field.empty()) {
+            return Helpers::Error(this->getPos(), "'soa' array elements must be accessed through a field, e.g. 'pts[i].x'.");
+        }
+        int index = classAst->getFieldIndex(field);
+        if (index < 0) {
+            return Helpers::Error(this->getPos(), "Class '%s' has no field '%s'.", classAst->getName().c_str(), field.c_str());
+        }
+        if (classAst->getIsPrivate(field) && codegen->getCurrentClass() != classAst) {
+            return Helpers::Error(this->getPos(), "Field '%s' of class '%s' is private.", field.c_str(), classAst->getName().c_str());
+        }
+        if (usedField != nullptr) {
+            *usedField = true;
+        }
+        Value *soaRef[] = { ConstantInt::get(Type::getInt32Ty(codegen->getContext()), 0), 
+            ConstantInt::get(Type::getInt32Ty(codegen->getContext()), index), idx };
+        return codegen->getBuilder().CreateGEP(operand, soaRef, field);
+    }
     Value *arrayRef[] = { gepzero, idx };
     if (Helpers::IsPtrToArray(operand)) {
-        gepaddr = codegen->getBuilder().CreateGEP(operand, arrayRef, "arrayidx");
+        return codegen->getBuilder().CreateGEP(operand, arrayRef, "arrayidx");
     }
-    else {
-        gepaddr = codegen->getBuilder().CreateGEP(operand, idx, "arrayidx");
+    return codegen->getBuilder().CreateGEP(operand, idx, "arrayidx");
+}
+
+Value *AstUnaryOperatorExpr::accessElement(CodeGenerator *codegen) {
+    bool isAtomic;
+    Value *gepaddr = Helpers::GetLValueAddress(codegen, this, &isAtomic);
+    if (isAtomic) {
+        return Helpers::CreateAtomicLoad(codegen, gepaddr, SequentiallyConsistent);
     }
     return codegen->getBuilder().CreateLoad(gepaddr);
 }
 
 Value *AstUnaryOperatorExpr::ArrayAssignment(CodeGenerator *codegen, IAstExpression *rhs) {
     Value *val = rhs->Codegen(codegen);
-    Value *operand = this->Operand->Codegen(codegen);
-    Value *idx = this->IndexExpr->Codegen(codegen);
-    Value *gepzero = Helpers::GetDemiUInt(codegen, 0);
-    Value *gepaddr;
-    Value *arrayRef[] = { gepzero, idx };
-    if (Helpers::IsPtrToArray(operand)) {
-        gepaddr = codegen->getBuilder().CreateGEP(operand, arrayRef, "arrayidx");
+    bool isAtomic;
+    Value *gepaddr = Helpers::GetLValueAddress(codegen, this, &isAtomic);
+    if (isAtomic) {
+        return Helpers::CreateAtomicStore(codegen, val, gepaddr, SequentiallyConsistent);
     }
-    else {
-        gepaddr = codegen->getBuilder().CreateGEP(operand, idx, "arrayidx");
-    }
-    return codegen->getBuilder().CreateStore(val, gepaddr);
+    Helpers::CreateAssignmentStore(codegen, val, gepaddr);
+    return val;
 }
 
+// 'new T' and 'new T[n]' evaluate to a pointer to the first T, allocated from the innermost arena
+// when within an 'arena' block and from the heap otherwise.
 Value *AstUnaryOperatorExpr::newMalloc(CodeGenerator *codegen) {
+    IRBuilder<> &builder = codegen->getBuilder();
     Type *type = this->TypeNode->GetLLVMType(codegen);
-    size_t size = codegen->getTheModule()->getDataLayout()->getTypeAllocSize(type);
-
-    //codegen->getBuilder().Create
-
-    //malloc(size);
+    if (type == nullptr) {
+        return nullptr;
+    }
+    Type *elementType = type;
+    Value *count = builder.getInt64(1);
+    if (this->TypeNode->getIsArray() && !this->TypeNode->getIsSoa()) {
+        if (this->TypeNode->getArraySize() > 0) {
+            elementType = type->getArrayElementType();
+            count = builder.getInt64(this->TypeNode->getArraySize());
+        }
+        else {
+            elementType = type->getPointerElementType();
+            count = this->TypeNode->getArraySubscript()->Codegen(codegen);
+            if (count == nullptr) {
+                return nullptr;
+            }
+            if (!count->getType()->isIntegerTy()) {
+                return Helpers::Error(this->TypeNode->getArraySubscript()->getPos(), "Array size must be an integer, got '%s'.",
+                    Helpers::GetLLVMTypeName(count->getType()).c_str());
+            }
+            count = builder.CreateIntCast(count, builder.getInt64Ty(), !Helpers::IsUnsigned(this->TypeNode->getArraySubscript()->getNodeType()));
+        }
+    }
+    if (elementType->isVoidTy()) {
+        return Helpers::Error(this->getPos(), "Cannot allocate 'void'.");
+    }
+    uint64_t elementSize = codegen->getTheModule()->getDataLayout()->getTypeAllocSize(elementType);
+    Value *size = builder.CreateMul(count, builder.getInt64(elementSize), "newsize");
 
-    return nullptr;
+    Value *memory;
+    if (codegen->getUseGC()) { // the collector traces the elements with the type info, arenas aren't used.
+        std::vector<Type*> allocArgs = { builder.getInt8PtrTy(), builder.getInt64Ty() };
+        Constant *gcAlloc = Helpers::GetRuntimeFunction(codegen, "demi_gc_alloc", builder.getInt8PtrTy(), allocArgs);
+        memory = builder.CreateCall2(gcAlloc, codegen->getGCTypeInfo(elementType), count, "new");
+    }
+    else if (Value *arena = codegen->getArena()) {
+        std::vector<Type*> allocArgs = { builder.getInt8PtrTy(), builder.getInt64Ty() };
+        Constant *arenaAlloc = Helpers::GetRuntimeFunction(codegen, "demi_arena_alloc", builder.getInt8PtrTy(), allocArgs);
+        memory = builder.CreateCall2(arenaAlloc, arena, size, "new");
+    }
+    else {
+        std::vector<Type*> allocArgs(1, builder.getInt64Ty());
+        Constant *heapAlloc = Helpers::GetRuntimeFunction(codegen, "demi_alloc", builder.getInt8PtrTy(), allocArgs);
+        memory = builder.CreateCall(heapAlloc, size, "new");
+    }
+    if (!codegen->getUseGC() && Helpers::ContainsString(codegen, elementType)) { // strings must start out empty to be assigned.
+        builder.CreateMemSet(memory, builder.getInt8(0), size, 1);
+    }
+    Value *instance = builder.CreateBitCast(memory, PointerType::getUnqual(elementType));
+    Helpers::CreateGCTempRoot(codegen, instance); // the field initializers may allocate.
+    if (!this->TypeNode->getIsArray() && this->TypeNode->getTypeType() == node_struct) { // a single instance is initialized like a variable.
+        builder.CreateStore(Constant::getNullValue(elementType), instance);
+        ClassAst *classAst = codegen->getClass(this->TypeNode->getTypeName());
+        if (!classAst->CodegenFieldInitializers(codegen, instance)) {
+            return nullptr;
+        }
+    }
+    return instance;
 }
 
 TokenType AstUnaryOperatorExpr::getOperator() const {
     return Operator;
 }
+IAstExpression *AstUnaryOperatorExpr::getOperand() const {
+    return Operand;
+}
+IAstExpression *AstUnaryOperatorExpr::getIndex() const {
+    return IndexExpr;
+}
+AstTypeNode *AstUnaryOperatorExpr::getTypeNode() const {
+    return TypeNode;
+}
+
+IAstExpression *AstUnaryOperatorExpr::Simplify(AstSimplifier *simplifier) {
+    switch (this->Operator) {
+    case tok_new:
+        this->TypeNode->Simplify(simplifier);
+        return this;
+    case tok_plusplus:
+    case tok_minusminus:
+        this->Operand = simplifier->SimplifyLValue(this->Operand);
+        return this;
+    case '[':
+        this->Operand = simplifier->Simplify(this->Operand);
+        this->IndexExpr = simplifier->Simplify(this->IndexExpr);
+        return this;
+    }
+    this->Operand = simplifier->Simplify(this->Operand);
+    IAstExpression *folded = simplifier->FoldUnary(this->Operator, this->Operand, this->getPos());
+    return folded != nullptr ? folded : this;
+}
@@ -1,11 +1,13 @@
 #include "AstNodes/AstVarExpr.h"
+#include "AstNodes/ClassAst.h"
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
-AstVarExpr::AstVarExpr(const std::string &name, IAstExpression *assignmentExpression, AstTypeNode *inferredType,
+AstVarExpr::AstVarExpr(NameTable::NameId name, IAstExpression *assignmentExpression, AstTypeNode *inferredType,
     int line, int column)
     : Name(name)
     , AssignmentExpression(assignmentExpression)
@@ -18,6 +20,9 @@ AstVarExpr::~AstVarExpr() {
 }
 
 const std::string &AstVarExpr::getName() const { 
+    return NameTable::GetName(Name); 
+}
+NameTable::NameId AstVarExpr::getNameId() const { 
     return Name; 
 }
 AstTypeNode *AstVarExpr::getInferredType() const { 
@@ -28,8 +33,6 @@ IAstExpression *AstVarExpr::getAssignmentExpression() const {
 }
 
 Value *AstVarExpr::Codegen(CodeGenerator *codegen) {
-    codegen->incrementVarCount();
-
     Function *func = codegen->getCurrentFunction();
     IAstExpression *expr = this->getAssignmentExpression();
     Value *initialVal = nullptr;
@@ -37,11 +40,31 @@ Value *AstVarExpr::Codegen(CodeGenerator *codegen) {
     if (expr == nullptr) { // variable declaration without an assignment, e.g: 'var x : int;'
         if (this->InferredType->getIsArray()) { // type is an array.
             Type *arrayType = this->InferredType->GetLLVMType(codegen);
-            Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->Name.c_str(), arrayType);
+            Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->getName().c_str(), arrayType);
         }
         else {
             initialVal = Helpers::GetDefaultValue(codegen, this->InferredType);
-            Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->Name.c_str(), this->InferredType->GetLLVMType(codegen));
+            Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->getName().c_str(), this->InferredType->GetLLVMType(codegen));
+        }
+        if (this->InferredType->getIsAtomic()) {
+            codegen->setIsAtomic(Alloca);
+        }
+        if (Helpers::ContainsString(codegen, Alloca->getAllocatedType())) {
+            // the variable owns its strings, a declaration run again, e.g. in a loop, releases the previous ones
+            // and starts out empty.
+            codegen->setOwnsString(Alloca);
+            Helpers::CreateStringRelease(codegen, Alloca);
+            if (Helpers::IsStringType(codegen, Alloca->getAllocatedType())) {
+                initialVal = nullptr;
+            }
+        }
+        if (initialVal != nullptr && this->InferredType->getTypeType() == node_struct) { // fields zeroed, then initialized.
+            codegen->getBuilder().CreateStore(initialVal, Alloca);
+            initialVal = nullptr;
+            ClassAst *classAst = codegen->getClass(this->InferredType->getTypeName());
+            if (!classAst->CodegenFieldInitializers(codegen, Alloca)) {
+                return nullptr;
+            }
         }
     }
     else {
@@ -50,11 +73,24 @@ Value *AstVarExpr::Codegen(CodeGenerator *codegen) {
             return nullptr;
         }
         auto type = Helpers::GetLLVMTypeName(initialVal->getType());
-        Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->Name, initialVal->getType());
+        Alloca = Helpers::CreateEntryBlockAlloca(codegen, func, this->getName(), initialVal->getType());
+        if (Helpers::ContainsString(codegen, Alloca->getAllocatedType())) { // the store releases the previous strings.
+            codegen->setOwnsString(Alloca);
+        }
     }
     if (initialVal != nullptr) {
-        codegen->getBuilder().CreateStore(initialVal, Alloca);
+        Helpers::CreateAssignmentStore(codegen, initialVal, Alloca);
     }
     codegen->setNamedValue(this->Name, Alloca);
     return initialVal == nullptr ? Alloca : initialVal;
 }
+
+IAstExpression *AstVarExpr::Simplify(AstSimplifier *simplifier) {
+    this->AssignmentExpression = simplifier->Simplify(this->AssignmentExpression);
+    if (this->InferredType != nullptr) {
+        this->InferredType->Simplify(simplifier);
+    }
+    bool isAtomic = this->InferredType != nullptr && this->InferredType->getIsAtomic();
+    simplifier->DeclareVariable(this->Name, isAtomic ? nullptr : this->AssignmentExpression);
+    return this;
+}
@@ -2,16 +2,20 @@
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
-AstVariableNode::AstVariableNode(const std::string &name, int line, int column)
+AstVariableNode::AstVariableNode(NameTable::NameId name, int line, int column)
     : Name(name) {
     setNodeType(node_variable);
     setPos(PossiblePosition{ line, column });
 }
 
 const std::string &AstVariableNode::getName() const { 
+    return NameTable::GetName(Name); 
+}
+NameTable::NameId AstVariableNode::getNameId() const { 
     return Name; 
 }
 
@@ -23,9 +27,17 @@ Value *AstVariableNode::Codegen(CodeGenerator *codegen) {
     if (Helpers::IsPtrToPtr(v)) {
         // TODO:
     }
-    else if (Helpers::IsPtrToArray(v)) {
+    else if (Helpers::IsPtrToArray(v) || codegen->getSoaClass(v->getType()->getPointerElementType()) != nullptr) {
         return v;
     }
+    else if (Helpers::IsAtomicLValue(codegen, this)) {
+        return Helpers::CreateAtomicLoad(codegen, v, SequentiallyConsistent);
+    }
     auto type = Helpers::GetLLVMTypeName(v->getType());
-    return codegen->getBuilder().CreateLoad(v, this->Name.c_str());
+    return codegen->getBuilder().CreateLoad(v, this->getName().c_str());
+}
+
+IAstExpression *AstVariableNode::Simplify(AstSimplifier *simplifier) {
+    IAstExpression *constant = simplifier->GetConstant(this->Name, this->getPos());
+    return constant != nullptr ? constant : this;
 }
@@ -2,6 +2,7 @@
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
@@ -16,6 +17,12 @@ AstWhileExpr::~AstWhileExpr() {
     delete Condition;
     while (!WhileBody.empty()) delete WhileBody.back(), WhileBody.pop_back();
 }
+IAstExpression *AstWhileExpr::getCondition() const {
+    return Condition;
+}
+const std::vector<IAstExpression*> &AstWhileExpr::getBody() const {
+    return WhileBody;
+}
 
 Value *AstWhileExpr::Codegen(CodeGenerator *codegen) {
     Value *cond = this->Condition->Codegen(codegen);
@@ -59,3 +66,9 @@ Value *AstWhileExpr::Codegen(CodeGenerator *codegen) {
     
     return whileEndBB;
 }
+
+IAstExpression *AstWhileExpr::Simplify(AstSimplifier *simplifier) {
+    this->Condition = simplifier->Simplify(this->Condition);
+    simplifier->SimplifyBlock(this->WhileBody);
+    return this;
+}
@@ -1,9 +1,25 @@
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include <algorithm>
+
 #include "AstNodes/ClassAst.h"
 
 #include "AstNodes/FunctionAst.h"
 #include "AstNodes/AstVarExpr.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstSimplifier.h"
+#include "Compiler/AstTypeChecker.h"
+
+using namespace llvm;
 
-ClassAst::ClassAst(){}
+ClassAst::ClassAst()
+    : Constructor(nullptr)
+    , IsPacked(false)
+    , IsOrdered(false)
+    , StructTy(nullptr)
+    , IsLayingOut(false) {}
 ClassAst::ClassAst(const std::string &name, FunctionAst *ctor, const std::vector<AstVarExpr*> &publicFields, const std::vector<AstVarExpr*> &privateFields,
     const std::vector<FunctionAst*> &publicFunctions, const std::vector<FunctionAst*> &privateFunctions)
     : Name(name)
@@ -11,7 +27,14 @@ ClassAst::ClassAst(const std::string &name, FunctionAst *ctor, const std::vector
     , PublicFields(publicFields)
     , PrivateFields(privateFields)
     , PublicFunctions(publicFunctions)
-    , PrivateFunctions(privateFunctions){}
+    , PrivateFunctions(privateFunctions)
+    , IsPacked(false)
+    , IsOrdered(false)
+    , StructTy(nullptr)
+    , IsLayingOut(false) {
+    Fields.insert(Fields.end(), publicFields.begin(), publicFields.end());
+    Fields.insert(Fields.end(), privateFields.begin(), privateFields.end());
+}
 
 ClassAst::~ClassAst() {
     delete Constructor;
@@ -21,12 +44,201 @@ ClassAst::~ClassAst() {
     while (!PrivateFunctions.empty()) delete PrivateFunctions.back(), PrivateFunctions.pop_back();
 }
 
+llvm::StructType *ClassAst::Declare(CodeGenerator *codegen) {
+    if (StructTy == nullptr) {
+        StructTy = StructType::create(codegen->getContext(), Name);
+    }
+    return StructTy;
+}
+
+llvm::StructType *ClassAst::Codegen(CodeGenerator *codegen) {
+    Declare(codegen);
+    if (!StructTy->isOpaque()) { // already laid out, e.g. as a field of another class.
+        return StructTy;
+    }
+    if (IsLayingOut) {
+        return Helpers::Error(Pos, "Class '%s' contains itself, use an array field instead.", Name.c_str());
+    }
+    IsLayingOut = true;
+
+    std::vector<Type*> fieldTypes;
+    for (auto field = Fields.begin(); field != Fields.end(); ++field) {
+        AstTypeNode *typeNode = (*field)->getInferredType();
+        if (typeNode == nullptr) {
+            return Helpers::Error((*field)->getPos(), "Could not infer the type of field '%s'.", (*field)->getName().c_str());
+        }
+        Type *type = typeNode->GetLLVMType(codegen);
+        if (type == nullptr) {
+            return nullptr;
+        }
+        if (type->isVoidTy()) {
+            return Helpers::Error((*field)->getPos(), "'void' not valid field type.");
+        }
+        fieldTypes.push_back(type);
+    }
+
+    // Order the fields by decreasing alignment, as every type's size is a multiple of its alignment this leaves
+    // padding only at the end of the struct. The sort is stable so equally aligned fields stay in declared order.
+    std::vector<unsigned> order;
+    for (unsigned i = 0; i < Fields.size(); ++i) {
+        order.push_back(i);
+    }
+    if (!IsPacked && !IsOrdered) {
+        const DataLayout *layout = codegen->getTheModule()->getDataLayout();
+        std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            return layout->getABITypeAlignment(fieldTypes[a]) > layout->getABITypeAlignment(fieldTypes[b]);
+        });
+    }
+    // No vtable pointer: nothing can derive from a class, so nothing would ever load through it.
+    std::vector<Type*> body;
+    for (unsigned i = 0; i < order.size(); ++i) {
+        const std::string &fieldName = Fields[order[i]]->getName();
+        if (!FieldIndices.insert({ fieldName, i }).second) {
+            return Helpers::Error(Fields[order[i]]->getPos(), "Redefinition of field '%s' in class '%s'.", fieldName.c_str(), Name.c_str());
+        }
+        body.push_back(fieldTypes[order[i]]);
+    }
+    StructTy->setBody(body, IsPacked);
+    IsLayingOut = false;
+    return StructTy;
+}
+
+llvm::StructType *ClassAst::GetSoaType(CodeGenerator *codegen, demi_int size) {
+    auto found = SoaTypes.find(size);
+    if (found != SoaTypes.end()) {
+        return found->second;
+    }
+    if (Codegen(codegen) == nullptr) {
+        return nullptr;
+    }
+    std::vector<Type*> columns;
+    for (unsigned i = 0, e = StructTy->getNumElements(); i < e; ++i) {
+        columns.push_back(ArrayType::get(StructTy->getElementType(i), size));
+    }
+    llvm::StructType *soaType = StructType::create(codegen->getContext(), columns, Name + ".soa");
+    SoaTypes[size] = soaType;
+    return soaType;
+}
+
+bool ClassAst::IsSoaType(Type *type) const {
+    for (auto soaType = SoaTypes.begin(); soaType != SoaTypes.end(); ++soaType) {
+        if (soaType->second == type) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ClassAst::CodegenFieldInitializers(CodeGenerator *codegen, Value *instance) {
+    for (auto field = Fields.begin(); field != Fields.end(); ++field) {
+        IAstExpression *expr = (*field)->getAssignmentExpression();
+        if (expr == nullptr) { // zero initialized.
+            continue;
+        }
+        Value *val = expr->Codegen(codegen);
+        if (val == nullptr) {
+            return false;
+        }
+        Value *fieldAddress = codegen->getBuilder().CreateStructGEP(instance, getFieldIndex((*field)->getName()), (*field)->getName());
+        val = Helpers::CreateImplicitCast(codegen, val, fieldAddress->getType()->getPointerElementType());
+        if (val == nullptr) {
+            Helpers::Error(expr->getPos(), "Could not cast initial value of field '%s' to the field type.", (*field)->getName().c_str());
+            return false;
+        }
+        Helpers::CreateAssignmentStore(codegen, val, fieldAddress);
+    }
+    return true;
+}
+
+bool ClassAst::DeclareMethods(CodeGenerator *codegen) {
+    std::vector<FunctionAst*> functions(PublicFunctions);
+    functions.insert(functions.end(), PrivateFunctions.begin(), PrivateFunctions.end());
+    for (auto func = functions.begin(); func != functions.end(); ++func) {
+        PrototypeAst *proto = (*func)->getPrototype();
+        std::string name = proto->getName().substr(Name.size() + 1); // drop the 'Class.' qualifier.
+        if (Methods.count(name) != 0 || FieldIndices.count(name) != 0) {
+            Helpers::Error(proto->getPos(), "Redefinition of member '%s' in class '%s'.", name.c_str(), Name.c_str());
+            return false;
+        }
+        Function *method = proto->Codegen(codegen);
+        if (method == nullptr) {
+            return false;
+        }
+        // Methods are small more often than not, and as calls are bound directly they can always be inlined.
+        method->addFnAttr(Attribute::InlineHint);
+        Methods[name] = method;
+    }
+    return true;
+}
+
+bool ClassAst::CodegenMethods(CodeGenerator *codegen) {
+    std::vector<FunctionAst*> functions(PublicFunctions);
+    functions.insert(functions.end(), PrivateFunctions.begin(), PrivateFunctions.end());
+    codegen->setCurrentClass(this);
+    for (auto func = functions.begin(); func != functions.end(); ++func) {
+        if ((*func)->Codegen(codegen) == nullptr) {
+            codegen->setCurrentClass(nullptr);
+            return false;
+        }
+    }
+    codegen->setCurrentClass(nullptr);
+    return true;
+}
+
+void ClassAst::setPos(PossiblePosition pos) {
+    Pos = pos;
+}
+PossiblePosition ClassAst::getPos() const {
+    return Pos;
+}
 void ClassAst::setName(const std::string &name) {
     Name = name;
 }
 std::string ClassAst::getName() const {
     return Name;
 }
+void ClassAst::setIsPacked(bool isPacked) {
+    IsPacked = isPacked;
+}
+bool ClassAst::getIsPacked() const {
+    return IsPacked;
+}
+void ClassAst::setIsOrdered(bool isOrdered) {
+    IsOrdered = isOrdered;
+}
+bool ClassAst::getIsOrdered() const {
+    return IsOrdered;
+}
+llvm::StructType *ClassAst::getStructType() const {
+    return StructTy;
+}
+int ClassAst::getFieldIndex(const std::string &name) const {
+    auto found = FieldIndices.find(name);
+    if (found == FieldIndices.end()) {
+        return -1;
+    }
+    return found->second;
+}
+Function *ClassAst::getMethod(const std::string &name) const {
+    auto found = Methods.find(name);
+    if (found == Methods.end()) {
+        return nullptr;
+    }
+    return found->second;
+}
+bool ClassAst::getIsPrivate(const std::string &name) const {
+    for (auto field = PrivateFields.begin(); field != PrivateFields.end(); ++field) {
+        if ((*field)->getName() == name) {
+            return true;
+        }
+    }
+    for (auto func = PrivateFunctions.begin(); func != PrivateFunctions.end(); ++func) {
+        if ((*func)->getPrototype()->getName() == Name + "." + name) {
+            return true;
+        }
+    }
+    return false;
+}
 bool ClassAst::setConstructor(FunctionAst *ctor) {
     if (Constructor != nullptr || ctor == nullptr) {
         return false;
@@ -39,6 +251,7 @@ bool ClassAst::pushPublicField(AstVarExpr *publicField) {
         return false;
     }
     PublicFields.push_back(publicField);
+    Fields.push_back(publicField);
     return true;
 }
 bool ClassAst::pushPrivateField(AstVarExpr *privateField) {
@@ -46,19 +259,52 @@ bool ClassAst::pushPrivateField(AstVarExpr *privateField) {
         return false;
     }
     PrivateFields.push_back(privateField);
+    Fields.push_back(privateField);
     return true;
 }
-bool ClassAst::pushPublicFunction(FunctionAst *publicFunction) {
+bool ClassAst::pushPublicFunction(FunctionAst *publicFunction, bool isVirtual) {
     if (publicFunction == nullptr) {
         return false;
     }
     PublicFunctions.push_back(publicFunction);
+    if (isVirtual) {
+        VirtualFunctions.insert(publicFunction);
+    }
     return true;
 }
-bool ClassAst::pushPrivateFunction(FunctionAst *privateFunction) {
+bool ClassAst::pushPrivateFunction(FunctionAst *privateFunction, bool isVirtual) {
     if (privateFunction == nullptr) {
         return false;
     }
     PrivateFunctions.push_back(privateFunction);
+    if (isVirtual) {
+        VirtualFunctions.insert(privateFunction);
+    }
     return true;
 }
+
+void ClassAst::Simplify(AstSimplifier *simplifier) {
+    for (unsigned i = 0, size = this->Fields.size(); i < size; ++i) {
+        this->Fields[i]->Simplify(simplifier);
+    }
+    if (this->Constructor != nullptr) {
+        this->Constructor->Simplify(simplifier);
+    }
+    for (unsigned i = 0, size = this->PublicFunctions.size(); i < size; ++i) {
+        this->PublicFunctions[i]->Simplify(simplifier);
+    }
+    for (unsigned i = 0, size = this->PrivateFunctions.size(); i < size; ++i) {
+        this->PrivateFunctions[i]->Simplify(simplifier);
+    }
+}
+
+bool ClassAst::Check(AstTypeChecker *checker) {
+    bool isValid = this->Constructor == nullptr || checker->CheckFunction(this->Constructor);
+    for (unsigned i = 0, size = this->PublicFunctions.size(); i < size; ++i) {
+        isValid = checker->CheckFunction(this->PublicFunctions[i]) && isValid;
+    }
+    for (unsigned i = 0, size = this->PrivateFunctions.size(); i < size; ++i) {
+        isValid = checker->CheckFunction(this->PrivateFunctions[i]) && isValid;
+    }
+    return isValid;
+}
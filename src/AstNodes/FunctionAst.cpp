@@ -6,13 +6,14 @@
 #include "AstNodes/FunctionAst.h"
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
-#include "DEFINES.h"
+#include "Compiler/AstSimplifier.h"
 
 using namespace llvm;
 
 FunctionAst::FunctionAst(PrototypeAst *prototype, const std::vector<IAstExpression*> &functionBody, int line, int column)
     : Prototype(prototype)
-    , FunctionBody(functionBody) {
+    , FunctionBody(functionBody)
+    , IsConst(false) {
     Pos.LineNumber = line;
     Pos.ColumnNumber = column;
 }
@@ -26,6 +27,15 @@ PossiblePosition FunctionAst::getPos() const {
 PrototypeAst *FunctionAst::getPrototype() const { 
     return Prototype; 
 }
+const std::vector<IAstExpression*> &FunctionAst::getBody() const {
+    return FunctionBody;
+}
+bool FunctionAst::getIsConst() const {
+    return IsConst;
+}
+void FunctionAst::setIsConst(bool isConst) {
+    IsConst = isConst;
+}
 
 Function *FunctionAst::Codegen(CodeGenerator *codegen) {
     codegen->clearNamedValues();
@@ -41,35 +51,19 @@ Function *FunctionAst::Codegen(CodeGenerator *codegen) {
     //codegen->setReturnBlock(retBB); // save our return block to jump to.
     codegen->getBuilder().SetInsertPoint(entryBB);
     this->Prototype->CreateArgumentAllocas(codegen, func);
-    Type *returnType = this->Prototype->getReturnType()->GetLLVMType(codegen);
-    AllocaInst *retVal = nullptr;
-    if (!func->getReturnType()->isVoidTy()) { // if the function is not void, create a pointer to the return value
-        retVal = Helpers::CreateEntryBlockAlloca(codegen, func, COMPILER_RETURN_VALUE_STRING, returnType);
-        codegen->setNamedValue(COMPILER_RETURN_VALUE_STRING, retVal);
-    }
     codegen->setOutsideBlock(nullptr); // if the merge block is a nullptr we will know we are at depth 0
     Helpers::EmitScopeBlock(codegen, this->FunctionBody);
     // Go back and look for any blocks without a terminator and branch it to the next block
     // this is typically used to jump back after a scope finishes.
     Helpers::LinkBlocksWithoutTerminator(codegen, func);
-    BasicBlock *retBB = BasicBlock::Create(codegen->getContext(), "return", func); // where a return will be branched to on void return type.
-    if (codegen->getBuilder().GetInsertBlock()->getTerminator() == nullptr) { // missing a terminator, try to branch to default return block.
-        codegen->getBuilder().CreateBr(retBB);
-        // Switch to the return block
-        codegen->getBuilder().SetInsertPoint(retBB);
-        // Load the return value and get ready to return it.
+    // Every 'return' is a 'ret' of its own, the body falling off its end returns where it stopped.
+    if (codegen->getBuilder().GetInsertBlock()->getTerminator() == nullptr) {
         if (func->getReturnType()->isVoidTy()) {
             codegen->getBuilder().CreateRetVoid();
         }
-        else if (retVal != nullptr) {
-            Value *derefRetVal = codegen->getBuilder().CreateLoad(retVal, COMPILER_RETURN_VALUE_STRING);
-            // return the function's return value.
-            codegen->getBuilder().CreateRet(derefRetVal);
-        } // if something else went wrong, we shouldn't reach this far
-        retBB = codegen->getBuilder().GetInsertBlock();
-    }
-    else {
-        retBB->removeFromParent();
+        else { // a function that doesn't return a value returns zero.
+            codegen->getBuilder().CreateRet(Constant::getNullValue(func->getReturnType()));
+        }
     }
 
     if (codegen->getOutsideBlock() != nullptr && codegen->getOutsideBlock()->getTerminator() == nullptr) { // do some branch cleanup
@@ -83,8 +77,23 @@ Function *FunctionAst::Codegen(CodeGenerator *codegen) {
         return Helpers::Error(this->Pos, "Error creating function body.");
     }
     else { // try to optimize the function by running the function pass manager
+        Helpers::PromoteNonEscapingAllocations(codegen, func);
+        Helpers::ReleaseOwnedStrings(codegen, func);
+        if (codegen->getUseGC()) {
+            Helpers::InsertGCFrame(codegen, func);
+        }
+        Helpers::PromoteVariablesToRegisters(codegen, func);
         //codegen->getTheFPM()->run(*func);
     }
     codegen->setCurrentFunction(nullptr);
     return func; // might as well return the generated function for potential closure support later.
 }
+
+void FunctionAst::Simplify(AstSimplifier *simplifier) {
+    std::vector<std::string> params;
+    const std::vector<std::pair<std::string, AstTypeNode*>> &args = this->Prototype->getArgs();
+    for (unsigned i = 0, size = args.size(); i < size; ++i) {
+        params.push_back(args[i].first);
+    }
+    simplifier->SimplifyFunction(params, this->FunctionBody);
+}
@@ -0,0 +1,201 @@
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include <algorithm>
+#include <map>
+
+#include "AstNodes/GenericFunctionAst.h"
+#include "AstNodes/FunctionAst.h"
+#include "AstNodes/PrototypeAst.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstTypeChecker.h"
+#include "Compiler/TreeContainer.h"
+#include "Parser/Parser.h"
+
+using namespace llvm;
+
+namespace {
+
+    // The type a type parameter is bound to, integers are unsigned if every argument passed for it was.
+    struct Binding {
+        Type *BoundType;
+        bool IsUnsigned;
+    };
+
+    // The type of two arguments bound to the same type parameter: numbers widen to the larger one, anything else
+    // must match. Returns nullptr if they can't be unified.
+    Type *unify(Type *bound, Type *type) {
+        if (bound == type) {
+            return bound;
+        }
+        if (bound->isIntegerTy(1) || type->isIntegerTy(1)) {
+            return nullptr;
+        }
+        if (bound->isIntegerTy() && type->isIntegerTy()) {
+            return bound->getIntegerBitWidth() > type->getIntegerBitWidth() ? bound : type;
+        }
+        if (bound->isFloatingPointTy() && type->isFloatingPointTy()) {
+            return bound->isDoubleTy() ? bound : type;
+        }
+        if (bound->isFloatingPointTy() && type->isIntegerTy()) {
+            return bound;
+        }
+        if (bound->isIntegerTy() && type->isFloatingPointTy()) {
+            return type;
+        }
+        return nullptr;
+    }
+
+    // Sets the token a type is written as, returns false for types that can't be written, e.g. arrays.
+    bool typeToken(CodeGenerator *codegen, Type *type, bool isUnsigned, TokenType &tokType, std::string &name) {
+        if (isUnsigned && type->isIntegerTy() && !type->isIntegerTy(1)) {
+            switch (type->getIntegerBitWidth()) {
+            default: return false;
+            case 8: tokType = tok_typeuint8; name = "uint8"; return true;
+            case 16: tokType = tok_typeuint16; name = "uint16"; return true;
+            case 32: tokType = tok_typeuint32; name = "uint"; return true;
+            case 64: tokType = tok_typeuint64; name = "uint64"; return true;
+            }
+        }
+        switch (type->getTypeID()) {
+        default: return false;
+        case Type::DoubleTyID: tokType = tok_typedouble; name = "double"; return true;
+        case Type::FloatTyID: tokType = tok_typefloat; name = "float"; return true;
+        case Type::IntegerTyID:
+            switch (type->getIntegerBitWidth()) {
+            default: return false;
+            case 1: tokType = tok_typebool; name = "bool"; return true;
+            case 8: tokType = tok_typeint8; name = "int8"; return true;
+            case 16: tokType = tok_typeint16; name = "int16"; return true;
+            case 32: tokType = tok_typeint32; name = "int"; return true;
+            case 64: tokType = tok_typeint64; name = "int64"; return true;
+            }
+        case Type::StructTyID:
+            if (Helpers::IsStringType(codegen, type)) {
+                tokType = tok_typestring;
+                name = "string";
+                return true;
+            }
+            if (!cast<StructType>(type)->hasName() || codegen->getClass(type->getStructName()) == nullptr) {
+                return false;
+            }
+            tokType = tok_identifier; // a class.
+            name = type->getStructName();
+            return true;
+        }
+    }
+
+}
+
+GenericFunctionAst::GenericFunctionAst(FunctionAst *definition, const std::vector<Token> &tokens)
+    : Definition(definition)
+    , Tokens(tokens) {
+}
+GenericFunctionAst::~GenericFunctionAst() {
+    delete Definition;
+}
+PossiblePosition GenericFunctionAst::getPos() const {
+    return Definition->getPos();
+}
+const std::string &GenericFunctionAst::getName() const {
+    return Definition->getPrototype()->getName();
+}
+
+Function *GenericFunctionAst::Instantiate(CodeGenerator *codegen, const std::vector<Type*> &argTypes,
+    const std::vector<AstNodeType> &argNodeTypes, PossiblePosition pos) {
+    PrototypeAst *proto = Definition->getPrototype();
+    const std::vector<std::string> &typeParameters = proto->getTypeParameters();
+    const std::vector<std::pair<std::string, AstTypeNode*>> &params = proto->getArgs();
+    const char *name = getName().c_str();
+    if (argTypes.size() != params.size()) {
+        return Helpers::Error(pos, "Incorrect number of arguments passed to function '%s'", name);
+    }
+    // bind the type parameters to the types of the arguments passed for them.
+    std::map<std::string, Binding> bindings;
+    for (unsigned i = 0, size = params.size(); i < size; ++i) {
+        AstTypeNode *type = params[i].second;
+        bool isTypeParameter = std::find(typeParameters.begin(), typeParameters.end(), type->getTypeName()) != typeParameters.end();
+        if (type->getIsArray() || type->getTypeType() != node_struct || !isTypeParameter) {
+            continue;
+        }
+        bool isUnsigned = Helpers::IsUnsigned(argNodeTypes[i]);
+        auto found = bindings.find(type->getTypeName());
+        if (found == bindings.end()) {
+            Binding binding = { argTypes[i], isUnsigned };
+            bindings.insert(std::make_pair(type->getTypeName(), binding));
+            continue;
+        }
+        Type *&bound = found->second.BoundType;
+        bound = unify(bound, argTypes[i]);
+        found->second.IsUnsigned = found->second.IsUnsigned && isUnsigned;
+        if (bound == nullptr) {
+            return Helpers::Error(pos, "Conflicting argument types for type parameter '%s' of '%s'.", type->getTypeName().c_str(), name);
+        }
+    }
+    std::string instanceName = getName() + "<";
+    std::map<std::string, Token> replacements;
+    for (unsigned i = 0, size = typeParameters.size(); i < size; ++i) {
+        auto bound = bindings.find(typeParameters[i]);
+        if (bound == bindings.end()) {
+            return Helpers::Error(pos, "Could not infer type parameter '%s' of '%s' from the arguments.", typeParameters[i].c_str(), name);
+        }
+        TokenType tokType;
+        std::string typeName;
+        if (!typeToken(codegen, bound->second.BoundType, bound->second.IsUnsigned, tokType, typeName)) {
+            return Helpers::Error(pos, "Type parameter '%s' of '%s' can't be '%s'.", typeParameters[i].c_str(), name,
+                Helpers::GetLLVMTypeName(bound->second.BoundType).c_str());
+        }
+        replacements.insert(std::make_pair(typeParameters[i], Token(tokType, typeName)));
+        instanceName += (i == 0 ? "" : ",") + typeName;
+    }
+    instanceName += ">";
+    if (Function *instance = codegen->getTheModule()->getFunction(instanceName)) {
+        return instance;
+    }
+
+    // 'func' name '<' ... '>' becomes 'func' instanceName, the type parameters become the types.
+    std::vector<Token> tokens;
+    unsigned i = 0;
+    for (; i < 2; ++i) {
+        tokens.push_back(Token(Tokens[i].Type(), i == 0 ? Tokens[i].Value() : instanceName, Tokens[i].Line(), Tokens[i].Column()));
+    }
+    while (Tokens[i].Type() != '>') {
+        ++i;
+    }
+    for (++i; i < Tokens.size(); ++i) {
+        auto replacement = Tokens[i].Type() == tok_identifier ? replacements.find(Tokens[i].Value()) : replacements.end();
+        if (replacement == replacements.end()) {
+            tokens.push_back(Tokens[i]);
+            continue;
+        }
+        tokens.push_back(Token(replacement->second.Type(), replacement->second.Value(), Tokens[i].Line(), Tokens[i].Column()));
+    }
+    std::vector<Token*> tokenPtrs;
+    for (unsigned j = 0, size = tokens.size(); j < size; ++j) {
+        tokenPtrs.push_back(&tokens[j]);
+    }
+    Parser parser;
+    TreeContainer *trees = parser.ParseTrees(tokenPtrs);
+    if (trees == nullptr || trees->FunctionDefinitions.size() != 1) {
+        delete trees;
+        return Helpers::Error(pos, "Could not instantiate '%s'.", instanceName.c_str());
+    }
+    FunctionAst *instance = trees->FunctionDefinitions[0];
+    trees->FunctionDefinitions.clear();
+    delete trees;
+
+    // it goes through the passes the functions of the file went through before they were generated.
+    instance->Simplify(codegen->getSimplifier());
+    if (!codegen->getTypeChecker()->CheckFunction(instance)) {
+        delete instance;
+        return nullptr;
+    }
+    Function *func = instance->getPrototype()->Codegen(codegen);
+    if (func == nullptr) {
+        delete instance;
+        return nullptr;
+    }
+    codegen->addInstantiation(instance); // its body is generated after the function being generated.
+    return func;
+}
@@ -4,15 +4,22 @@
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/AstTypeChecker.h"
 
 using namespace llvm;
 
-PrototypeAst::PrototypeAst(const std::string &name, AstTypeNode *returnType, const std::vector<std::pair<std::string, AstTypeNode*>> &args,
+// The runtime's print functions take strings by address and write their stored length, instead of C chars.
+static bool takesRuntimeStrings(const std::string &name) {
+    return name == "print" || name == "println";
+}
+
+PrototypeAst::PrototypeAst(NameTable::NameId name, AstTypeNode *returnType, const std::vector<std::pair<std::string, AstTypeNode*>> &args,
     bool isVarArgs, int line, int column)
     : Name(name)
     , ReturnType(returnType)
     , Args(args)
-    , IsVarArgs(isVarArgs) {
+    , IsVarArgs(isVarArgs)
+    , IsExtern(false) {
     Pos.LineNumber = line;
     Pos.ColumnNumber = column;
 }
@@ -27,42 +34,81 @@ PossiblePosition PrototypeAst::getPos() const {
     return Pos; 
 }
 const std::string &PrototypeAst::getName() const {
-    return Name; 
+    return NameTable::GetName(Name); 
 }
 AstTypeNode *PrototypeAst::getReturnType() const {
     return ReturnType; 
 }
+const std::vector<std::pair<std::string, AstTypeNode*>> &PrototypeAst::getArgs() const {
+    return Args;
+}
+void PrototypeAst::setIsExtern(bool isExtern) {
+    this->IsExtern = isExtern;
+}
+const std::vector<std::string> &PrototypeAst::getTypeParameters() const {
+    return TypeParameters;
+}
+void PrototypeAst::setTypeParameters(const std::vector<std::string> &typeParameters) {
+    this->TypeParameters = typeParameters;
+}
+
+void PrototypeAst::Overload() {
+    std::string name = getName() + "(";
+    for (unsigned i = 0, size = this->Args.size(); i < size; ++i) {
+        AstTypeNode *type = this->Args[i].second;
+        name += i == 0 ? "" : ",";
+        name += type->getTypeType() == node_struct ? type->getTypeName() : AstTypeChecker::GetTypeName(type->getTypeType());
+        name += type->getIsArray() ? "[]" : "";
+    }
+    this->Name = NameTable::Intern(name + ")");
+}
+
+void PrototypeAst::BindToClass(const std::string &className) {
+    this->Name = NameTable::Intern(className + "." + getName());
+    AstTypeNode *thisType = new AstTypeNode(node_struct, className, true, (demi_int)0, Pos.LineNumber, Pos.ColumnNumber);
+    this->Args.insert(this->Args.begin(), std::make_pair(std::string("this"), thisType));
+}
 
 Function *PrototypeAst::Codegen(CodeGenerator *codegen) {
-    // TODO: Serialize the prototype to allow for function overloading.
+    // C functions take and return NUL terminated chars for strings.
+    Type *cStringType = Type::getInt8PtrTy(codegen->getContext());
+    Type *externStringType = takesRuntimeStrings(getName()) ? codegen->getStringType()->getPointerTo() : cStringType;
     std::vector<Type *> argTypes;
     for (auto itr = this->Args.begin(); itr != this->Args.end(); ++itr) {
         Type *type = itr->second->GetLLVMType(codegen);
         if (type->isVoidTy()) {// void is not a valid function parameter type.
             return Helpers::Error(itr->second->getPos(), "'void' not valid function parameter type.");
         }
+        if (this->IsExtern && Helpers::IsStringType(codegen, type)) {
+            type = externStringType;
+        }
         argTypes.push_back(type);
     }
-    FunctionType *funcType = FunctionType::get(this->ReturnType->GetLLVMType(codegen), argTypes, this->IsVarArgs);
-    Function *func = Function::Create(funcType, Function::ExternalLinkage, this->Name, codegen->getTheModule());
+    Type *returnType = this->ReturnType->GetLLVMType(codegen);
+    bool returnsCString = this->IsExtern && Helpers::IsStringType(codegen, returnType);
+    FunctionType *funcType = FunctionType::get(returnsCString ? cStringType : returnType, argTypes, this->IsVarArgs);
+    Function *func = Function::Create(funcType, Function::ExternalLinkage, getName(), codegen->getTheModule());
 
     // If 'func' conflicted, ther was already something named 'Name'. If it has a body,
     // don't allow redefinition.
-    if (func->getName() != this->Name) {
+    if (func->getName() != getName()) {
         // Delete the one we just made and get the existing one.
         func->eraseFromParent();
-        func = codegen->getTheModule()->getFunction(this->Name);
+        func = codegen->getTheModule()->getFunction(getName());
 
         // if func already has a body, reject this.
         if (!func->empty()) {
-            return Helpers::Error(this->Pos, "Redefinition of function '%s'", this->Name.c_str());
+            return Helpers::Error(this->Pos, "Redefinition of function '%s'", getName().c_str());
         }
 
         // if func took a different number of args, reject
         if (func->arg_size() != this->Args.size()) {
-            return Helpers::Error(this->Pos, "Redefinitionof function '%s' with a different number of arguments.", this->Name.c_str());
+            return Helpers::Error(this->Pos, "Redefinitionof function '%s' with a different number of arguments.", getName().c_str());
         }
     }
+    if (returnsCString) {
+        codegen->setReturnsCString(func);
+    }
     return func;
 }
 // CreateArgumentAllocas - Create an alloca for each argument and register the
@@ -80,8 +126,15 @@ void PrototypeAst::CreateArgumentAllocas(CodeGenerator *codegen, Function *func)
 
         // Store the initial value
         codegen->getBuilder().CreateStore(arg_itr, Alloca);
+        if (Helpers::ContainsString(codegen, Alloca->getAllocatedType())) { // the caller's strings are shared for the call.
+            Helpers::CreateStringRetain(codegen, Alloca);
+            codegen->setOwnsString(Alloca);
+        }
 
         // Add arguments to variable symbol table.
         codegen->setNamedValue(argName, Alloca);
+        if (arg->getIsAtomic()) {
+            codegen->setIsAtomic(Alloca);
+        }
     }
 }
@@ -13,14 +13,21 @@
 #include "AstNodes/ClassAst.h"
 #include "AstNodes/PrototypeAst.h"
 #include "AstNodes/FunctionAst.h"
+#include "AstNodes/GenericFunctionAst.h"
 #include "AstNodes/IAstExpression.h"
 
-#include "DemiurgeJitOutputFunctions.h"
+#include "Runtime/DemiurgeOutput.h"
+#include <algorithm>
 
 using namespace llvm;
 CodeGenerator::CodeGenerator() 
     : _context(getGlobalContext())
-    , _builder(getGlobalContext()) {
+    , _builder(getGlobalContext())
+    , _generatedInstantiations(0)
+    , _simplifier(nullptr)
+    , _typeChecker(nullptr)
+    , _currentClass(nullptr)
+    , _useGC(false) {
     InitializeNativeTarget();
     InitializeNativeTargetAsmPrinter();
     InitializeNativeTargetAsmParser();
@@ -46,6 +53,10 @@ CodeGenerator::CodeGenerator()
     // Set up the optimizer pipeline.  Start with registering info about how the
     // target lays out data structures.
     _theModule->setDataLayout(_theExecutionEngine->getDataLayout());
+
+    // { data, length, capacity }, see DemiurgeString.h, short strings reuse the whole struct for their chars.
+    std::vector<Type*> stringFields = { Type::getInt8PtrTy(_context), Type::getInt64Ty(_context), Type::getInt64Ty(_context) };
+    _stringType = StructType::create(_context, stringFields, "string");
 #if 0
     _theFPM->add(new DataLayoutPass(_theModule));
     // Provide basic AliasAnalysis support for GVN.
@@ -70,6 +81,7 @@ CodeGenerator::CodeGenerator()
 
 
 CodeGenerator::~CodeGenerator() {
+    while (!_instantiations.empty()) delete _instantiations.back(), _instantiations.pop_back();
 }
 
 void updateGMap(CodeGenerator *codegen, Type *returnType, const char *name, void *addr, Type *argType, bool isVarArgs = false) {
@@ -104,14 +116,79 @@ void CodeGenerator::initJitOutputFunctions() {
 #undef DOUBLE_TYPE
 }
 
+bool CodeGenerator::declareClasses(TreeContainer *trees) {
+    for (int i = 0, e = trees->ClassDefinitions.size(); i < e; ++i) { // declare every class so they can refer to each other
+        ClassAst *classAst = trees->ClassDefinitions[i];
+        if (!_classes.insert({ classAst->getName(), classAst }).second) {
+            Helpers::Error(classAst->getPos(), "Redefinition of class '%s'.", classAst->getName().c_str());
+            return false;
+        }
+        classAst->Declare(this);
+    }
+    for (int i = 0, e = trees->ClassDefinitions.size(); i < e; ++i) { // lay out the classes
+        if (trees->ClassDefinitions[i]->Codegen(this) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Generates the bodies of the generic functions' instantiations, which may instantiate more.
+bool CodeGenerator::generateInstantiations() {
+    while (_generatedInstantiations < _instantiations.size()) {
+        if (_instantiations[_generatedInstantiations++]->Codegen(this) == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CodeGenerator::declareFunctions(TreeContainer *trees) {
     for (int i = 0, e = trees->ExternalDeclarations.size(); i < e; ++i) { // declare external declarations
         if (trees->ExternalDeclarations[i]->Codegen(this) == nullptr) {
             return false;
         }
     }
+    for (int i = 0, e = trees->GenericFunctions.size(); i < e; ++i) { // instantiated when called
+        GenericFunctionAst *generic = trees->GenericFunctions[i];
+        if (!_genericFunctions.insert({ generic->getName(), generic }).second) {
+            Helpers::Error(generic->getPos(), "Redefinition of function '%s'", generic->getName().c_str());
+            return false;
+        }
+    }
+    std::map<std::string, unsigned> definitionCounts;
+    for (int i = 0, e = trees->FunctionDefinitions.size(); i < e; ++i) {
+        ++definitionCounts[trees->FunctionDefinitions[i]->getPrototype()->getName()];
+    }
     for (int i = 0; i < trees->FunctionDefinitions.size(); ++i) { // declare user functions
-        if (trees->FunctionDefinitions[i]->getPrototype()->Codegen(this) == nullptr) {
+        PrototypeAst *proto = trees->FunctionDefinitions[i]->getPrototype();
+        std::string name = proto->getName();
+        bool isOverloaded = definitionCounts[name] > 1 || _overloads.count(name) != 0;
+        if (isOverloaded) { // only overloaded names are mangled, a function defined once keeps its name.
+            proto->Overload();
+        }
+        Function *func = proto->Codegen(this);
+        if (func == nullptr) {
+            return false;
+        }
+        if (isOverloaded) {
+            std::vector<FunctionOverload> &overloads = _overloads[name];
+            for (unsigned j = 0, size = overloads.size(); j < size; ++j) {
+                if (overloads[j].Func == func) {
+                    Helpers::Error(proto->getPos(), "Redefinition of function '%s' with the same parameter types.", name.c_str());
+                    return false;
+                }
+            }
+            FunctionOverload overload = { func, std::vector<AstNodeType>() };
+            for (unsigned j = 0, size = proto->getArgs().size(); j < size; ++j) {
+                AstTypeNode *type = proto->getArgs()[j].second;
+                overload.ParamTypes.push_back(type->getIsArray() ? node_default : type->getTypeType());
+            }
+            overloads.push_back(overload);
+        }
+    }
+    for (int i = 0, e = trees->ClassDefinitions.size(); i < e; ++i) { // declare methods
+        if (!trees->ClassDefinitions[i]->DeclareMethods(this)) {
             return false;
         }
     }
@@ -122,9 +199,17 @@ bool CodeGenerator::GenerateCode(TreeContainer *trees, bool dumpOnFail) {
 
     this->_dumpOnFail = dumpOnFail;
 
+    if (!declareClasses(trees))
+        return false;
+
     if (!declareFunctions(trees))
         return false;
     
+    for (int i = 0, e = trees->ClassDefinitions.size(); i < e; ++i) { // define the methods
+        if (!trees->ClassDefinitions[i]->CodegenMethods(this)) {
+            return false;
+        }
+    }
     for (int i = 0, e = trees->FunctionDefinitions.size(); i < e; ++i) { // define the functions
         if (trees->FunctionDefinitions[i]->Codegen(this) == nullptr) {
             return false;
@@ -137,7 +222,7 @@ bool CodeGenerator::GenerateCode(TreeContainer *trees, bool dumpOnFail) {
             return false;
         }
     }
-    return true;
+    return generateInstantiations();
 }
 
 void CodeGenerator::CacheLastModule() {
@@ -160,11 +245,18 @@ void CodeGenerator::RunMain() {
         DumpMainModule();
         return;
     }
+    // 'printf' writes into the same buffer as the other output functions so the two stay in order.
+    if (Function *printfFunc = _theModule->getFunction("printf")) {
+        if (printfFunc->isDeclaration()) {
+            printfFunc->setName("demi_output_printf");
+        }
+    }
     _theExecutionEngine->finalizeObject();
     void *mainFnPtr = _theExecutionEngine->getPointerToFunction(mainFunc);
 
     int(*FP)() = (int(*)())mainFnPtr;
     FP();
+    demi_output_flush();
 }
 
 // Returns the context
@@ -233,46 +325,204 @@ void CodeGenerator::setCurrentFunction(llvm::Function* func) {
 
 // Clears the named values
 void CodeGenerator::clearNamedValues() { 
-    _namedValues.clear(); 
+    _namedValues.Clear(); 
+    _atomicValues.clear();
+    _ownedStrings.clear();
 }
-// Returns the AllocaInst at a given key
+// Returns the innermost variable in scope with a given name, or nullptr.
 AllocaInst *CodeGenerator::getNamedValue(const std::string &key) const {
-    if (_namedValues.count(key)) {
-        return _namedValues.at(key);
+    return _namedValues.Lookup(NameTable::Intern(key));
+}
+AllocaInst *CodeGenerator::getNamedValue(NameTable::NameId id) const {
+    return _namedValues.Lookup(id);
+}
+// Declares a variable in the current scope, shadowing any outer one with the same name.
+void CodeGenerator::setNamedValue(const std::string &key, AllocaInst *val) {
+    _namedValues.Declare(NameTable::Intern(key), val);
+}
+void CodeGenerator::setNamedValue(NameTable::NameId id, AllocaInst *val) {
+    _namedValues.Declare(id, val);
+}
+
+// Rebinds an existing key to another AllocaInst without declaring anything
+// and returns the AllocaInst previously bound to it.
+AllocaInst *CodeGenerator::replaceNamedValue(const std::string &key, AllocaInst *val) {
+    return _namedValues.Replace(NameTable::Intern(key), val);
+}
+
+// Marks a variable as declared with an atomic type.
+void CodeGenerator::setIsAtomic(AllocaInst *val) {
+    _atomicValues.insert(val);
+}
+// Returns whether a variable was declared with an atomic type.
+bool CodeGenerator::getIsAtomic(Value *val) const {
+    return _atomicValues.count(val) != 0;
+}
+
+// Marks a variable or temporary as holding references to strings, a string or an instance or array of them,
+// released when the function returns.
+void CodeGenerator::setOwnsString(AllocaInst *val) {
+    _ownedStrings.push_back(val);
+}
+// Returns the variables and temporaries of the current function holding references to strings.
+const std::vector<AllocaInst*> &CodeGenerator::getOwnedStrings() const {
+    return _ownedStrings;
+}
+
+// Removes the last variables declared, restoring the ones they shadowed.
+void CodeGenerator::popFromScopeStack(unsigned howMany) {
+    _namedValues.Pop(howMany);
+}
+
+// Returns the number of variables in scope, including parameters.
+unsigned int CodeGenerator::getVarCount() const { 
+    return _namedValues.GetDepth();
+}
+
+ClassAst *CodeGenerator::getCurrentClass() const {
+    return this->_currentClass;
+}
+
+void CodeGenerator::setCurrentClass(ClassAst *classAst) {
+    this->_currentClass = classAst;
+}
+
+// Enters an 'arena' block, 'new' allocates from the innermost arena.
+void CodeGenerator::pushArena(Value *arena) {
+    _arenas.push_back(arena);
+}
+// Leaves the innermost 'arena' block.
+void CodeGenerator::popArena() {
+    _arenas.pop_back();
+}
+// Returns the arena 'new' allocates from, or nullptr to allocate from the heap.
+Value *CodeGenerator::getArena() const {
+    return _arenas.empty() ? nullptr : _arenas.back();
+}
+// Returns the arenas of the enclosing 'arena' blocks, innermost last.
+const std::vector<Value*> &CodeGenerator::getArenas() const {
+    return _arenas;
+}
+
+bool CodeGenerator::getDumpOnFail() const {
+    return _dumpOnFail;
+}
+// Returns the class with the given name, or nullptr if there is none.
+ClassAst *CodeGenerator::getClass(const std::string &name) const {
+    auto found = _classes.find(name);
+    if (found == _classes.end()) {
+        return nullptr;
+    }
+    return found->second;
+}
+// Returns the class a struct-of-arrays type was made for, or nullptr if the type isn't one.
+ClassAst *CodeGenerator::getSoaClass(Type *type) const {
+    if (!type->isStructTy()) {
+        return nullptr;
+    }
+    for (auto found = _classes.begin(); found != _classes.end(); ++found) {
+        if (found->second->IsSoaType(type)) {
+            return found->second;
+        }
     }
     return nullptr;
 }
-// Pushes the key to the Scope Stack and sets the AllocaInst at a given key 
-// if it does not exist yet, and returns a <itr, bool> pair
-std::pair<std::map<std::string, AllocaInst*>::iterator, bool> CodeGenerator::setNamedValue(std::string key, AllocaInst *val) {
-    auto success = _namedValues.insert({ key, val });
-    if (success.second) { // if the variable was successfully created, push it onto the stack.
-        _scopeStack.push_back(key);
+
+// Returns the generic function with the given name, or nullptr if there is none.
+GenericFunctionAst *CodeGenerator::getGenericFunction(const std::string &name) const {
+    auto found = _genericFunctions.find(name);
+    if (found == _genericFunctions.end()) {
+        return nullptr;
     }
-    return success;
+    return found->second;
 }
-// Erases an AllocaInst from the map.
-void CodeGenerator::eraseNamedValue(const std::string &key) { 
-    _namedValues.erase(key);
+// Takes an instantiation of a generic function whose prototype is declared, its body is generated later.
+void CodeGenerator::addInstantiation(FunctionAst *instance) {
+    _instantiations.push_back(instance);
 }
 
-// Clears the Scope Stack for the local scope and removes them from the NamedValues set.
-void CodeGenerator::popFromScopeStack(unsigned howMany) {
-    while (!_scopeStack.empty() && howMany-- && _varCount--) {
-        eraseNamedValue(_scopeStack.back());
-        _scopeStack.pop_back();
+// Returns the functions defined with the given name if it's overloaded, or nullptr.
+const std::vector<FunctionOverload> *CodeGenerator::getOverloads(const std::string &name) const {
+    auto found = _overloads.find(name);
+    if (found == _overloads.end()) {
+        return nullptr;
     }
+    return &found->second;
+}
+
+// Sets the passes the trees go through before code generation, instantiations go through them when they're made.
+void CodeGenerator::setPasses(AstSimplifier *simplifier, AstTypeChecker *typeChecker) {
+    _simplifier = simplifier;
+    _typeChecker = typeChecker;
 }
-// Increments the variable count
-void CodeGenerator::incrementVarCount() { 
-    _varCount++;
+AstSimplifier *CodeGenerator::getSimplifier() const {
+    return _simplifier;
+}
+AstTypeChecker *CodeGenerator::getTypeChecker() const {
+    return _typeChecker;
 }
 
-// Returns the Variable count.
-unsigned int CodeGenerator::getVarCount() const { 
-    return _varCount;
+// Returns whether 'new' allocates from the garbage collected heap.
+bool CodeGenerator::getUseGC() const {
+    return _useGC;
+}
+// Sets whether 'new' allocates from the garbage collected heap.
+void CodeGenerator::setUseGC(bool useGC) {
+    _useGC = useGC;
+}
+// Returns the collector's description of where the pointers are in an element of a type, as an i8*.
+// Laid out as the runtime's DemiTypeInfo: { size, pointer count, [pointer count x offset] }.
+Constant *CodeGenerator::getGCTypeInfo(Type *type) {
+    auto found = _gcTypeInfos.find(type);
+    if (found != _gcTypeInfos.end()) {
+        return found->second;
+    }
+    const DataLayout *layout = _theModule->getDataLayout();
+    std::vector<uint64_t> offsets;
+    Helpers::GetPointerOffsets(layout, type, 0, offsets);
+
+    Type *int64Ty = Type::getInt64Ty(_context);
+    std::vector<Constant*> offsetConstants;
+    for (auto offset = offsets.begin(); offset != offsets.end(); ++offset) {
+        offsetConstants.push_back(ConstantInt::get(int64Ty, *offset));
+    }
+    ArrayType *offsetsTy = ArrayType::get(int64Ty, offsets.size());
+    std::vector<Constant*> fields = {
+        ConstantInt::get(int64Ty, layout->getTypeAllocSize(type)),
+        ConstantInt::get(int64Ty, offsets.size()),
+        ConstantArray::get(offsetsTy, offsetConstants)
+    };
+    Constant *info = ConstantStruct::getAnon(_context, fields);
+    GlobalVariable *global = new GlobalVariable(*_theModule, info->getType(), true, GlobalValue::PrivateLinkage, info, "gc.typeinfo");
+    Constant *infoPtr = ConstantExpr::getBitCast(global, Type::getInt8PtrTy(_context));
+    _gcTypeInfos[type] = infoPtr;
+    return infoPtr;
 }
 
-bool CodeGenerator::getDumpOnFail() const {
-    return _dumpOnFail;
+// Returns the type 'string' is lowered to, laid out as the runtime's DemiString.
+StructType *CodeGenerator::getStringType() const {
+    return _stringType;
+}
+// Returns the chars of a string literal, every occurrence of the same literal in the module shares one constant.
+Constant *CodeGenerator::getStringLiteral(const std::string &val) {
+    auto found = _stringLiterals.find(val);
+    if (found != _stringLiterals.end()) {
+        return found->second;
+    }
+    Constant *chars = ConstantDataArray::getString(_context, val);
+    GlobalVariable *global = new GlobalVariable(*_theModule, chars->getType(), true, GlobalValue::PrivateLinkage,
+        chars, "globalstr_" + val.substr(0, 10));
+    global->setUnnamedAddr(true);
+    Constant *indices[] = { _builder.getInt32(0), _builder.getInt32(0) };
+    Constant *literal = ConstantExpr::getInBoundsGetElementPtr(global, indices);
+    _stringLiterals[val] = literal;
+    return literal;
+}
+// Marks an external function whose 'string' result is a C string.
+void CodeGenerator::setReturnsCString(Function *func) {
+    _cStringFunctions.insert(func);
+}
+// Returns whether a function is external and returns a C string for a 'string'.
+bool CodeGenerator::getReturnsCString(Function *func) const {
+    return _cStringFunctions.count(func) != 0;
 }
@@ -1,9 +1,21 @@
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+#include <algorithm>
+#include <set>
 #include <stdarg.h>
 
 #include "CodeGenerator/CodeGenerator.h"
 #include "Compiler/TreeContainer.h"
 #include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "AstNodes/AstBinaryOperatorExpr.h"
+#include "AstNodes/AstUnaryOperatorExpr.h"
+#include "AstNodes/AstVariableNode.h"
+#include "AstNodes/AstVisitor.h"
+#include "Runtime/DemiurgeString.h"
+#include "DEFINES.h"
 
 
 using namespace llvm;
@@ -29,8 +41,6 @@ namespace Helpers {
     }
 
     namespace BinOperations {
-        typedef std::map<Type::TypeID, std::map<Type::TypeID, GetFuncPtr > > LookupTableMapMap;
-
         Value *FailedLookupFunc(CodeGenerator *codegen, Value *lhs, Value *rhs) {
             return nullptr;
         }
@@ -143,122 +153,71 @@ namespace Helpers {
             }
         }
 
-        // int:double | double:int
+        // int:double | double:int, also with floats and float:double
         Value *intToDouble(CodeGenerator *codegen, Value *intValue) {
             return codegen->getBuilder().CreateSIToFP(intValue, Type::getDoubleTy(codegen->getContext()), "uintToFp");
         }
         Value *doubleToInt(CodeGenerator *codegen, Value *doubleValue) {
             return codegen->getBuilder().CreateSIToFP(doubleValue, Type::getInt32Ty(codegen->getContext()), "fpToUint");
         }
-
-        Value *intdoubleAdd(CodeGenerator *codegen, Value *lhs, Value *rhs) {
+        void matchFloatingOperands(CodeGenerator *codegen, Value *&lhs, Value *&rhs) {
+            IRBuilder<> &builder = codegen->getBuilder();
             if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
+                lhs = builder.CreateSIToFP(lhs, rhs->getType(), "intToFp");
             }
-            else {
-                rhs = intToDouble(codegen, rhs);
+            else if (rhs->getType()->isIntegerTy()) {
+                rhs = builder.CreateSIToFP(rhs, lhs->getType(), "intToFp");
+            }
+            if (lhs->getType()->isFloatTy() && rhs->getType()->isDoubleTy()) {
+                lhs = builder.CreateFPExt(lhs, rhs->getType(), "fpext");
             }
+            else if (lhs->getType()->isDoubleTy() && rhs->getType()->isFloatTy()) {
+                rhs = builder.CreateFPExt(rhs, lhs->getType(), "fpext");
+            }
+        }
 
+        Value *intdoubleAdd(CodeGenerator *codegen, Value *lhs, Value *rhs) {
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFAdd(lhs, rhs, "intdoubleAdd");
         }
         Value *intdoubleSub(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFSub(lhs, rhs, "intdoubleSub");
         }
         Value *intdoubleMul(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFMul(lhs, rhs, "intdoubleMul");
         }
         Value *intdoubleDiv(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFDiv(lhs, rhs, "intdoubleDiv");
         }
         Value *intdoubleMod(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFRem(lhs, rhs, "intdoubleMod");
         }
         Value *intdoubleLT(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpULT(lhs, rhs, "intdoubleLT");
         }
         Value *intdoubleGT(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpUGT(lhs, rhs, "intdoubleGT");
         }
         Value *intdoubleLE(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpULE(lhs, rhs, "intdoubleLE");
         }
         Value *intdoubleGE(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpUGE(lhs, rhs, "intdoubleGE");
         }
         Value *intdoubleEQ(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpOEQ(lhs, rhs, "intdoubleEQ");
         }
         Value *intdoubleNE(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-            if (lhs->getType()->isIntegerTy()) {
-                lhs = intToDouble(codegen, lhs);
-            }
-            else {
-                rhs = intToDouble(codegen, rhs);
-            }
-
+            matchFloatingOperands(codegen, lhs, rhs);
             return codegen->getBuilder().CreateFCmpONE(lhs, rhs, "intdoubleNE");
         }
 
@@ -279,7 +238,7 @@ namespace Helpers {
             }
         }
 
-        // double:double
+        // double:double | float:float, also elementwise on vectors of them
         Value *doubledoubleAdd(CodeGenerator *codegen, Value *lhs, Value *rhs) {
             return codegen->getBuilder().CreateFAdd(lhs, rhs, "doubledoubleAdd");
         }
@@ -331,22 +290,170 @@ namespace Helpers {
             }
         }
 
-        LookupTableMapMap getBinOpLookupTable(bool isUnsigned) {
-            LookupTableMapMap lookupTable;
-            lookupTable[Type::IntegerTyID][Type::IntegerTyID] = isUnsigned ? getIntIntUnsignedFuncPtr : getIntIntSignedFuncPtr;
-            lookupTable[Type::IntegerTyID][Type::DoubleTyID] = getIntDoubleFuncPtr;
-            lookupTable[Type::DoubleTyID][Type::IntegerTyID] = getIntDoubleFuncPtr;
-            lookupTable[Type::DoubleTyID][Type::DoubleTyID] = getDoubleDoubleFuncPtr;
-            return lookupTable;
+        // ptr:ptr, a pointer compared to one of another type is compared as the same type.
+        Value *ptrptrEQ(CodeGenerator *codegen, Value *lhs, Value *rhs) {
+            rhs = codegen->getBuilder().CreatePointerCast(rhs, lhs->getType());
+            return codegen->getBuilder().CreateICmpEQ(lhs, rhs, "ptrptrEQ");
+        }
+        Value *ptrptrNE(CodeGenerator *codegen, Value *lhs, Value *rhs) {
+            rhs = codegen->getBuilder().CreatePointerCast(rhs, lhs->getType());
+            return codegen->getBuilder().CreateICmpNE(lhs, rhs, "ptrptrNE");
+        }
+
+        BinOpCodeGenFuncPtr getPtrPtrFuncPtr(TokenType oper) {
+            switch (oper) {
+            default: return FailedLookupFunc;
+            case tok_equalequal: return ptrptrEQ;
+            case tok_notequal: return ptrptrNE;
+            }
         }
+
+        enum OperandKind {
+            kind_integer,
+            kind_float,
+            kind_double,
+            kind_pointer,
+            kind_integer_vector,
+            kind_floating_vector,
+            kind_other,
+            OperandKindCount
+        };
+
+        // The binary operators that have code generating functions, in the order of the dispatch matrix.
+        const TokenType Operators[] = {
+            (TokenType)'+', (TokenType)'-', (TokenType)'*', (TokenType)'/', (TokenType)'%',
+            (TokenType)'&', (TokenType)'|', (TokenType)'^', tok_leftshift, tok_rightshift,
+            (TokenType)'<', (TokenType)'>', tok_lessequal, tok_greatequal, tok_equalequal, tok_notequal,
+        };
+        const unsigned OperatorCount = sizeof(Operators) / sizeof(Operators[0]);
+
+        OperandKind getOperandKind(Type *type) {
+            switch (type->getTypeID()) {
+            default: return kind_other;
+            case Type::IntegerTyID: return kind_integer;
+            case Type::FloatTyID: return kind_float;
+            case Type::DoubleTyID: return kind_double;
+            case Type::PointerTyID: return kind_pointer;
+            case Type::VectorTyID:
+                if (type->getVectorElementType()->isIntegerTy()) {
+                    return kind_integer_vector;
+                }
+                return type->getVectorElementType()->isFloatingPointTy() ? kind_floating_vector : kind_other;
+            }
+        }
+
+        // Tokens above this aren't operators, the lookup of an operator's index is sized to it.
+        const unsigned TokenCount = tok_rightshiftequal + 1;
+
+        // The code generating function for each pair of operand kinds, signedness and operator, nullptr where the
+        // operator doesn't exist for the operands. It's filled in once from the lookups of each pair of kinds.
+        struct DispatchMatrix {
+            BinOpCodeGenFuncPtr Funcs[OperandKindCount][OperandKindCount][2][OperatorCount];
+            int OperatorIndices[TokenCount]; // each token's index in Operators, -1 if it has no code generating functions.
+
+            DispatchMatrix() {
+                std::fill(&Funcs[0][0][0][0], &Funcs[0][0][0][0] + sizeof(Funcs) / sizeof(Funcs[0][0][0][0]), nullptr);
+                std::fill(OperatorIndices, OperatorIndices + TokenCount, -1);
+                for (unsigned i = 0; i < OperatorCount; ++i) {
+                    OperatorIndices[Operators[i]] = i;
+                }
+                set(kind_integer, kind_integer, getIntIntSignedFuncPtr, getIntIntUnsignedFuncPtr);
+                set(kind_integer_vector, kind_integer_vector, getIntIntSignedFuncPtr, getIntIntUnsignedFuncPtr);
+                const OperandKind floating[] = { kind_float, kind_double };
+                for (unsigned i = 0; i < 2; ++i) {
+                    set(floating[i], floating[i], getDoubleDoubleFuncPtr, getDoubleDoubleFuncPtr);
+                    set(floating[i], floating[1 - i], getIntDoubleFuncPtr, getIntDoubleFuncPtr);
+                    set(floating[i], kind_integer, getIntDoubleFuncPtr, getIntDoubleFuncPtr);
+                    set(kind_integer, floating[i], getIntDoubleFuncPtr, getIntDoubleFuncPtr);
+                }
+                set(kind_floating_vector, kind_floating_vector, getDoubleDoubleFuncPtr, getDoubleDoubleFuncPtr);
+                set(kind_pointer, kind_pointer, getPtrPtrFuncPtr, getPtrPtrFuncPtr);
+            }
+
+            void set(OperandKind lhs, OperandKind rhs, GetFuncPtr signedFuncs, GetFuncPtr unsignedFuncs) {
+                for (unsigned i = 0; i < OperatorCount; ++i) {
+                    BinOpCodeGenFuncPtr func = signedFuncs(Operators[i]);
+                    Funcs[lhs][rhs][0][i] = func != FailedLookupFunc ? func : nullptr;
+                    func = unsignedFuncs(Operators[i]);
+                    Funcs[lhs][rhs][1][i] = func != FailedLookupFunc ? func : nullptr;
+                }
+            }
+        };
     }
-    // Returns a pointer to a function which will generate the proper LLVM code to handle the operator and types passed.
+    // Returns a pointer to a function which will generate the proper LLVM code to handle the operator and types passed,
+    // or nullptr if the operator doesn't exist for them.
     BinOperations::BinOpCodeGenFuncPtr GetBinopCodeGenFuncPointer(TokenType Operator, Type *lType, Type *rType, bool isUnsigned) {
-        auto func = BinOperations::getBinOpLookupTable(isUnsigned)[lType->getTypeID()][rType->getTypeID()];
-        if (func == nullptr) {
+        static const BinOperations::DispatchMatrix matrix;
+        int index = unsigned(Operator) < BinOperations::TokenCount ? matrix.OperatorIndices[Operator] : -1;
+        if (index < 0) {
             return nullptr;
         }
-        return func(Operator);
+        return matrix.Funcs[BinOperations::getOperandKind(lType)][BinOperations::getOperandKind(rType)][isUnsigned][index];
+    }
+
+    // Returns the identity value of a reduction operator for the type passed, e.g. 0 for '+' and 1 for '*',
+    // returns nullptr if the operator cannot be used as a reduction on that type.
+    Value *GetReductionIdentity(CodeGenerator *codegen, TokenType Operator, Type *type, bool isUnsigned) {
+        if (type->isIntegerTy() && !type->isIntegerTy(1)) {
+            unsigned bitwidth = type->getIntegerBitWidth();
+            switch (Operator) {
+            default: return nullptr;
+            case '+':
+            case '|':
+            case '^': return ConstantInt::get(type, 0);
+            case '*': return ConstantInt::get(type, 1);
+            case '&': return ConstantInt::get(codegen->getContext(), APInt::getAllOnesValue(bitwidth));
+            case '<': // min
+                return ConstantInt::get(codegen->getContext(), isUnsigned ? APInt::getMaxValue(bitwidth) : APInt::getSignedMaxValue(bitwidth));
+            case '>': // max
+                return ConstantInt::get(codegen->getContext(), isUnsigned ? APInt::getMinValue(bitwidth) : APInt::getSignedMinValue(bitwidth));
+            }
+        }
+        if (type->isFloatingPointTy()) {
+            switch (Operator) {
+            default: return nullptr;
+            case '+': return ConstantFP::get(type, 0.0);
+            case '*': return ConstantFP::get(type, 1.0);
+            case '<': return ConstantFP::getInfinity(type, false); // min
+            case '>': return ConstantFP::getInfinity(type, true);  // max
+            }
+        }
+        return nullptr;
+    }
+
+    // Combines the partial results of a reduction pairwise as a balanced tree and returns the final value,
+    // '<' and '>' are treated as 'min' and 'max'. Returns nullptr if the partials could not be combined.
+    Value *CreateReductionTree(CodeGenerator *codegen, TokenType Operator, std::vector<Value*> partials, bool isUnsigned) {
+        if (partials.empty()) {
+            return nullptr;
+        }
+        Type *type = partials[0]->getType();
+        auto funcPtr = GetBinopCodeGenFuncPointer(Operator, type, type, isUnsigned);
+        if (funcPtr == nullptr) {
+            return nullptr;
+        }
+        bool isMinMax = Operator == '<' || Operator == '>';
+        while (partials.size() > 1) { // combine neighbours until a single value is left.
+            std::vector<Value*> combined;
+            for (unsigned i = 0, size = partials.size(); i < size; i += 2) {
+                if (i + 1 == size) { // odd one out, carried up to the next level.
+                    combined.push_back(partials[i]);
+                    continue;
+                }
+                Value *lhs = partials[i];
+                Value *rhs = partials[i + 1];
+                Value *val = funcPtr(codegen, lhs, rhs);
+                if (val == nullptr) {
+                    return nullptr;
+                }
+                if (isMinMax) {
+                    val = codegen->getBuilder().CreateSelect(val, lhs, rhs, Operator == '<' ? "reducemin" : "reducemax");
+                }
+                combined.push_back(val);
+            }
+            partials.swap(combined);
+        }
+        return partials[0];
     }
 
     // EmitScopeBlock - Emits a std::vector of ast::IAstExpr* expressions and returns their value
@@ -462,24 +569,6 @@ namespace Helpers {
     Value *GetTwo_8(CodeGenerator *codegen) {
         return GetInt8(codegen, 2);
     }
-    // Normalizes integer bitwidths, basically just casts up to the larger.
-    void NormalizeIntegerWidths(CodeGenerator *codegen, Value *lhs, Value *rhs) {
-        Type *lType = lhs->getType();
-        Type *rType = rhs->getType();
-        // If either type is not an integer or they are already the same size, return with no change.
-        if (!lType->isIntegerTy() || !rType->isIntegerTy() || lType->getIntegerBitWidth() == rType->getIntegerBitWidth()) {
-            return;
-        }
-
-        if (lType->getIntegerBitWidth() > rType->getIntegerBitWidth()) { // lhs has higher bit width, cast rhs to lhs size.
-            rhs = CreateCastTo(codegen, rhs, lType);
-            //rhs = codegen->getBuilder().CreateIntCast(rhs, lType,)
-        }
-        else { // rhs has higher bit width, cast lhs to rhs size.
-            lhs = CreateCastTo(codegen, lhs, rType);
-        }
-    }
-
     // Creates a Value* of integer type with specified width from the value passed.
     Value *GetInt(CodeGenerator *codegen, demi_int val, int bitwidth) {
         return ConstantInt::get(codegen->getContext(), APInt(bitwidth, val, true));
@@ -534,9 +623,14 @@ namespace Helpers {
     Value *GetUInt8(CodeGenerator *codegen, demi_int val) {
         return GetUInt(codegen, val, 8);
     }
-    // Creates a Value* of integer8* type from the value passed.
+    // Creates a string constant of the value passed, its chars are never freed.
     Value *GetString(CodeGenerator *codegen, std::string val) {
-        return ConstantDataArray::getString(codegen->getContext(), val.c_str());
+        std::vector<Constant*> fields = {
+            codegen->getStringLiteral(val),
+            codegen->getBuilder().getInt64(val.size()),
+            codegen->getBuilder().getInt64(DEMI_STRING_KIND_STATIC)
+        };
+        return ConstantStruct::get(codegen->getStringType(), fields);
     }
 
 
@@ -602,6 +696,13 @@ namespace Helpers {
         }
     }
 
+    std::string GetLLVMTypeSignature(Type *type) {
+        std::string signature;
+        raw_string_ostream stream(signature);
+        type->print(stream);
+        return stream.str();
+    }
+
     // Returns the pointer to the first element of an array.
     Value *CreateArrayDecay(CodeGenerator *codegen, Value *val) {
         Value *zero = GetDemiUInt(codegen, 0);
@@ -670,7 +771,8 @@ namespace Helpers {
         case node_unsigned_integer32: return GetUInt32(codegen, 0);
         case node_unsigned_integer64: return GetUInt64(codegen, 0);
 
-        case node_string: return GetString(codegen, "");
+        case node_string: return Constant::getNullValue(codegen->getStringType()); // the empty string.
+        case node_struct: return Constant::getNullValue(typeNode->GetLLVMType(codegen)); // all fields zeroed.
         }
     }
 
@@ -712,4 +814,657 @@ namespace Helpers {
     Value *CreateFreeCall(CodeGenerator *codegen, Value *ptr) {
         return nullptr;
     }
+
+    // Returns the declaration of a function exported by the compiler's runtime, declaring it if needed.
+    Constant *GetRuntimeFunction(CodeGenerator *codegen, const std::string &name, Type *returnType,
+        const std::vector<Type*> &argTypes) {
+        FunctionType *funcType = FunctionType::get(returnType, argTypes, false);
+        return codegen->getTheModule()->getOrInsertFunction(name, funcType);
+    }
+
+    // Builtins:
+    //   open(path : string) : int        a file handle, 0 if it can't be opened.
+    //   read_line(file : int) : string   the next line, a view valid until the file is closed.
+    //   eof(file : int) : bool           whether every line has been read.
+    //   close(file : int) : void
+    //   map_file(path : string) : string the whole file as a view.
+    Function *GetBuiltinFunction(CodeGenerator *codegen, const std::string &name) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        Type *stringType = codegen->getStringType();
+        Type *stringPtrType = stringType->getPointerTo();
+        Type *handleType = builder.getInt64Ty();
+        Type *fileType = builder.getInt8PtrTy();
+        FunctionType *funcType;
+        if (name == "open") {
+            funcType = FunctionType::get(handleType, std::vector<Type*>(1, stringType), false);
+        }
+        else if (name == "read_line") {
+            funcType = FunctionType::get(stringType, std::vector<Type*>(1, handleType), false);
+        }
+        else if (name == "eof") {
+            funcType = FunctionType::get(builder.getInt1Ty(), std::vector<Type*>(1, handleType), false);
+        }
+        else if (name == "close") {
+            funcType = FunctionType::get(builder.getVoidTy(), std::vector<Type*>(1, handleType), false);
+        }
+        else if (name == "map_file") {
+            funcType = FunctionType::get(stringType, std::vector<Type*>(1, stringType), false);
+        }
+        else {
+            return nullptr;
+        }
+        Function *func = Function::Create(funcType, Function::InternalLinkage, name, codegen->getTheModule());
+        IRBuilderBase::InsertPointGuard guard(builder);
+        builder.SetInsertPoint(BasicBlock::Create(codegen->getContext(), "entry", func));
+        Value *arg = func->arg_begin();
+        if (name == "open") {
+            Value *path = builder.CreateAlloca(stringType, nullptr, "path");
+            builder.CreateStore(arg, path);
+            Constant *open = GetRuntimeFunction(codegen, "demi_file_open", fileType, std::vector<Type*>(1, stringPtrType));
+            builder.CreateRet(builder.CreatePtrToInt(builder.CreateCall(open, path), handleType));
+        }
+        else if (name == "read_line") {
+            Value *line = builder.CreateAlloca(stringType, nullptr, "line");
+            std::vector<Type*> args = { fileType, stringPtrType };
+            Constant *readLine = GetRuntimeFunction(codegen, "demi_file_read_line", builder.getVoidTy(), args);
+            builder.CreateCall2(readLine, builder.CreateIntToPtr(arg, fileType), line);
+            builder.CreateRet(builder.CreateLoad(line));
+        }
+        else if (name == "eof") {
+            Constant *eof = GetRuntimeFunction(codegen, "demi_file_eof", builder.getInt1Ty(), std::vector<Type*>(1, fileType));
+            builder.CreateRet(builder.CreateCall(eof, builder.CreateIntToPtr(arg, fileType)));
+        }
+        else if (name == "close") {
+            Constant *close = GetRuntimeFunction(codegen, "demi_file_close", builder.getVoidTy(), std::vector<Type*>(1, fileType));
+            builder.CreateCall(close, builder.CreateIntToPtr(arg, fileType));
+            builder.CreateRetVoid();
+        }
+        else { // map_file
+            Value *path = builder.CreateAlloca(stringType, nullptr, "path");
+            Value *contents = builder.CreateAlloca(stringType, nullptr, "contents");
+            builder.CreateStore(arg, path);
+            std::vector<Type*> args(2, stringPtrType);
+            Constant *mapFile = GetRuntimeFunction(codegen, "demi_file_map", builder.getVoidTy(), args);
+            builder.CreateCall2(mapFile, contents, path);
+            builder.CreateRet(builder.CreateLoad(contents));
+        }
+        return func;
+    }
+
+    // Returns whether an expression is a variable or an element of an array declared with an atomic type.
+    bool IsAtomicLValue(CodeGenerator *codegen, IAstExpression *expr) {
+        AstUnaryOperatorExpr *unary = AstCast<AstUnaryOperatorExpr>(expr);
+        bool isElement = unary != nullptr && unary->getOperator() == '[';
+        AstVariableNode *variable = AstCast<AstVariableNode>(isElement ? unary->getOperand() : expr);
+        if (variable == nullptr) {
+            return false;
+        }
+        AllocaInst *alloca = codegen->getNamedValue(variable->getNameId());
+        if (alloca == nullptr || !codegen->getIsAtomic(alloca)) {
+            return false;
+        }
+        // Atomic arrays have atomic elements, the array itself isn't.
+        return isElement || alloca->getAllocatedType()->isIntegerTy();
+    }
+
+    // Returns the address of an assignable expression, a variable, an array element or a field, and sets 'isAtomic'
+    // to whether it was declared with an atomic type. Returns nullptr if the expression can't be assigned to.
+    Value *GetLValueAddress(CodeGenerator *codegen, IAstExpression *expr, bool *isAtomic) {
+        if (isAtomic != nullptr) {
+            *isAtomic = IsAtomicLValue(codegen, expr);
+        }
+        if (AstVariableNode *variable = AstCast<AstVariableNode>(expr)) {
+            AllocaInst *alloca = codegen->getNamedValue(variable->getNameId());
+            if (alloca == nullptr) {
+                return Error(expr->getPos(), "Unknown variable name '%s'", variable->getName().c_str());
+            }
+            return alloca;
+        }
+        AstUnaryOperatorExpr *unary = AstCast<AstUnaryOperatorExpr>(expr);
+        if (unary != nullptr && unary->getOperator() == '[') {
+            return unary->ElementAddress(codegen);
+        }
+        AstBinaryOperatorExpr *member = AstCast<AstBinaryOperatorExpr>(expr);
+        if (member != nullptr && member->getOperator() == '.') {
+            return member->MemberAddress(codegen);
+        }
+        return nullptr;
+    }
+
+    // Returns the strongest ordering a failed compare-exchange may have for a given success ordering.
+    AtomicOrdering GetCmpXchgFailureOrdering(AtomicOrdering ordering) {
+        switch (ordering) {
+        default: return ordering;
+        case Release: return Monotonic;
+        case AcquireRelease: return Acquire;
+        }
+    }
+
+    // Creates an atomic load of an integer with the given ordering.
+    Value *CreateAtomicLoad(CodeGenerator *codegen, Value *ptr, AtomicOrdering ordering) {
+        Type *type = ptr->getType()->getPointerElementType();
+        unsigned align = codegen->getTheModule()->getDataLayout()->getABITypeAlignment(type);
+        LoadInst *load = codegen->getBuilder().CreateAlignedLoad(ptr, align, "atomicload");
+        load->setAtomic(ordering);
+        return load;
+    }
+
+    // Creates an atomic store of an integer with the given ordering, 'val' is implicitly cast to the destination type.
+    Value *CreateAtomicStore(CodeGenerator *codegen, Value *val, Value *ptr, AtomicOrdering ordering) {
+        Type *type = ptr->getType()->getPointerElementType();
+        val = CreateImplicitCast(codegen, val, type);
+        if (val == nullptr) {
+            return nullptr;
+        }
+        unsigned align = codegen->getTheModule()->getDataLayout()->getABITypeAlignment(type);
+        StoreInst *store = codegen->getBuilder().CreateAlignedStore(val, ptr, align);
+        store->setAtomic(ordering);
+        return val;
+    }
+
+    // Atomically replaces the integer at 'ptr' with the result of 'Operator' applied to it and 'val', using atomicrmw
+    // when LLVM has an equivalent operation and a cmpxchg loop otherwise. Returns the previous value and sets 'updated'
+    // to the new one, returns nullptr if the operator doesn't exist for the types.
+    Value *CreateAtomicUpdate(CodeGenerator *codegen, TokenType Operator, Value *ptr, Value *val, bool isUnsigned,
+        AtomicOrdering ordering, Value **updated) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        Type *type = ptr->getType()->getPointerElementType();
+        val = CreateImplicitCast(codegen, val, type);
+        auto funcPtr = val == nullptr ? nullptr : GetBinopCodeGenFuncPointer(Operator, type, type, isUnsigned);
+        if (funcPtr == nullptr || funcPtr == BinOperations::FailedLookupFunc) {
+            return nullptr;
+        }
+
+        AtomicRMWInst::BinOp rmwOp = AtomicRMWInst::BAD_BINOP;
+        switch (Operator) {
+        default: break;
+        case '+': rmwOp = AtomicRMWInst::Add; break;
+        case '-': rmwOp = AtomicRMWInst::Sub; break;
+        case '&': rmwOp = AtomicRMWInst::And; break;
+        case '|': rmwOp = AtomicRMWInst::Or; break;
+        case '^': rmwOp = AtomicRMWInst::Xor; break;
+        }
+        if (rmwOp != AtomicRMWInst::BAD_BINOP) {
+            Value *previous = builder.CreateAtomicRMW(rmwOp, ptr, val, ordering);
+            if (updated != nullptr) {
+                *updated = funcPtr(codegen, previous, val);
+            }
+            return previous;
+        }
+
+        // No single instruction for this operator, retry a compare-exchange until no other thread got in between.
+        Function *func = codegen->getCurrentFunction();
+        BasicBlock *outsideBB = codegen->getOutsideBlock();
+        BasicBlock *loopBB = BasicBlock::Create(codegen->getContext(), "atomic_loop", func, outsideBB);
+        BasicBlock *doneBB = BasicBlock::Create(codegen->getContext(), "atomic_done", func, outsideBB);
+        Value *initial = CreateAtomicLoad(codegen, ptr, Monotonic);
+        BasicBlock *entryBB = builder.GetInsertBlock();
+        builder.CreateBr(loopBB);
+
+        builder.SetInsertPoint(loopBB);
+        PHINode *previous = builder.CreatePHI(type, 2, "previous");
+        previous->addIncoming(initial, entryBB);
+        Value *desired = funcPtr(codegen, previous, val);
+        Value *result = builder.CreateAtomicCmpXchg(ptr, previous, desired, ordering, GetCmpXchgFailureOrdering(ordering));
+        Value *seen = builder.CreateExtractValue(result, 0, "seen");
+        Value *success = builder.CreateExtractValue(result, 1, "success");
+        previous->addIncoming(seen, builder.GetInsertBlock());
+        builder.CreateCondBr(success, doneBB, loopBB);
+
+        builder.SetInsertPoint(doneBB);
+        if (updated != nullptr) {
+            *updated = desired;
+        }
+        return previous;
+    }
+    // Returns whether a variable holding a tracked pointer has its own address taken, or whether anything loaded
+    // back out of it escapes.
+    static bool variableEscapes(AllocaInst *variable, std::set<Value*> &visited) {
+        if (!visited.insert(variable).second) {
+            return false;
+        }
+        for (auto use = variable->use_begin(); use != variable->use_end(); ++use) {
+            User *user = use->getUser();
+            if (LoadInst *load = dyn_cast<LoadInst>(user)) {
+                if (PointerEscapes(load, visited)) {
+                    return true;
+                }
+            }
+            else if (StoreInst *store = dyn_cast<StoreInst>(user)) {
+                if (store->getValueOperand() == variable) {
+                    return true;
+                }
+            }
+            else {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns whether a pointer, or one derived from it, can outlive the function: it is passed to a call, returned,
+    // stored anywhere but a variable or turned into an integer. Variables it's stored into are followed.
+    bool PointerEscapes(Value *ptr, std::set<Value*> &visited) {
+        if (!visited.insert(ptr).second) {
+            return false;
+        }
+        for (auto use = ptr->use_begin(); use != ptr->use_end(); ++use) {
+            User *user = use->getUser();
+            if (isa<LoadInst>(user) || isa<ICmpInst>(user)) {
+                continue;
+            }
+            if (StoreInst *store = dyn_cast<StoreInst>(user)) {
+                if (store->getValueOperand() != ptr) { // storing through the pointer.
+                    continue;
+                }
+                AllocaInst *variable = dyn_cast<AllocaInst>(store->getPointerOperand());
+                if (variable == nullptr || variableEscapes(variable, visited)) {
+                    return true;
+                }
+                continue;
+            }
+            if (isa<AtomicRMWInst>(user) || isa<AtomicCmpXchgInst>(user)) {
+                if (use->getOperandNo() != 0) { // only the address operand is harmless.
+                    return true;
+                }
+                continue;
+            }
+            if (isa<GetElementPtrInst>(user) || isa<BitCastInst>(user) || isa<PHINode>(user) || isa<SelectInst>(user)) {
+                if (PointerEscapes(user, visited)) {
+                    return true;
+                }
+                continue;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Returns whether a block can be reached again after leaving it, i.e. it is part of a loop.
+    static bool isInLoop(BasicBlock *block) {
+        std::set<BasicBlock*> seen;
+        std::vector<BasicBlock*> work(succ_begin(block), succ_end(block));
+        while (!work.empty()) {
+            BasicBlock *bb = work.back();
+            work.pop_back();
+            if (bb == block) {
+                return true;
+            }
+            if (seen.insert(bb).second) {
+                work.insert(work.end(), succ_begin(bb), succ_end(bb));
+            }
+        }
+        return false;
+    }
+
+    // Replaces the 'new' allocations of a function which are of a small constant size, outside of any loop and
+    // never escape with stack memory in the entry block.
+    void PromoteNonEscapingAllocations(CodeGenerator *codegen, Function *function) {
+        std::vector<CallInst*> promotable;
+        for (auto bb = function->begin(); bb != function->end(); ++bb) {
+            for (auto inst = bb->begin(); inst != bb->end(); ++inst) {
+                CallInst *call = dyn_cast<CallInst>(inst);
+                Function *callee = call != nullptr ? call->getCalledFunction() : nullptr;
+                if (callee == nullptr || (callee->getName() != "demi_alloc" && callee->getName() != "demi_arena_alloc")) {
+                    continue;
+                }
+                // the size is always the last argument.
+                ConstantInt *size = dyn_cast<ConstantInt>(call->getArgOperand(call->getNumArgOperands() - 1));
+                if (size == nullptr || size->getZExtValue() > STACK_PROMOTION_LIMIT) {
+                    continue;
+                }
+                // a stack slot is reused by every iteration, while each 'new' in a loop must be distinct.
+                if (isInLoop(bb)) {
+                    continue;
+                }
+                std::set<Value*> visited;
+                if (!PointerEscapes(call, visited)) {
+                    promotable.push_back(call);
+                }
+            }
+        }
+        for (auto call = promotable.begin(); call != promotable.end(); ++call) {
+            uint64_t size = cast<ConstantInt>((*call)->getArgOperand((*call)->getNumArgOperands() - 1))->getZExtValue();
+            Type *bytesType = ArrayType::get(Type::getInt8Ty(codegen->getContext()), size == 0 ? 1 : size);
+            AllocaInst *slot = CreateEntryBlockAlloca(codegen, function, "stacknew", bytesType);
+            slot->setAlignment(16); // same as the runtime's allocations.
+            Value *memory = new BitCastInst(slot, (*call)->getType(), "stacknew", *call);
+            (*call)->replaceAllUsesWith(memory);
+            (*call)->eraseFromParent();
+        }
+    }
+
+    // Appends the offsets of every pointer within a value of a type, starting at 'base', to 'offsets'.
+    void GetPointerOffsets(const DataLayout *layout, Type *type, uint64_t base, std::vector<uint64_t> &offsets) {
+        if (type->isPointerTy()) {
+            offsets.push_back(base);
+        }
+        else if (StructType *structTy = dyn_cast<StructType>(type)) {
+            if (structTy->isOpaque()) {
+                return;
+            }
+            const StructLayout *structLayout = layout->getStructLayout(structTy);
+            for (unsigned i = 0, e = structTy->getNumElements(); i < e; ++i) {
+                GetPointerOffsets(layout, structTy->getElementType(i), base + structLayout->getElementOffset(i), offsets);
+            }
+        }
+        else if (ArrayType *arrayTy = dyn_cast<ArrayType>(type)) {
+            std::vector<uint64_t> elementOffsets;
+            GetPointerOffsets(layout, arrayTy->getElementType(), 0, elementOffsets);
+            if (elementOffsets.empty()) {
+                return;
+            }
+            uint64_t elementSize = layout->getTypeAllocSize(arrayTy->getElementType());
+            for (uint64_t i = 0, e = arrayTy->getNumElements(); i < e; ++i) {
+                for (auto offset = elementOffsets.begin(); offset != elementOffsets.end(); ++offset) {
+                    offsets.push_back(base + i * elementSize + *offset);
+                }
+            }
+        }
+    }
+
+    // With '-gc', keeps a pointer which isn't in a variable, e.g. the result of a call, visible to the collector
+    // until the function returns. Returns the pointer.
+    Value *CreateGCTempRoot(CodeGenerator *codegen, Value *val) {
+        if (!codegen->getUseGC() || val == nullptr || !val->getType()->isPointerTy()) {
+            return val;
+        }
+        Function *function = codegen->getBuilder().GetInsertBlock()->getParent();
+        AllocaInst *root = CreateEntryBlockAlloca(codegen, function, "gctmp", val->getType());
+        codegen->getBuilder().CreateStore(val, root);
+        return val;
+    }
+
+    // Moves the variables of a function which hold pointers into a frame the collector can find, the frame is linked
+    // into the thread's chain of roots on entry and unlinked before every return.
+    // The frame is laid out as the runtime's DemiGCFrame, { prev, map }, followed by the variables, and its map
+    // as DemiGCFrameMap, { root count, [root count x { offset, type info }] }.
+    void InsertGCFrame(CodeGenerator *codegen, Function *function) {
+        LLVMContext &context = codegen->getContext();
+        const DataLayout *layout = codegen->getTheModule()->getDataLayout();
+        Type *int8PtrTy = Type::getInt8PtrTy(context);
+        Type *int64Ty = Type::getInt64Ty(context);
+
+        // variables are all allocated at the top of the entry block.
+        BasicBlock &entry = function->getEntryBlock();
+        auto firstInst = entry.begin();
+        std::vector<AllocaInst*> roots;
+        std::vector<Type*> frameFields = { int8PtrTy, int8PtrTy };
+        for (; firstInst != entry.end() && isa<AllocaInst>(firstInst); ++firstInst) {
+            AllocaInst *variable = cast<AllocaInst>(firstInst);
+            if (variable->isArrayAllocation()) {
+                continue;
+            }
+            std::vector<uint64_t> offsets;
+            GetPointerOffsets(layout, variable->getAllocatedType(), 0, offsets);
+            if (!offsets.empty()) {
+                roots.push_back(variable);
+                frameFields.push_back(variable->getAllocatedType());
+            }
+        }
+        if (roots.empty()) {
+            return;
+        }
+
+        StructType *frameTy = StructType::get(context, frameFields);
+        const StructLayout *frameLayout = layout->getStructLayout(frameTy);
+        IRBuilder<> builder(firstInst);
+        AllocaInst *frame = builder.CreateAlloca(frameTy, nullptr, "gcframe");
+        std::vector<Type*> rootInfoFields = { int64Ty, int8PtrTy };
+        StructType *rootInfoTy = StructType::get(context, rootInfoFields);
+        std::vector<Constant*> rootInfos;
+        for (unsigned i = 0, e = roots.size(); i < e; ++i) {
+            Value *slot = builder.CreateStructGEP(frame, i + 2);
+            slot->takeName(roots[i]);
+            roots[i]->replaceAllUsesWith(slot);
+            std::vector<Constant*> rootInfo = {
+                ConstantInt::get(int64Ty, frameLayout->getElementOffset(i + 2)),
+                codegen->getGCTypeInfo(roots[i]->getAllocatedType())
+            };
+            rootInfos.push_back(ConstantStruct::get(rootInfoTy, rootInfo));
+            roots[i]->eraseFromParent();
+        }
+        std::vector<Constant*> mapFields = {
+            ConstantInt::get(int64Ty, roots.size()),
+            ConstantArray::get(ArrayType::get(rootInfoTy, rootInfos.size()), rootInfos)
+        };
+        Constant *map = ConstantStruct::getAnon(context, mapFields);
+        GlobalVariable *mapGlobal = new GlobalVariable(*codegen->getTheModule(), map->getType(), true,
+            GlobalValue::PrivateLinkage, map, "gc.framemap");
+
+        // variables must never hold garbage the collector could mistake for pointers.
+        builder.CreateMemSet(frame, builder.getInt8(0), frameLayout->getSizeInBytes(), layout->getABITypeAlignment(frameTy));
+        builder.CreateStore(ConstantExpr::getBitCast(mapGlobal, int8PtrTy), builder.CreateStructGEP(frame, 1));
+        Value *frameAddr = builder.CreateBitCast(frame, int8PtrTy);
+        std::vector<Type*> frameArgs(1, int8PtrTy);
+        Constant *pushFrame = GetRuntimeFunction(codegen, "demi_gc_push_frame", builder.getVoidTy(), frameArgs);
+        Constant *popFrame = GetRuntimeFunction(codegen, "demi_gc_pop_frame", builder.getVoidTy(), frameArgs);
+        builder.CreateCall(pushFrame, frameAddr);
+
+        for (auto bb = function->begin(); bb != function->end(); ++bb) {
+            if (ReturnInst *ret = dyn_cast<ReturnInst>(bb->getTerminator())) {
+                CallInst::Create(popFrame, frameAddr, "", ret);
+            }
+        }
+    }
+
+    // Returns whether a type is 'string'.
+    bool IsStringType(CodeGenerator *codegen, Type *type) {
+        return type == codegen->getStringType();
+    }
+
+    // Returns whether a type is 'string' or an array or class holding strings.
+    bool ContainsString(CodeGenerator *codegen, Type *type) {
+        if (IsStringType(codegen, type)) {
+            return true;
+        }
+        if (ArrayType *arrayTy = dyn_cast<ArrayType>(type)) {
+            return ContainsString(codegen, arrayTy->getElementType());
+        }
+        if (StructType *structTy = dyn_cast<StructType>(type)) {
+            for (unsigned i = 0, e = structTy->getNumElements(); i < e; ++i) {
+                if (ContainsString(codegen, structTy->getElementType(i))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Returns an address holding a string value for the runtime's string functions, the address it was loaded
+    // from if it was loaded, otherwise a temporary copy which doesn't own a reference. A loaded string must not have
+    // been written since, a value used after other code runs is captured with CreateStringCapture first.
+    Value *GetStringAddress(CodeGenerator *codegen, Value *str) {
+        if (LoadInst *load = dyn_cast<LoadInst>(str)) {
+            return load->getPointerOperand();
+        }
+        Function *function = codegen->getBuilder().GetInsertBlock()->getParent();
+        AllocaInst *copy = CreateEntryBlockAlloca(codegen, function, "str", str->getType());
+        codegen->getBuilder().CreateStore(str, copy);
+        return copy;
+    }
+
+    // Returns a temporary for a string made by the runtime, or a value holding strings, which owns references to
+    // them. What the temporary held the last time the code ran is released first.
+    AllocaInst *CreateStringTemp(CodeGenerator *codegen, Type *type) {
+        Function *function = codegen->getBuilder().GetInsertBlock()->getParent();
+        AllocaInst *temp = CreateEntryBlockAlloca(codegen, function, "strtmp", type);
+        codegen->setOwnsString(temp);
+        CreateStringRelease(codegen, temp);
+        return temp;
+    }
+    AllocaInst *CreateStringTemp(CodeGenerator *codegen) {
+        return CreateStringTemp(codegen, codegen->getStringType());
+    }
+
+    // Takes ownership of the strings in a value the caller owns references to, e.g. the result of a call, and
+    // returns it.
+    Value *CreateOwnedString(CodeGenerator *codegen, Value *str) {
+        codegen->getBuilder().CreateStore(str, CreateStringTemp(codegen, str->getType()));
+        return str;
+    }
+
+    // Copies a string into a temporary with a reference of its own, so that code run before it's used can't change
+    // or free it, and returns it.
+    Value *CreateStringCapture(CodeGenerator *codegen, Value *str) {
+        AllocaInst *temp = CreateStringTemp(codegen);
+        codegen->getBuilder().CreateStore(str, temp);
+        CreateStringRetain(codegen, temp);
+        return codegen->getBuilder().CreateLoad(temp, "captured");
+    }
+
+    // Calls a runtime function taking a string for every string held at an address, a string itself or the
+    // strings in the class instance or array there.
+    static void forEachContainedString(CodeGenerator *codegen, Constant *func, Value *address, Type *type) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        if (IsStringType(codegen, type)) {
+            builder.CreateCall(func, address);
+        }
+        else if (ArrayType *arrayTy = dyn_cast<ArrayType>(type)) {
+            for (uint64_t i = 0, e = arrayTy->getNumElements(); i < e; ++i) {
+                Value *indices[] = { builder.getInt64(0), builder.getInt64(i) };
+                forEachContainedString(codegen, func, builder.CreateInBoundsGEP(address, indices), arrayTy->getElementType());
+            }
+        }
+        else if (StructType *structTy = dyn_cast<StructType>(type)) {
+            for (unsigned i = 0, e = structTy->getNumElements(); i < e; ++i) {
+                if (ContainsString(codegen, structTy->getElementType(i))) {
+                    forEachContainedString(codegen, func, builder.CreateStructGEP(address, i), structTy->getElementType(i));
+                }
+            }
+        }
+    }
+
+    // Adds a reference to the string at an address, or to every string of the instance or array there.
+    void CreateStringRetain(CodeGenerator *codegen, Value *address) {
+        std::vector<Type*> args(1, PointerType::getUnqual(codegen->getStringType()));
+        Constant *retain = GetRuntimeFunction(codegen, "demi_string_retain", codegen->getBuilder().getVoidTy(), args);
+        forEachContainedString(codegen, retain, address, address->getType()->getPointerElementType());
+    }
+
+    // Drops the reference of the string at an address, or of every string of the instance or array there, and
+    // empties them.
+    void CreateStringRelease(CodeGenerator *codegen, Value *address) {
+        std::vector<Type*> args(1, PointerType::getUnqual(codegen->getStringType()));
+        Constant *release = GetRuntimeFunction(codegen, "demi_string_release", codegen->getBuilder().getVoidTy(), args);
+        forEachContainedString(codegen, release, address, address->getType()->getPointerElementType());
+    }
+
+    // Stores a value into a variable, field or element. A string is shared by adding a reference to it and
+    // releasing the string it replaces, an instance or array does the same for every string it holds, anything
+    // else is a plain store.
+    void CreateAssignmentStore(CodeGenerator *codegen, Value *val, Value *address) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        if (!IsStringType(codegen, val->getType())) {
+            if (ContainsString(codegen, val->getType())) { // retained before the old ones go, 'a = a' keeps them.
+                Function *function = builder.GetInsertBlock()->getParent();
+                AllocaInst *copy = CreateEntryBlockAlloca(codegen, function, "copy", val->getType());
+                builder.CreateStore(val, copy);
+                CreateStringRetain(codegen, copy);
+                CreateStringRelease(codegen, address);
+            }
+            builder.CreateStore(val, address);
+            return;
+        }
+        std::vector<Type*> args(2, address->getType());
+        Constant *assign = GetRuntimeFunction(codegen, "demi_string_assign", codegen->getBuilder().getVoidTy(), args);
+        codegen->getBuilder().CreateCall2(assign, address, GetStringAddress(codegen, val));
+    }
+
+    // Returns the concatenation of two strings.
+    Value *CreateStringConcat(CodeGenerator *codegen, Value *lhs, Value *rhs) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        Value *lhsAddress = GetStringAddress(codegen, lhs);
+        Value *rhsAddress = GetStringAddress(codegen, rhs);
+        AllocaInst *result = CreateStringTemp(codegen);
+        std::vector<Type*> args(3, result->getType());
+        Constant *concat = GetRuntimeFunction(codegen, "demi_string_concat", builder.getVoidTy(), args);
+        builder.CreateCall3(concat, result, lhsAddress, rhsAddress);
+        return builder.CreateLoad(result, "concat");
+    }
+
+    // Appends a string to the string at an address, in place when possible, and returns the result.
+    Value *CreateStringAppend(CodeGenerator *codegen, Value *address, Value *str) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        std::vector<Type*> args(2, address->getType());
+        Constant *append = GetRuntimeFunction(codegen, "demi_string_append", builder.getVoidTy(), args);
+        builder.CreateCall2(append, address, GetStringAddress(codegen, str));
+        return builder.CreateLoad(address);
+    }
+
+    // Returns the length of the string at an address.
+    Value *CreateStringLength(CodeGenerator *codegen, Value *address) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        std::vector<Type*> args(1, address->getType());
+        Constant *length = GetRuntimeFunction(codegen, "demi_string_length", builder.getInt64Ty(), args);
+        return builder.CreateCall(length, address, "length");
+    }
+
+    // Returns the NUL terminated chars of a string for C functions, valid until the code runs again or returns.
+    // Views get copied into a temporary.
+    Value *CreateStringCStr(CodeGenerator *codegen, Value *str) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        Value *address = GetStringAddress(codegen, str);
+        AllocaInst *copy = CreateStringTemp(codegen);
+        std::vector<Type*> args(2, address->getType());
+        Constant *cstr = GetRuntimeFunction(codegen, "demi_string_cstr", builder.getInt8PtrTy(), args);
+        return builder.CreateCall2(cstr, address, copy, "cstr");
+    }
+
+    // Returns a string copied from a C string.
+    Value *CreateStringFromCStr(CodeGenerator *codegen, Value *cstr) {
+        IRBuilder<> &builder = codegen->getBuilder();
+        AllocaInst *result = CreateStringTemp(codegen);
+        std::vector<Type*> args = { result->getType(), builder.getInt8PtrTy() };
+        Constant *fromCStr = GetRuntimeFunction(codegen, "demi_string_from_cstr", builder.getVoidTy(), args);
+        builder.CreateCall2(fromCStr, result, cstr);
+        return builder.CreateLoad(result, "str");
+    }
+
+    // Empties the variables and temporaries of the current function owning strings on entry, and releases
+    // them before every return.
+    void ReleaseOwnedStrings(CodeGenerator *codegen, Function *function) {
+        const std::vector<AllocaInst*> &owned = codegen->getOwnedStrings();
+        if (owned.empty()) {
+            return;
+        }
+        // variables are all allocated at the top of the entry block.
+        BasicBlock &entry = function->getEntryBlock();
+        auto firstInst = entry.begin();
+        while (isa<AllocaInst>(firstInst)) {
+            ++firstInst;
+        }
+        for (auto str = owned.begin(); str != owned.end(); ++str) {
+            new StoreInst(Constant::getNullValue((*str)->getAllocatedType()), *str, firstInst);
+        }
+        IRBuilder<> &builder = codegen->getBuilder();
+        IRBuilderBase::InsertPointGuard guard(builder);
+        for (auto bb = function->begin(); bb != function->end(); ++bb) {
+            if (ReturnInst *ret = dyn_cast<ReturnInst>(bb->getTerminator())) {
+                builder.SetInsertPoint(ret);
+                for (auto str = owned.begin(); str != owned.end(); ++str) {
+                    CreateStringRelease(codegen, *str);
+                }
+            }
+        }
+    }
+
+    void PromoteVariablesToRegisters(CodeGenerator *codegen, Function *function) {
+        // variables are all allocated at the top of the entry block.
+        BasicBlock &entry = function->getEntryBlock();
+        std::vector<AllocaInst*> promotable;
+        for (auto inst = entry.begin(); inst != entry.end() && isa<AllocaInst>(inst); ++inst) {
+            AllocaInst *variable = cast<AllocaInst>(inst);
+            // atomic variables keep their memory operations, they may be shared with spawned tasks.
+            if (!codegen->getIsAtomic(variable) && isAllocaPromotable(variable)) {
+                promotable.push_back(variable);
+            }
+        }
+        if (promotable.empty()) {
+            return;
+        }
+        DominatorTree dominators;
+        dominators.recalculate(*function);
+        PromoteMemToReg(promotable, dominators);
+    }
 }
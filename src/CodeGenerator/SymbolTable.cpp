@@ -0,0 +1,36 @@
+#include "CodeGenerator/SymbolTable.h"
+
+llvm::AllocaInst *SymbolTable::Lookup(NameTable::NameId id) const {
+    return id < _variables.size() ? _variables[id] : nullptr;
+}
+
+void SymbolTable::Declare(NameTable::NameId id, llvm::AllocaInst *variable) {
+    if (id >= _variables.size()) {
+        _variables.resize(NameTable::GetCount() > id ? NameTable::GetCount() : id + 1, nullptr);
+    }
+    _declarations.push_back(std::make_pair(id, _variables[id]));
+    _variables[id] = variable;
+}
+
+llvm::AllocaInst *SymbolTable::Replace(NameTable::NameId id, llvm::AllocaInst *variable) {
+    llvm::AllocaInst *previous = Lookup(id);
+    if (previous != nullptr) {
+        _variables[id] = variable;
+    }
+    return previous;
+}
+
+void SymbolTable::Pop(unsigned count) {
+    while (count-- != 0 && !_declarations.empty()) {
+        _variables[_declarations.back().first] = _declarations.back().second;
+        _declarations.pop_back();
+    }
+}
+
+void SymbolTable::Clear() {
+    Pop(_declarations.size());
+}
+
+unsigned SymbolTable::GetDepth() const {
+    return _declarations.size();
+}
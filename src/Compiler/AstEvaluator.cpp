@@ -0,0 +1,567 @@
+#include "Compiler/AstEvaluator.h"
+
+#include <math.h>
+
+#include "AstNodes/AstBinaryOperatorExpr.h"
+#include "AstNodes/AstBooleanNode.h"
+#include "AstNodes/AstCallExpr.h"
+#include "AstNodes/AstDoubleNode.h"
+#include "AstNodes/AstForExpr.h"
+#include "AstNodes/AstIfElseExpr.h"
+#include "AstNodes/AstIntegerNode.h"
+#include "AstNodes/AstReturnExpr.h"
+#include "AstNodes/AstUnaryOperatorExpr.h"
+#include "AstNodes/AstVarExpr.h"
+#include "AstNodes/AstVariableNode.h"
+#include "AstNodes/AstWhileExpr.h"
+#include "AstNodes/FunctionAst.h"
+#include "AstNodes/AstVisitor.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+
+namespace {
+
+    // Evaluation gives up past these, leaving the call to run time.
+    const unsigned MaxSteps = 1000000;
+    const unsigned MaxDepth = 256;
+
+    uint64_t mask(unsigned bitWidth) {
+        return bitWidth >= 64 ? ~0ull : (1ull << bitWidth) - 1;
+    }
+
+    // Returns the zero of a type, false for types that can't be evaluated.
+    bool zeroOf(AstTypeNode *type, ConstantValue &value) {
+        if (type == nullptr || type->getIsArray() || type->getIsAtomic()) {
+            return false;
+        }
+        switch (type->getTypeType()) {
+        default: return false;
+        case node_boolean: value = ConstantValue::Integer(0, 1); return true;
+        case node_double: value = ConstantValue::Double(0.0); return true;
+        case node_signed_integer8:
+        case node_unsigned_integer8: value = ConstantValue::Integer(0, 8); return true;
+        case node_signed_integer16:
+        case node_unsigned_integer16: value = ConstantValue::Integer(0, 16); return true;
+        case node_signed_integer32:
+        case node_unsigned_integer32: value = ConstantValue::Integer(0, 32); return true;
+        case node_signed_integer64:
+        case node_unsigned_integer64: value = ConstantValue::Integer(0, 64); return true;
+        }
+    }
+
+    // Casts a value to the type of 'type' the way an implicit cast is generated: integers are sign extended
+    // or truncated and converted to and from doubles as signed. Returns false for a double out of range.
+    bool castTo(const ConstantValue &value, const ConstantValue &type, ConstantValue &result) {
+        if (type.IsDouble) {
+            result = value.IsDouble ? value : ConstantValue::Double(double(value.getSigned()));
+            return true;
+        }
+        if (!value.IsDouble) {
+            result = ConstantValue::Integer(uint64_t(value.getSigned()), type.BitWidth);
+            return true;
+        }
+        double truncated = trunc(value.Number);
+        double limit = ldexp(1.0, int(type.BitWidth) - 1);
+        if (!(truncated >= -limit && truncated < limit)) { // also NaN.
+            return false;
+        }
+        result = ConstantValue::Integer(uint64_t(int64_t(truncated)), type.BitWidth);
+        return true;
+    }
+
+    bool evaluateIntegers(TokenType oper, uint64_t l, uint64_t r, int64_t sl, int64_t sr, unsigned bitWidth,
+        bool isUnsigned, ConstantValue &result) {
+        int64_t minimum = bitWidth >= 64 ? INT64_MIN : -(int64_t(1) << (bitWidth - 1));
+        switch (oper) {
+        default: return false;
+        case '+': result = ConstantValue::Integer(l + r, bitWidth); return true;
+        case '-': result = ConstantValue::Integer(l - r, bitWidth); return true;
+        case '*': result = ConstantValue::Integer(l * r, bitWidth); return true;
+        case '&': result = ConstantValue::Integer(l & r, bitWidth); return true;
+        case '|': result = ConstantValue::Integer(l | r, bitWidth); return true;
+        case '^': result = ConstantValue::Integer(l ^ r, bitWidth); return true;
+        case tok_leftshift:
+            if (r >= bitWidth) {
+                return false;
+            }
+            result = ConstantValue::Integer(l << r, bitWidth);
+            return true;
+        case tok_rightshift: // always a logical shift.
+            if (r >= bitWidth) {
+                return false;
+            }
+            result = ConstantValue::Integer(l >> r, bitWidth);
+            return true;
+        case '/':
+        case '%':
+            if (r == 0 || (!isUnsigned && sl == minimum && sr == -1)) { // left for the program to trap on.
+                return false;
+            }
+            if (isUnsigned) {
+                result = ConstantValue::Integer(oper == '/' ? l / r : l % r, bitWidth);
+            }
+            else {
+                result = ConstantValue::Integer(uint64_t(oper == '/' ? sl / sr : sl % sr), bitWidth);
+            }
+            return true;
+        case tok_equalequal: result = ConstantValue::Integer(l == r, 1); return true;
+        case tok_notequal: result = ConstantValue::Integer(l != r, 1); return true;
+        case '<': result = ConstantValue::Integer(isUnsigned ? l < r : sl < sr, 1); return true;
+        case '>': result = ConstantValue::Integer(isUnsigned ? l > r : sl > sr, 1); return true;
+        case tok_lessequal: result = ConstantValue::Integer(isUnsigned ? l <= r : sl <= sr, 1); return true;
+        case tok_greatequal: result = ConstantValue::Integer(isUnsigned ? l >= r : sl >= sr, 1); return true;
+        }
+    }
+
+    // Comparisons are unordered except for '==' and '!=', like the generated ones.
+    bool evaluateDoubles(TokenType oper, double l, double r, ConstantValue &result) {
+        switch (oper) {
+        default: return false;
+        case '+': result = ConstantValue::Double(l + r); return true;
+        case '-': result = ConstantValue::Double(l - r); return true;
+        case '*': result = ConstantValue::Double(l * r); return true;
+        case '/': result = ConstantValue::Double(l / r); return true;
+        case '%': result = ConstantValue::Double(fmod(l, r)); return true;
+        case '<': result = ConstantValue::Integer(!(l >= r), 1); return true;
+        case '>': result = ConstantValue::Integer(!(l <= r), 1); return true;
+        case tok_lessequal: result = ConstantValue::Integer(!(l > r), 1); return true;
+        case tok_greatequal: result = ConstantValue::Integer(!(l < r), 1); return true;
+        case tok_equalequal: result = ConstantValue::Integer(l == r, 1); return true;
+        case tok_notequal: result = ConstantValue::Integer(l < r || l > r, 1); return true;
+        }
+    }
+
+    // Returns the operation an assignment operator applies, or 0 for other operators.
+    TokenType assignmentOperation(TokenType oper) {
+        switch (oper) {
+        default: return (TokenType)0;
+        case tok_plusequals: return (TokenType)'+';
+        case tok_minusequals: return (TokenType)'-';
+        case tok_multequals: return (TokenType)'*';
+        case tok_divequals: return (TokenType)'/';
+        case tok_modequals: return (TokenType)'%';
+        case tok_andequals: return (TokenType)'&';
+        case tok_orequals: return (TokenType)'|';
+        case tok_xorequals: return (TokenType)'^';
+        case tok_leftshiftequal: return tok_leftshift;
+        case tok_rightshiftequal: return tok_rightshift;
+        }
+    }
+
+}
+
+ConstantValue ConstantValue::Integer(uint64_t bits, unsigned bitWidth) {
+    ConstantValue value;
+    value.IsDouble = false;
+    value.BitWidth = bitWidth;
+    value.Bits = bits & mask(bitWidth);
+    value.Number = 0.0;
+    return value;
+}
+
+ConstantValue ConstantValue::Double(double number) {
+    ConstantValue value;
+    value.IsDouble = true;
+    value.BitWidth = 64;
+    value.Bits = 0;
+    value.Number = number;
+    return value;
+}
+
+int64_t ConstantValue::getSigned() const {
+    if (BitWidth >= 64) {
+        return int64_t(Bits);
+    }
+    uint64_t sign = 1ull << (BitWidth - 1);
+    return int64_t((Bits ^ sign) - sign);
+}
+
+bool ConstantValue::isBoolean() const {
+    return !IsDouble && BitWidth == 1;
+}
+
+AstEvaluator::AstEvaluator()
+    : _steps(0), _depth(0), _isReturning(false) {
+}
+
+void AstEvaluator::AddFunction(FunctionAst *func) {
+    _functions[func->getPrototype()->getName()] = func;
+}
+
+bool AstEvaluator::CheckFunctions() {
+    bool success = true;
+    for (auto iter = _functions.begin(); iter != _functions.end(); ++iter) {
+        FunctionAst *func = iter->second;
+        PrototypeAst *proto = func->getPrototype();
+        bool valid = checkType(func, proto->getReturnType(), proto->getPos());
+        for (unsigned i = 0, size = proto->getArgs().size(); valid && i < size; ++i) {
+            valid = checkType(func, proto->getArgs()[i].second, proto->getPos());
+        }
+        success = valid && checkBlock(func, func->getBody()) && success;
+    }
+    return success;
+}
+
+bool AstEvaluator::IsConstFunction(const std::string &name) const {
+    return _functions.find(name) != _functions.end();
+}
+
+IAstExpression *AstEvaluator::EvaluateCall(AstCallExpression *call) {
+    auto found = _functions.find(call->getName());
+    if (found == _functions.end()) {
+        return nullptr;
+    }
+    std::vector<ConstantValue> args(call->getArgCount());
+    for (unsigned i = 0, size = args.size(); i < size; ++i) {
+        if (!GetLiteral(call->getArgs()[i], args[i])) {
+            return nullptr;
+        }
+    }
+    _steps = 0;
+    ConstantValue result;
+    if (!this->call(found->second, args, result)) {
+        Helpers::Warning(call->getPos(), "Call to 'const' function '%s' could not be evaluated at compile time, it's made at run time.",
+            call->getName().c_str());
+        return nullptr;
+    }
+    return MakeLiteral(result, call->getPos());
+}
+
+bool AstEvaluator::GetLiteral(IAstExpression *expr, ConstantValue &value) {
+    if (AstIntegerNode *integer = AstCast<AstIntegerNode>(expr)) {
+        value = ConstantValue::Integer(integer->getValue(), integer->getBitWidth());
+        return true;
+    }
+    if (AstDoubleNode *number = AstCast<AstDoubleNode>(expr)) {
+        value = ConstantValue::Double(number->getValue());
+        return true;
+    }
+    if (AstBooleanNode *boolean = AstCast<AstBooleanNode>(expr)) {
+        value = ConstantValue::Integer(boolean->getValue(), 1);
+        return true;
+    }
+    return false;
+}
+
+IAstExpression *AstEvaluator::MakeLiteral(const ConstantValue &value, PossiblePosition pos) {
+    if (value.IsDouble) {
+        return new AstDoubleNode(value.Number, pos.LineNumber, pos.ColumnNumber);
+    }
+    if (value.isBoolean()) {
+        return new AstBooleanNode(value.Bits != 0, pos.LineNumber, pos.ColumnNumber);
+    }
+    AstIntegerNode *node = new AstIntegerNode(value.Bits, pos.LineNumber, pos.ColumnNumber);
+    node->setBitWidth(value.BitWidth);
+    switch (value.BitWidth) {
+    case 8: node->setNodeType(node_signed_integer8); break;
+    case 16: node->setNodeType(node_signed_integer16); break;
+    case 32: node->setNodeType(node_signed_integer32); break;
+    case 64: node->setNodeType(node_signed_integer64); break;
+    }
+    return node;
+}
+
+bool AstEvaluator::EvaluateBinary(TokenType oper, const ConstantValue &lhs, const ConstantValue &rhs, bool isUnsigned,
+    ConstantValue &result) {
+    if (!lhs.IsDouble && !rhs.IsDouble) {
+        if (lhs.BitWidth != rhs.BitWidth) { // the generated operation would be on mismatched types.
+            return false;
+        }
+        return evaluateIntegers(oper, lhs.Bits, rhs.Bits, lhs.getSigned(), rhs.getSigned(), lhs.BitWidth, isUnsigned, result);
+    }
+    if (lhs.isBoolean() || rhs.isBoolean()) {
+        return false;
+    }
+    // an integer next to a double is converted as signed.
+    double l = lhs.IsDouble ? lhs.Number : double(lhs.getSigned());
+    double r = rhs.IsDouble ? rhs.Number : double(rhs.getSigned());
+    return evaluateDoubles(oper, l, r, result);
+}
+
+bool AstEvaluator::EvaluateUnary(TokenType oper, const ConstantValue &operand, ConstantValue &result) {
+    if (operand.IsDouble) {
+        switch (oper) {
+        default: return false;
+        case '+': result = operand; return true;
+        case '-': result = ConstantValue::Double(-operand.Number); return true;
+        }
+    }
+    switch (oper) {
+    default: return false;
+    case '+': result = operand; return true;
+    case '-': result = ConstantValue::Integer(0 - operand.Bits, operand.BitWidth); return true;
+    case '~': result = ConstantValue::Integer(~operand.Bits, operand.BitWidth); return true;
+    case '!':
+        if (!operand.isBoolean()) {
+            return false;
+        }
+        result = ConstantValue::Integer(!operand.Bits, 1);
+        return true;
+    }
+}
+
+bool AstEvaluator::checkBlock(FunctionAst *func, const std::vector<IAstExpression*> &block) {
+    bool success = true;
+    for (unsigned i = 0, size = block.size(); i < size; ++i) {
+        success = checkExpression(func, block[i]) && success;
+    }
+    return success;
+}
+
+bool AstEvaluator::checkExpression(FunctionAst *func, IAstExpression *expr) {
+    const char *name = func->getPrototype()->getName().c_str();
+    ConstantValue value;
+    if (expr == nullptr || GetLiteral(expr, value) || AstCast<AstVariableNode>(expr) != nullptr) {
+        return true;
+    }
+    if (AstVarExpr *var = AstCast<AstVarExpr>(expr)) {
+        if (var->getAssignmentExpression() != nullptr) {
+            return checkExpression(func, var->getAssignmentExpression());
+        }
+        return checkType(func, var->getInferredType(), var->getPos());
+    }
+    if (AstBinaryOperatorExpr *binop = AstCast<AstBinaryOperatorExpr>(expr)) {
+        if (binop->getOperator() == '.') {
+            Helpers::Error(binop->getPos(), "'const' function '%s' can't access members.", name);
+            return false;
+        }
+        bool success = checkExpression(func, binop->getLHS());
+        return checkExpression(func, binop->getRHS()) && success;
+    }
+    if (AstUnaryOperatorExpr *unop = AstCast<AstUnaryOperatorExpr>(expr)) {
+        if (unop->getOperator() == tok_new || unop->getOperator() == '[') {
+            Helpers::Error(unop->getPos(), "'const' function '%s' can't use arrays.", name);
+            return false;
+        }
+        return checkExpression(func, unop->getOperand());
+    }
+    if (AstCallExpression *call = AstCast<AstCallExpression>(expr)) {
+        if (!IsConstFunction(call->getName())) {
+            Helpers::Error(call->getPos(), "'const' function '%s' can only call 'const' functions, '%s' isn't one.",
+                name, call->getName().c_str());
+            return false;
+        }
+        return checkBlock(func, call->getArgs());
+    }
+    if (AstIfElseExpr *ifelse = AstCast<AstIfElseExpr>(expr)) {
+        bool success = checkExpression(func, ifelse->getCondition());
+        success = checkBlock(func, ifelse->getIfBody()) && success;
+        return checkBlock(func, ifelse->getElseBody()) && success;
+    }
+    if (AstWhileExpr *loop = AstCast<AstWhileExpr>(expr)) {
+        bool success = checkExpression(func, loop->getCondition());
+        return checkBlock(func, loop->getBody()) && success;
+    }
+    if (AstForExpr *loop = AstCast<AstForExpr>(expr)) {
+        if (!loop->getReductions().empty()) {
+            Helpers::Error(loop->getPos(), "'const' function '%s' can't use parallel reductions.", name);
+            return false;
+        }
+        bool success = checkBlock(func, loop->getInit());
+        success = checkExpression(func, loop->getCondition()) && success;
+        success = checkBlock(func, loop->getAfterthought()) && success;
+        return checkBlock(func, loop->getBody()) && success;
+    }
+    if (AstReturnExpr *ret = AstCast<AstReturnExpr>(expr)) {
+        return checkExpression(func, ret->getExpr());
+    }
+    Helpers::Error(expr->getPos(), "'const' function '%s' can only use numbers, booleans, control flow and calls to 'const' functions.", name);
+    return false;
+}
+
+bool AstEvaluator::checkType(FunctionAst *func, AstTypeNode *type, PossiblePosition pos) {
+    ConstantValue value;
+    if (!zeroOf(type, value)) {
+        Helpers::Error(type != nullptr ? type->getPos() : pos, "'const' function '%s' can only use numbers and booleans.",
+            func->getPrototype()->getName().c_str());
+        return false;
+    }
+    return true;
+}
+
+bool AstEvaluator::call(FunctionAst *func, const std::vector<ConstantValue> &args, ConstantValue &result) {
+    PrototypeAst *proto = func->getPrototype();
+    const std::vector<std::pair<std::string, AstTypeNode*>> &params = proto->getArgs();
+    if (args.size() != params.size() || _depth >= MaxDepth) {
+        return false;
+    }
+    // the callee only sees its own variables.
+    std::vector<std::map<std::string, ConstantValue>> callerScopes;
+    callerScopes.swap(_scopes);
+    _scopes.push_back(std::map<std::string, ConstantValue>());
+    ++_depth;
+
+    bool success = true;
+    for (unsigned i = 0, size = params.size(); success && i < size; ++i) {
+        ConstantValue type;
+        success = zeroOf(params[i].second, type) && castTo(args[i], type, _scopes.back()[params[i].first]);
+    }
+    success = success && execute(func->getBody()) && _isReturning; // falling off the end returns nothing to evaluate.
+    ConstantValue returnType;
+    success = success && zeroOf(proto->getReturnType(), returnType) && castTo(_returnValue, returnType, result);
+
+    _isReturning = false;
+    --_depth;
+    _scopes.swap(callerScopes);
+    return success;
+}
+
+bool AstEvaluator::executeBlock(const std::vector<IAstExpression*> &block) {
+    _scopes.push_back(std::map<std::string, ConstantValue>());
+    bool success = execute(block);
+    _scopes.pop_back();
+    return success;
+}
+
+bool AstEvaluator::execute(const std::vector<IAstExpression*> &block) {
+    ConstantValue ignored;
+    for (unsigned i = 0, size = block.size(); i < size && !_isReturning; ++i) {
+        if (!evaluate(block[i], ignored)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AstEvaluator::evaluate(IAstExpression *expr, ConstantValue &result) {
+    if (expr == nullptr || ++_steps > MaxSteps) {
+        return false;
+    }
+    if (GetLiteral(expr, result)) {
+        return true;
+    }
+    if (AstVariableNode *variable = AstCast<AstVariableNode>(expr)) {
+        ConstantValue *value = lookup(variable->getName());
+        if (value == nullptr) {
+            return false;
+        }
+        result = *value;
+        return true;
+    }
+    if (AstVarExpr *var = AstCast<AstVarExpr>(expr)) {
+        IAstExpression *init = var->getAssignmentExpression();
+        if (init != nullptr ? !evaluate(init, result) : !zeroOf(var->getInferredType(), result)) {
+            return false;
+        }
+        _scopes.back()[var->getName()] = result;
+        return true;
+    }
+    if (AstBinaryOperatorExpr *binop = AstCast<AstBinaryOperatorExpr>(expr)) {
+        TokenType oper = binop->getOperator();
+        ConstantValue l, r;
+        if (oper == '=') {
+            return evaluate(binop->getRHS(), r) && assign(binop->getLHS(), r, result);
+        }
+        if (TokenType operation = assignmentOperation(oper)) { // 'x op= y' is 'x = x op y', read as signed.
+            ConstantValue value;
+            return evaluate(binop->getLHS(), l) && evaluate(binop->getRHS(), r)
+                && EvaluateBinary(operation, l, r, false, value) && assign(binop->getLHS(), value, result);
+        }
+        bool isUnsigned = Helpers::IsUnsigned(binop->getLHS()->getNodeType()) && Helpers::IsUnsigned(binop->getRHS()->getNodeType());
+        return evaluate(binop->getLHS(), l) && evaluate(binop->getRHS(), r) && EvaluateBinary(oper, l, r, isUnsigned, result);
+    }
+    if (AstUnaryOperatorExpr *unop = AstCast<AstUnaryOperatorExpr>(expr)) {
+        ConstantValue operand;
+        if (!evaluate(unop->getOperand(), operand)) {
+            return false;
+        }
+        if (unop->getOperator() == tok_plusplus || unop->getOperator() == tok_minusminus) { // 'x = x + 1', the old value if postfix.
+            ConstantValue value;
+            TokenType operation = unop->getOperator() == tok_plusplus ? (TokenType)'+' : (TokenType)'-';
+            if (!EvaluateBinary(operation, operand, ConstantValue::Integer(1, 32), false, value)
+                || !assign(unop->getOperand(), value, result)) {
+                return false;
+            }
+            if (unop->getIsPostfix()) {
+                result = operand;
+            }
+            return true;
+        }
+        return EvaluateUnary(unop->getOperator(), operand, result);
+    }
+    if (AstCallExpression *call = AstCast<AstCallExpression>(expr)) {
+        auto found = _functions.find(call->getName());
+        if (found == _functions.end()) {
+            return false;
+        }
+        std::vector<ConstantValue> args(call->getArgCount());
+        for (unsigned i = 0, size = args.size(); i < size; ++i) {
+            if (!evaluate(call->getArgs()[i], args[i])) {
+                return false;
+            }
+        }
+        return this->call(found->second, args, result);
+    }
+    if (AstIfElseExpr *ifelse = AstCast<AstIfElseExpr>(expr)) {
+        bool condition;
+        if (!evaluateCondition(ifelse->getCondition(), condition)) {
+            return false;
+        }
+        return executeBlock(condition ? ifelse->getIfBody() : ifelse->getElseBody());
+    }
+    if (AstWhileExpr *loop = AstCast<AstWhileExpr>(expr)) {
+        bool condition;
+        while (!_isReturning) {
+            if (!evaluateCondition(loop->getCondition(), condition)) {
+                return false;
+            }
+            if (!condition) {
+                break;
+            }
+            if (!executeBlock(loop->getBody())) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (AstForExpr *loop = AstCast<AstForExpr>(expr)) {
+        _scopes.push_back(std::map<std::string, ConstantValue>());
+        bool success = execute(loop->getInit());
+        bool condition;
+        while (success && !_isReturning) {
+            success = evaluateCondition(loop->getCondition(), condition);
+            if (!success || !condition) {
+                break;
+            }
+            success = executeBlock(loop->getBody()) && (_isReturning || executeBlock(loop->getAfterthought()));
+        }
+        _scopes.pop_back();
+        return success;
+    }
+    if (AstReturnExpr *ret = AstCast<AstReturnExpr>(expr)) {
+        if (!evaluate(ret->getExpr(), _returnValue)) {
+            return false;
+        }
+        _isReturning = true;
+        return true;
+    }
+    return false;
+}
+
+bool AstEvaluator::evaluateCondition(IAstExpression *expr, bool &result) {
+    ConstantValue value;
+    if (!evaluate(expr, value) || !value.isBoolean()) {
+        return false;
+    }
+    result = value.Bits != 0;
+    return true;
+}
+
+bool AstEvaluator::assign(IAstExpression *lvalue, const ConstantValue &value, ConstantValue &result) {
+    AstVariableNode *variable = AstCast<AstVariableNode>(lvalue);
+    ConstantValue *stored = variable != nullptr ? lookup(variable->getName()) : nullptr;
+    if (stored == nullptr || !castTo(value, *stored, result)) { // to the variable's type.
+        return false;
+    }
+    *stored = result;
+    return true;
+}
+
+ConstantValue *AstEvaluator::lookup(const std::string &name) {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(name);
+        if (found != scope->end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
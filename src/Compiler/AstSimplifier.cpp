@@ -0,0 +1,153 @@
+#include "Compiler/AstSimplifier.h"
+#include "Compiler/FlatAst.h"
+#include "Compiler/TreeContainer.h"
+
+#include "AstNodes/AstCallExpr.h"
+#include "AstNodes/AstVariableNode.h"
+#include "AstNodes/ClassAst.h"
+#include "AstNodes/FunctionAst.h"
+#include "AstNodes/AstVisitor.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+
+AstSimplifier::AstSimplifier() {
+}
+
+bool AstSimplifier::Simplify(TreeContainer *trees) {
+    _evaluator = AstEvaluator(); // 'const' functions are evaluated within their own file.
+    std::map<std::string, unsigned> definitionCounts;
+    for (unsigned i = 0, size = trees->FunctionDefinitions.size(); i < size; ++i) {
+        ++definitionCounts[trees->FunctionDefinitions[i]->getPrototype()->getName()];
+    }
+    for (unsigned i = 0, size = trees->FunctionDefinitions.size(); i < size; ++i) {
+        FunctionAst *func = trees->FunctionDefinitions[i];
+        // calls of overloaded functions are only resolved by the code generator, so they're made at run time.
+        if (func->getIsConst() && definitionCounts[func->getPrototype()->getName()] == 1) {
+            _evaluator.AddFunction(func);
+        }
+    }
+    if (!_evaluator.CheckFunctions()) {
+        return false;
+    }
+    for (unsigned i = 0, size = trees->ClassDefinitions.size(); i < size; ++i) {
+        trees->ClassDefinitions[i]->Simplify(this);
+    }
+    for (unsigned i = 0, size = trees->FunctionDefinitions.size(); i < size; ++i) {
+        trees->FunctionDefinitions[i]->Simplify(this);
+    }
+    for (unsigned i = 0, size = trees->TopLevelExpressions.size(); i < size; ++i) {
+        trees->TopLevelExpressions[i] = Simplify(trees->TopLevelExpressions[i]);
+    }
+    return true;
+}
+
+void AstSimplifier::SimplifyFunction(const std::vector<std::string> &params, std::vector<IAstExpression*> &body) {
+    findAssigned(params, body);
+    PushScope();
+    for (unsigned i = 0, size = params.size(); i < size; ++i) {
+        DeclareVariable(NameTable::Intern(params[i]), nullptr);
+    }
+    for (unsigned i = 0, size = body.size(); i < size; ++i) {
+        body[i] = Simplify(body[i]);
+    }
+    PopScope();
+    _assigned.clear();
+}
+
+void AstSimplifier::findAssigned(const std::vector<std::string> &params, const std::vector<IAstExpression*> &body) {
+    _assigned.clear();
+    std::set<NameTable::NameId> declared;
+    for (unsigned i = 0, size = params.size(); i < size; ++i) {
+        declared.insert(NameTable::Intern(params[i]));
+    }
+    FlatAst ast(body);
+    for (unsigned i = 0, size = ast.getSize(); i < size; ++i) {
+        const FlatNode &node = ast[i];
+        bool isAssigned = node.Type == node_variable && (node.Flags & FlatNode::IsAssigned) != 0;
+        // shadowed or redeclared, a use could refer to either.
+        bool isRedeclared = node.Type == node_var && !declared.insert(node.Value).second;
+        if (isAssigned || isRedeclared) {
+            _assigned.insert(node.Value);
+        }
+    }
+}
+
+IAstExpression *AstSimplifier::Simplify(IAstExpression *expr) {
+    if (expr == nullptr) {
+        return nullptr;
+    }
+    IAstExpression *simplified = expr->Simplify(this);
+    if (simplified != expr) {
+        delete expr;
+    }
+    return simplified;
+}
+
+IAstExpression *AstSimplifier::SimplifyLValue(IAstExpression *expr) {
+    if (AstCast<AstVariableNode>(expr) != nullptr) {
+        return expr;
+    }
+    return Simplify(expr);
+}
+
+void AstSimplifier::SimplifyBlock(std::vector<IAstExpression*> &block) {
+    PushScope();
+    for (unsigned i = 0, size = block.size(); i < size; ++i) {
+        block[i] = Simplify(block[i]);
+    }
+    PopScope();
+}
+
+void AstSimplifier::PushScope() {
+    _scopes.push_back(std::map<NameTable::NameId, IAstExpression*>());
+}
+
+void AstSimplifier::PopScope() {
+    _scopes.pop_back();
+}
+
+void AstSimplifier::DeclareVariable(NameTable::NameId name, IAstExpression *value) {
+    if (_scopes.empty()) { // a field, not in a function.
+        return;
+    }
+    ConstantValue literal;
+    if (AstEvaluator::GetLiteral(value, literal) && _assigned.find(name) == _assigned.end()) {
+        _scopes.back()[name] = value;
+    }
+}
+
+IAstExpression *AstSimplifier::GetConstant(NameTable::NameId name, PossiblePosition pos) {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(name);
+        if (found == scope->end()) {
+            continue;
+        }
+        ConstantValue value;
+        AstEvaluator::GetLiteral(found->second, value);
+        return AstEvaluator::MakeLiteral(value, pos); // a variable is read as a signed value of the literal's type.
+    }
+    return nullptr;
+}
+
+IAstExpression *AstSimplifier::FoldBinary(TokenType oper, IAstExpression *lhs, IAstExpression *rhs, PossiblePosition pos) {
+    ConstantValue l, r, result;
+    if (!AstEvaluator::GetLiteral(lhs, l) || !AstEvaluator::GetLiteral(rhs, r)) {
+        return nullptr;
+    }
+    bool isUnsigned = Helpers::IsUnsigned(lhs->getNodeType()) && Helpers::IsUnsigned(rhs->getNodeType());
+    if (!AstEvaluator::EvaluateBinary(oper, l, r, isUnsigned, result)) {
+        return nullptr;
+    }
+    return AstEvaluator::MakeLiteral(result, pos);
+}
+
+IAstExpression *AstSimplifier::FoldUnary(TokenType oper, IAstExpression *operand, PossiblePosition pos) {
+    ConstantValue value, result;
+    if (!AstEvaluator::GetLiteral(operand, value) || !AstEvaluator::EvaluateUnary(oper, value, result)) {
+        return nullptr;
+    }
+    return AstEvaluator::MakeLiteral(result, pos);
+}
+
+IAstExpression *AstSimplifier::EvaluateCall(AstCallExpression *call) {
+    return _evaluator.EvaluateCall(call);
+}
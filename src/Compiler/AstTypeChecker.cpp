@@ -0,0 +1,425 @@
+#include "Compiler/AstTypeChecker.h"
+
+#include <algorithm>
+
+#include "AstNodes/AstArenaExpr.h"
+#include "AstNodes/AstAtomicExpr.h"
+#include "AstNodes/AstAwaitExpr.h"
+#include "AstNodes/AstBinaryOperatorExpr.h"
+#include "AstNodes/AstCallExpr.h"
+#include "AstNodes/AstForExpr.h"
+#include "AstNodes/AstIfElseExpr.h"
+#include "AstNodes/AstReturnExpr.h"
+#include "AstNodes/AstSpawnExpr.h"
+#include "AstNodes/AstUnaryOperatorExpr.h"
+#include "AstNodes/AstVarExpr.h"
+#include "AstNodes/AstVariableNode.h"
+#include "AstNodes/AstWhileExpr.h"
+#include "AstNodes/ClassAst.h"
+#include "AstNodes/FunctionAst.h"
+#include "AstNodes/PrototypeAst.h"
+#include "CodeGenerator/CodeGeneratorHelpers.h"
+#include "Compiler/TreeContainer.h"
+
+namespace {
+
+    // Returns the type of an integer literal's value once it's stored in a variable inferred from it or negated.
+    // The literal is unsigned only next to other literals, a value taken from it is signed like an 'int'.
+    AstNodeType literalValueType(AstNodeType type) {
+        switch (type) {
+        default: return type;
+        case node_unsigned_integer8: return node_signed_integer8;
+        case node_unsigned_integer16: return node_signed_integer16;
+        case node_unsigned_integer32: return node_signed_integer32;
+        case node_unsigned_integer64: return node_signed_integer64;
+        }
+    }
+
+    AstNodeType integerType(unsigned bitWidth, bool isUnsigned) {
+        switch (bitWidth) {
+        default: return node_default;
+        case 8: return isUnsigned ? node_unsigned_integer8 : node_signed_integer8;
+        case 16: return isUnsigned ? node_unsigned_integer16 : node_signed_integer16;
+        case 32: return isUnsigned ? node_unsigned_integer32 : node_signed_integer32;
+        case 64: return isUnsigned ? node_unsigned_integer64 : node_signed_integer64;
+        }
+    }
+
+    // Returns the type a type node declares, node_default for classes.
+    AstNodeType declaredType(AstTypeNode *type) {
+        if (type == nullptr || type->getTypeType() == node_struct) {
+            return node_default;
+        }
+        return type->getTypeType();
+    }
+
+    // Returns whether a value of type 'value' can't be implicitly cast to 'destination': strings and numbers don't mix.
+    bool isMismatched(AstNodeType destination, AstNodeType value) {
+        bool isKnown = (destination == node_string || AstTypeChecker::IsNumber(destination) || destination == node_boolean)
+            && (value == node_string || AstTypeChecker::IsNumber(value) || value == node_boolean);
+        return isKnown && (destination == node_string) != (value == node_string);
+    }
+
+    bool isComparison(TokenType oper) {
+        switch (oper) {
+        default: return false;
+        case '<':
+        case '>':
+        case tok_lessequal:
+        case tok_greatequal:
+        case tok_equalequal:
+        case tok_notequal:
+            return true;
+        }
+    }
+
+}
+
+AstTypeChecker::AstTypeChecker()
+    : _returnType(node_default)
+    , _loopDepth(0)
+    , _isValid(true) {
+}
+
+bool AstTypeChecker::Check(TreeContainer *trees) {
+    _functions.clear();
+    for (unsigned i = 0, size = trees->ExternalDeclarations.size(); i < size; ++i) {
+        PrototypeAst *proto = trees->ExternalDeclarations[i];
+        _functions[proto->getName()] = declaredType(proto->getReturnType());
+    }
+    std::map<std::string, unsigned> definitionCounts;
+    for (unsigned i = 0, size = trees->FunctionDefinitions.size(); i < size; ++i) {
+        PrototypeAst *proto = trees->FunctionDefinitions[i]->getPrototype();
+        _functions[proto->getName()] = declaredType(proto->getReturnType());
+        ++definitionCounts[proto->getName()];
+    }
+    for (auto count = definitionCounts.begin(); count != definitionCounts.end(); ++count) {
+        if (count->second > 1) { // overloaded, the callee depends on the arguments.
+            _functions.erase(count->first);
+        }
+    }
+    bool isValid = true;
+    for (unsigned i = 0, size = trees->ClassDefinitions.size(); i < size; ++i) {
+        isValid = trees->ClassDefinitions[i]->Check(this) && isValid;
+    }
+    for (unsigned i = 0, size = trees->FunctionDefinitions.size(); i < size; ++i) {
+        isValid = CheckFunction(trees->FunctionDefinitions[i]) && isValid;
+    }
+    return isValid;
+}
+
+AstNodeType AstTypeChecker::GetOperandType(AstNodeType lhs, AstNodeType rhs) {
+    if (lhs == node_boolean && rhs == node_boolean) {
+        return node_boolean;
+    }
+    if (IsInteger(lhs) && IsInteger(rhs)) {
+        unsigned bitWidth = std::max(GetBitWidth(lhs), GetBitWidth(rhs));
+        return integerType(bitWidth, Helpers::IsUnsigned(lhs) && Helpers::IsUnsigned(rhs));
+    }
+    bool isLhsFloating = lhs == node_double || lhs == node_float;
+    bool isRhsFloating = rhs == node_double || rhs == node_float;
+    if ((isLhsFloating && (IsInteger(rhs) || isRhsFloating)) || (isRhsFloating && IsInteger(lhs))) {
+        return lhs == node_double || rhs == node_double ? node_double : node_float; // a float next to a double is extended.
+    }
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::GetType(IAstExpression *expr) {
+    if (expr->getResolvedType() != node_default) {
+        return expr->getResolvedType();
+    }
+    AstNodeType type = expr->getNodeType();
+    return IsNumber(type) || type == node_boolean || type == node_string ? type : node_default;
+}
+
+AstNodeType AstTypeChecker::GetArgumentType(IAstExpression *arg) {
+    AstNodeType type = GetType(arg);
+    return AstCast<AstIntegerNode>(arg) != nullptr ? literalValueType(type) : type;
+}
+
+bool AstTypeChecker::IsInteger(AstNodeType type) {
+    return GetBitWidth(type) != 0;
+}
+
+bool AstTypeChecker::IsNumber(AstNodeType type) {
+    return IsInteger(type) || type == node_double || type == node_float;
+}
+
+unsigned AstTypeChecker::GetBitWidth(AstNodeType type) {
+    switch (type) {
+    default: return 0;
+    case node_signed_integer8:
+    case node_unsigned_integer8: return 8;
+    case node_signed_integer16:
+    case node_unsigned_integer16: return 16;
+    case node_signed_integer32:
+    case node_unsigned_integer32: return 32;
+    case node_signed_integer64:
+    case node_unsigned_integer64: return 64;
+    }
+}
+
+const char *AstTypeChecker::GetTypeName(AstNodeType type) {
+    switch (type) {
+    default: return "unknown";
+    case node_boolean: return "bool";
+    case node_double: return "double";
+    case node_float: return "float";
+    case node_signed_integer8: return "int8";
+    case node_signed_integer16: return "int16";
+    case node_signed_integer32: return "int";
+    case node_signed_integer64: return "int64";
+    case node_unsigned_integer8: return "uint8";
+    case node_unsigned_integer16: return "uint16";
+    case node_unsigned_integer32: return "uint";
+    case node_unsigned_integer64: return "uint64";
+    case node_string: return "string";
+    case node_void: return "void";
+    }
+}
+
+bool AstTypeChecker::CheckFunction(FunctionAst *func) {
+    PrototypeAst *proto = func->getPrototype();
+    _isValid = true;
+    _scopes.clear();
+    _scopes.push_back(std::map<NameTable::NameId, Variable>());
+    const std::vector<std::pair<std::string, AstTypeNode*>> &params = proto->getArgs();
+    for (unsigned i = 0, size = params.size(); i < size; ++i) {
+        declare(NameTable::Intern(params[i].first), declaredType(params[i].second), params[i].second->getIsArray());
+    }
+    _returnType = declaredType(proto->getReturnType());
+    _loopDepth = 0;
+    const std::vector<IAstExpression*> &body = func->getBody();
+    for (unsigned i = 0, size = body.size(); i < size; ++i) {
+        check(body[i]);
+    }
+    _scopes.clear();
+    return _isValid;
+}
+
+void AstTypeChecker::checkBlock(const std::vector<IAstExpression*> &block) {
+    _scopes.push_back(std::map<NameTable::NameId, Variable>());
+    for (unsigned i = 0, size = block.size(); i < size; ++i) {
+        check(block[i]);
+    }
+    _scopes.pop_back();
+}
+
+AstNodeType AstTypeChecker::check(IAstExpression *expr) {
+    if (expr == nullptr) {
+        return node_default;
+    }
+    AstNodeType type = Visit(expr);
+    expr->setResolvedType(type);
+    return type;
+}
+
+AstNodeType AstTypeChecker::VisitExpression(IAstExpression *expr) {
+    return GetType(expr); // a literal, or a node whose type is left to the code generator.
+}
+
+AstNodeType AstTypeChecker::VisitVariable(AstVariableNode *variable) {
+    const Variable *found = lookup(variable->getNameId());
+    return found != nullptr && !found->IsArray ? found->Type : node_default; // arrays are referred to by address.
+}
+
+AstNodeType AstTypeChecker::VisitVar(AstVarExpr *var) {
+    AstTypeNode *declared = var->getInferredType();
+    if (var->getAssignmentExpression() == nullptr) {
+        AstNodeType type = declaredType(declared);
+        declare(var->getNameId(), type, declared != nullptr && declared->getIsArray());
+        return type;
+    }
+    AstNodeType type = check(var->getAssignmentExpression()); // the variable takes the type of its initial value.
+    if (AstCast<AstIntegerNode>(var->getAssignmentExpression()) != nullptr) {
+        type = literalValueType(type);
+    }
+    if (isMismatched(declaredType(declared), type)) {
+        Helpers::Error(var->getPos(), "Can't initialize variable '%s' of type '%s' with a '%s'.", var->getName().c_str(),
+            GetTypeName(declaredType(declared)), GetTypeName(type));
+        _isValid = false;
+    }
+    declare(var->getNameId(), type, false);
+    return type;
+}
+
+AstNodeType AstTypeChecker::VisitCall(AstCallExpression *call) {
+    for (unsigned i = 0, size = call->getArgCount(); i < size; ++i) {
+        check(call->getArgs()[i]);
+    }
+    auto found = _functions.find(call->getName());
+    return found != _functions.end() ? found->second : node_default;
+}
+
+AstNodeType AstTypeChecker::VisitIfElse(AstIfElseExpr *ifElse) {
+    check(ifElse->getCondition());
+    checkBlock(ifElse->getIfBody());
+    checkBlock(ifElse->getElseBody());
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitWhile(AstWhileExpr *loop) {
+    ++_loopDepth;
+    check(loop->getCondition());
+    checkBlock(loop->getBody());
+    --_loopDepth;
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitFor(AstForExpr *loop) {
+    for (unsigned i = 0, size = loop->getReductions().size(); i < size; ++i) { // the reduced variables are outside the loop.
+        const Variable *found = lookup(NameTable::Intern(loop->getReductions()[i].VariableName));
+        loop->setReductionType(i, found != nullptr && !found->IsArray ? found->Type : node_default);
+    }
+    _scopes.push_back(std::map<NameTable::NameId, Variable>()); // of the variables declared by the initialization.
+    for (unsigned i = 0, size = loop->getInit().size(); i < size; ++i) {
+        check(loop->getInit()[i]);
+    }
+    ++_loopDepth;
+    check(loop->getCondition());
+    for (unsigned i = 0, size = loop->getAfterthought().size(); i < size; ++i) {
+        check(loop->getAfterthought()[i]);
+    }
+    checkBlock(loop->getBody());
+    --_loopDepth;
+    _scopes.pop_back();
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitReturn(AstReturnExpr *ret) {
+    AstNodeType value = check(ret->getExpr());
+    if (isMismatched(_returnType, value)) {
+        Helpers::Error(ret->getPos(), "Can't return a '%s' from a function returning '%s'.", GetTypeName(value), GetTypeName(_returnType));
+        _isValid = false;
+    }
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitArena(AstArenaExpr *arena) {
+    checkBlock(arena->getBody());
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitSpawn(AstSpawnExpr *spawn) {
+    check(spawn->getCall());
+    return node_default; // a future.
+}
+
+AstNodeType AstTypeChecker::VisitAwait(AstAwaitExpr *await) {
+    check(await->getFuture());
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitAtomic(AstAtomicExpr *atomic) {
+    for (unsigned i = 0, size = atomic->getArgs().size(); i < size; ++i) {
+        check(atomic->getArgs()[i]);
+    }
+    return node_default;
+}
+
+AstNodeType AstTypeChecker::VisitBinaryOperator(AstBinaryOperatorExpr *binop) {
+    TokenType oper = binop->getOperator();
+    IAstExpression *lhs = binop->getLHS();
+    IAstExpression *rhs = binop->getRHS();
+    if (oper == '.') { // the right names a field, or is a method call whose arguments are checked.
+        check(lhs);
+        if (AstCallExpression *call = AstCast<AstCallExpression>(rhs)) {
+            for (unsigned i = 0, size = call->getArgCount(); i < size; ++i) {
+                check(call->getArgs()[i]);
+            }
+        }
+        return node_default;
+    }
+    AstNodeType l = check(lhs);
+    AstNodeType r = check(rhs);
+    if (oper == '=') {
+        if (isMismatched(l, r)) {
+            Helpers::Error(binop->getPos(), "Can't assign a '%s' to a '%s'.", GetTypeName(r), GetTypeName(l));
+            _isValid = false;
+        }
+        return AstCast<AstVariableNode>(lhs) != nullptr ? l : node_default;
+    }
+    bool isAssignment = oper == tok_plusequals || oper == tok_minusequals || oper == tok_multequals || oper == tok_divequals
+        || oper == tok_modequals || oper == tok_andequals || oper == tok_orequals || oper == tok_xorequals
+        || oper == tok_leftshiftequal || oper == tok_rightshiftequal;
+    if (l == node_string || r == node_string) {
+        bool isConcat = l == node_string && r == node_string && (oper == '+' || oper == tok_plusequals);
+        if (!isConcat && l != node_default && r != node_default) {
+            Helpers::Error(binop->getPos(), "Operator does not exist for '%s' and '%s'.", GetTypeName(l), GetTypeName(r));
+            _isValid = false;
+        }
+        return isConcat ? node_string : node_default;
+    }
+    AstNodeType operandType = GetOperandType(l, r);
+    binop->setOperandType(operandType);
+    if (operandType == node_default) {
+        return node_default;
+    }
+    checkConversion(lhs, l, operandType);
+    checkConversion(rhs, r, operandType);
+    if (isAssignment) { // stored back into the variable.
+        return AstCast<AstVariableNode>(lhs) != nullptr ? l : node_default;
+    }
+    if (isComparison(oper)) {
+        return node_boolean;
+    }
+    if (oper == tok_booleanand || oper == tok_booleanor) {
+        return node_default;
+    }
+    return operandType;
+}
+
+AstNodeType AstTypeChecker::VisitUnaryOperator(AstUnaryOperatorExpr *unary) {
+    switch (unary->getOperator()) {
+    default: return node_default;
+    case '[': {
+        check(unary->getOperand());
+        check(unary->getIndex());
+        AstVariableNode *array = AstCast<AstVariableNode>(unary->getOperand());
+        const Variable *found = array != nullptr ? lookup(array->getNameId()) : nullptr;
+        return found != nullptr && found->IsArray ? found->Type : node_default;
+    }
+    case '!':
+        check(unary->getOperand());
+        return node_boolean;
+    case '+':
+    case '-':
+    case '~':
+    case tok_plusplus:
+    case tok_minusminus: {
+        AstNodeType type = check(unary->getOperand());
+        if (!IsNumber(type)) {
+            return node_default;
+        }
+        return AstCast<AstIntegerNode>(unary->getOperand()) != nullptr ? literalValueType(type) : type;
+    }
+    }
+}
+
+void AstTypeChecker::checkConversion(IAstExpression *operand, AstNodeType type, AstNodeType operandType) {
+    AstVariableNode *variable = AstCast<AstVariableNode>(operand);
+    if (_loopDepth == 0 || variable == nullptr) { // a literal is converted at compile time.
+        return;
+    }
+    bool isWidened = IsInteger(type) && ((IsInteger(operandType) && GetBitWidth(type) < GetBitWidth(operandType))
+        || operandType == node_double || operandType == node_float);
+    if (isWidened) {
+        Helpers::Warning(operand->getPos(), "'%s' is converted from '%s' to '%s' on every iteration, declaring it as '%s' avoids the conversion.",
+            variable->getName().c_str(), GetTypeName(type), GetTypeName(operandType), GetTypeName(operandType));
+    }
+}
+
+void AstTypeChecker::declare(NameTable::NameId name, AstNodeType type, bool isArray) {
+    Variable variable = { type, isArray };
+    _scopes.back()[name] = variable;
+}
+
+const AstTypeChecker::Variable *AstTypeChecker::lookup(NameTable::NameId name) const {
+    for (auto scope = _scopes.rbegin(); scope != _scopes.rend(); ++scope) {
+        auto found = scope->find(name);
+        if (found != scope->end()) {
+            return &found->second;
+        }
+    }
+    return nullptr;
+}
@@ -6,18 +6,25 @@
 #include "Lexer/Token.h"
 #include "Lexer/Lexer.h"
 #include "Parser/Parser.h"
+#include "Compiler/AstSimplifier.h"
+#include "Compiler/AstTypeChecker.h"
 #include "CodeGenerator/CodeGenerator.h"
 #include "Compiler/TreeContainer.h"
 
 DemiurgeCompiler::DemiurgeCompiler() {
     _lexer = new Lexer();
     _parser = new Parser();
+    _simplifier = new AstSimplifier();
+    _typeChecker = new AstTypeChecker();
     _codeGenerator = new CodeGenerator();
+    _codeGenerator->setPasses(_simplifier, _typeChecker);
 }
 
 DemiurgeCompiler::~DemiurgeCompiler() {
     delete _lexer;
     delete _parser;
+    delete _simplifier;
+    delete _typeChecker;
     delete _codeGenerator;
 }
 
@@ -48,6 +55,12 @@ void DemiurgeCompiler::Run() {
             if (trees == nullptr) {
                 return;
             }
+            if (!_simplifier->Simplify(trees)) {
+                return;
+            }
+            if (!_typeChecker->Check(trees)) {
+                return;
+            }
 
             success = success && _codeGenerator->GenerateCode(trees);
             if (!success) {
@@ -106,6 +119,9 @@ bool DemiurgeCompiler::setStateVars() {
         else if (str == "-jit") {
             _jitCompile = true;
         }
+        else if (str == "-gc") {
+            _codeGenerator->setUseGC(true);
+        }
         else {
             fprintf(stderr, "Unknown argument '%s' used, try -h or --help for usage.\n", str.c_str());
             return false;
@@ -140,6 +156,7 @@ void DemiurgeCompiler::printHelpMessage() {
     fprintf(stderr, "    -h --help          : prints this message.\n");
     fprintf(stderr, "    --llvm-asm         : emits llvm assembly instead of bytecode.\n");
     fprintf(stderr, "    --info             : prints compiler information.\n");
+    fprintf(stderr, "    -gc                : allocates 'new' from a garbage collected heap.\n");
     fprintf(stderr, "\n");
 }
 
@@ -0,0 +1,273 @@
+#include "Compiler/FlatAst.h"
+
+#include <algorithm>
+
+#include "AstNodes/AstVisitor.h"
+#include "Lexer/NameTable.h"
+
+// Appends the nodes of a tree to a FlatAst in pre-order, closing each node's subtree once its children are in.
+class FlatAstEncoder : public AstVisitor<FlatAstEncoder, void> {
+    friend class AstVisitor<FlatAstEncoder, void>;
+    FlatAst &_ast;
+public:
+    explicit FlatAstEncoder(FlatAst &ast) : _ast(ast) {}
+
+    void Encode(IAstExpression *expr) {
+        if (expr == nullptr) {
+            leaf(node_default, PossiblePosition{ 0, 0 });
+            return;
+        }
+        Visit(expr);
+    }
+
+    void EncodeBlock(const std::vector<IAstExpression*> &block, PossiblePosition pos) {
+        unsigned node = _ast.add(FlatAst::node_block, pos);
+        for (unsigned i = 0, size = block.size(); i < size; ++i) {
+            Encode(block[i]);
+        }
+        close(node);
+    }
+
+private:
+    void close(unsigned node) {
+        _ast._nodes[node].End = _ast._nodes.size();
+    }
+    unsigned leaf(uint8_t type, PossiblePosition pos, uint32_t value = 0) {
+        unsigned node = _ast.add(type, pos);
+        _ast._nodes[node].Value = value;
+        close(node);
+        return node;
+    }
+    // Encodes an expression that is written to, marking it if it's a variable.
+    void encodeLValue(IAstExpression *expr) {
+        unsigned node = _ast._nodes.size();
+        Encode(expr);
+        if (_ast._nodes[node].Type == node_variable) {
+            _ast._nodes[node].Flags |= FlatNode::IsAssigned;
+        }
+    }
+    void encodeArguments(unsigned node, const std::vector<IAstExpression*> &args, bool isFirstAssigned) {
+        for (unsigned i = 0, size = args.size(); i < size; ++i) {
+            if (i == 0 && isFirstAssigned) {
+                encodeLValue(args[i]);
+            }
+            else {
+                Encode(args[i]);
+            }
+        }
+        close(node);
+    }
+    void encodeLiteral(IAstExpression *expr) {
+        ConstantValue value;
+        AstEvaluator::GetLiteral(expr, value);
+        leaf(expr->getNodeType(), expr->getPos(), _ast._constants.size());
+        _ast._constants.push_back(value);
+    }
+
+    void VisitExpression(IAstExpression *expr) {
+        leaf(node_default, expr->getPos());
+    }
+    void VisitInteger(AstIntegerNode *expr) {
+        encodeLiteral(expr);
+    }
+    void VisitDouble(AstDoubleNode *expr) {
+        encodeLiteral(expr);
+    }
+    void VisitBoolean(AstBooleanNode *expr) {
+        encodeLiteral(expr);
+    }
+    void VisitString(AstStringNode *expr) {
+        leaf(node_string, expr->getPos(), _ast._strings.size());
+        _ast._strings.push_back(expr->getValue());
+    }
+    void VisitVariable(AstVariableNode *variable) {
+        leaf(node_variable, variable->getPos(), variable->getNameId());
+    }
+
+    void VisitVar(AstVarExpr *var) {
+        unsigned node = _ast.add(node_var, var->getPos());
+        _ast._nodes[node].Value = var->getNameId();
+        if (var->getAssignmentExpression() != nullptr) {
+            _ast._nodes[node].Flags |= FlatNode::HasInitializer;
+            Encode(var->getAssignmentExpression());
+        }
+        AstTypeNode *type = var->getInferredType();
+        if (type != nullptr && type->getArraySubscript() != nullptr) {
+            _ast._nodes[node].Flags |= FlatNode::HasSubscript;
+            Encode(type->getArraySubscript());
+        }
+        close(node);
+    }
+
+    void VisitBinaryOperator(AstBinaryOperatorExpr *binop) {
+        unsigned node = _ast.add(node_binary_operation, binop->getPos());
+        _ast._nodes[node].Operator = binop->getOperator();
+        switch (binop->getOperator()) {
+        case '.': // the right names a field, only a method call's arguments are looked into.
+            Encode(binop->getLHS());
+            if (AstCast<AstCallExpression>(binop->getRHS()) != nullptr) {
+                Encode(binop->getRHS());
+            }
+            else {
+                leaf(node_default, binop->getRHS()->getPos());
+            }
+            break;
+        case '=':
+        case tok_plusequals:
+        case tok_minusequals:
+        case tok_multequals:
+        case tok_divequals:
+        case tok_modequals:
+        case tok_andequals:
+        case tok_orequals:
+        case tok_xorequals:
+        case tok_leftshiftequal:
+        case tok_rightshiftequal:
+            encodeLValue(binop->getLHS());
+            Encode(binop->getRHS());
+            break;
+        default:
+            Encode(binop->getLHS());
+            Encode(binop->getRHS());
+            break;
+        }
+        close(node);
+    }
+
+    void VisitUnaryOperator(AstUnaryOperatorExpr *unary) {
+        unsigned node = _ast.add(unary->getNodeType(), unary->getPos());
+        _ast._nodes[node].Operator = unary->getOperator();
+        switch (unary->getOperator()) {
+        case tok_new: {
+            AstTypeNode *type = unary->getTypeNode();
+            if (type != nullptr && type->getArraySubscript() != nullptr) {
+                _ast._nodes[node].Flags |= FlatNode::HasSubscript;
+                Encode(type->getArraySubscript());
+            }
+            break;
+        }
+        case tok_plusplus:
+        case tok_minusminus:
+            encodeLValue(unary->getOperand());
+            break;
+        case '[':
+            Encode(unary->getOperand());
+            Encode(unary->getIndex());
+            break;
+        default:
+            Encode(unary->getOperand());
+            break;
+        }
+        close(node);
+    }
+
+    void VisitCall(AstCallExpression *call) {
+        unsigned node = _ast.add(node_call, call->getPos());
+        _ast._nodes[node].Value = call->getNameId();
+        encodeArguments(node, call->getArgs(), false);
+    }
+
+    void VisitAtomic(AstAtomicExpr *atomic) { // the first argument is operated on.
+        unsigned node = _ast.add(node_atomic, atomic->getPos());
+        _ast._nodes[node].Value = NameTable::Intern(atomic->getName());
+        encodeArguments(node, atomic->getArgs(), true);
+    }
+
+    void VisitIfElse(AstIfElseExpr *ifElse) {
+        unsigned node = _ast.add(node_ifelse, ifElse->getPos());
+        Encode(ifElse->getCondition());
+        EncodeBlock(ifElse->getIfBody(), ifElse->getPos());
+        EncodeBlock(ifElse->getElseBody(), ifElse->getPos());
+        close(node);
+    }
+
+    void VisitWhile(AstWhileExpr *loop) {
+        unsigned node = _ast.add(node_while, loop->getPos());
+        Encode(loop->getCondition());
+        EncodeBlock(loop->getBody(), loop->getPos());
+        close(node);
+    }
+
+    void VisitFor(AstForExpr *loop) {
+        unsigned node = _ast.add(node_for, loop->getPos());
+        EncodeBlock(loop->getInit(), loop->getPos());
+        Encode(loop->getCondition());
+        EncodeBlock(loop->getAfterthought(), loop->getPos());
+        EncodeBlock(loop->getBody(), loop->getPos());
+        unsigned reductions = _ast.add(FlatAst::node_block, loop->getPos());
+        const std::vector<AstReductionClause> &clauses = loop->getReductions();
+        for (unsigned i = 0, size = clauses.size(); i < size; ++i) {
+            unsigned variable = leaf(node_variable, clauses[i].Pos, NameTable::Intern(clauses[i].VariableName));
+            _ast._nodes[variable].Operator = clauses[i].Operator;
+            _ast._nodes[variable].Flags |= FlatNode::IsAssigned;
+        }
+        close(reductions);
+        close(node);
+    }
+
+    void VisitReturn(AstReturnExpr *ret) {
+        unsigned node = _ast.add(node_return, ret->getPos());
+        if (ret->getExpr() != nullptr) {
+            Encode(ret->getExpr());
+        }
+        close(node);
+    }
+
+    void VisitAwait(AstAwaitExpr *await) {
+        unsigned node = _ast.add(node_await, await->getPos());
+        Encode(await->getFuture());
+        close(node);
+    }
+
+    void VisitSpawn(AstSpawnExpr *spawn) {
+        unsigned node = _ast.add(node_spawn, spawn->getPos());
+        Encode(spawn->getCall());
+        close(node);
+    }
+
+    void VisitArena(AstArenaExpr *arena) {
+        unsigned node = _ast.add(node_arena, arena->getPos());
+        EncodeBlock(arena->getBody(), arena->getPos());
+        close(node);
+    }
+};
+
+FlatAst::FlatAst(const std::vector<IAstExpression*> &body) {
+    FlatAstEncoder(*this).EncodeBlock(body, PossiblePosition{ 0, 0 });
+}
+
+unsigned FlatAst::getSize() const {
+    return _nodes.size();
+}
+
+const FlatNode &FlatAst::operator[](unsigned node) const {
+    return _nodes[node];
+}
+
+PossiblePosition FlatAst::getPos(unsigned node) const {
+    return UnpackPos(_nodes[node].Pos);
+}
+
+const ConstantValue &FlatAst::getConstant(unsigned node) const {
+    return _constants[_nodes[node].Value];
+}
+
+const std::string &FlatAst::getString(unsigned node) const {
+    return _strings[_nodes[node].Value];
+}
+
+uint32_t FlatAst::PackPos(PossiblePosition pos) {
+    uint32_t line = uint32_t(std::min(std::max(pos.LineNumber, 0), 0xfffff));
+    uint32_t column = uint32_t(std::min(std::max(pos.ColumnNumber, 0), 0xfff));
+    return line << 12 | column;
+}
+
+PossiblePosition FlatAst::UnpackPos(uint32_t pos) {
+    return PossiblePosition{ int(pos >> 12), int(pos & 0xfff) };
+}
+
+unsigned FlatAst::add(uint8_t type, PossiblePosition pos) {
+    FlatNode node = { type, 0, 0, 0, PackPos(pos), 0 };
+    _nodes.push_back(node);
+    return _nodes.size() - 1;
+}
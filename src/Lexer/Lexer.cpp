@@ -223,6 +223,10 @@ Token *Lexer::buildWord() {
     else if (_builderWord == "while") { tokType = tok_while; }
     else if (_builderWord == "for") { tokType = tok_for; }
     else if (_builderWord == "new") { tokType = tok_new;  isUnaryOperator = true; }
+    else if (_builderWord == "reduce") { tokType = tok_reduce; }
+    else if (_builderWord == "spawn") { tokType = tok_spawn; }
+    else if (_builderWord == "await") { tokType = tok_await; }
+    else if (_builderWord == "atomic") { tokType = tok_atomic; }
 
     else if (_builderWord == "void") { tokType = tok_typevoid; }
     
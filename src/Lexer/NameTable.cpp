@@ -0,0 +1,36 @@
+#include "Lexer/NameTable.h"
+
+#include <deque>
+#include <unordered_map>
+
+namespace NameTable {
+
+    namespace {
+        // A deque never moves its elements, so the names returned by GetName stay valid as more are interned.
+        std::deque<std::string> &names() {
+            static std::deque<std::string> names;
+            return names;
+        }
+        std::unordered_map<std::string, NameId> &ids() {
+            static std::unordered_map<std::string, NameId> ids;
+            return ids;
+        }
+    }
+
+    NameId Intern(const std::string &name) {
+        auto inserted = ids().insert(std::make_pair(name, NameId(names().size())));
+        if (inserted.second) {
+            names().push_back(name);
+        }
+        return inserted.first->second;
+    }
+
+    const std::string &GetName(NameId id) {
+        return names()[id];
+    }
+
+    unsigned GetCount() {
+        return names().size();
+    }
+
+}
@@ -21,10 +21,16 @@
 #include "AstNodes/AstVariableNode.h"
 #include "AstNodes/AstWhileExpr.h"
 #include "AstNodes/AstForExpr.h"
+#include "AstNodes/AstSpawnExpr.h"
+#include "AstNodes/AstAwaitExpr.h"
+#include "AstNodes/AstAtomicExpr.h"
+#include "AstNodes/AstArenaExpr.h"
 #include "AstNodes/FunctionAst.h"
 #include "AstNodes/PrototypeAst.h"
 #include "AstNodes/ClassAst.h"
+#include "AstNodes/GenericFunctionAst.h"
 #include "AstNodes/IAstExpression.h"
+#include "AstNodes/AstVisitor.h"
 
 Parser::Parser() {
     
@@ -91,12 +97,25 @@ TreeContainer *Parser::ParseTrees(const std::vector<Token*> &tokens) {
             trees->ClassDefinitions.push_back(class_);
         }
         else if (_curTokenType == tok_func) {
+            int start = _tokenIndex - 1;
             FunctionAst *func = parseFunctionDefinition();
             if (func == nullptr) {
                 delete trees;
                 return nullptr;
             }
-            trees->FunctionDefinitions.push_back(func);
+            addFunctionDefinition(trees, func, start);
+        }
+        else if (_curTokenType == tok_identifier && _curToken->Value() == "const" && peek(0) != nullptr
+            && peek(0)->Type() == tok_func) { // not reserved, 'const' can still be a variable.
+            next(); // eat 'const'
+            int start = _tokenIndex - 1;
+            FunctionAst *func = parseFunctionDefinition();
+            if (func == nullptr) {
+                delete trees;
+                return nullptr;
+            }
+            func->setIsConst(true);
+            addFunctionDefinition(trees, func, start);
         }
         else if (_curTokenType == tok_extern)  {
             PrototypeAst *declaration = parseExternDeclaration();
@@ -220,6 +239,9 @@ IAstExpression *Parser::parseControlFlow() {
 //                      |   <string>
 //                      |   <bool>
 //                      |   <number>
+//                      |   <spawnexpr>
+//                      |   <awaitexpr>
+//                      |   <arenaexpr>
 IAstExpression *Parser::parsePrimary() {
     if (_curToken->IsUnaryOperator())
     {
@@ -232,10 +254,18 @@ IAstExpression *Parser::parsePrimary() {
     default: return nullptr;
     case '(': return parseParenExpression();
     case ';': next(); return parseExpression();
-    case tok_identifier: return parseIdentifierExpression();
+    case tok_identifier: {
+        Token *following = peek(0);
+        if (_curToken->Value() == "arena" && following != nullptr && following->Type() == '{') { // not reserved, 'arena' can still be a variable.
+            return parseArenaExpression();
+        }
+        return parseIdentifierExpression();
+    }
     case tok_string: return parseStringExpression();
     case tok_bool: return parseBooleanExpression();
     case tok_number: return parseNumberExpression();
+    case tok_spawn: return parseSpawnExpression();
+    case tok_await: return parseAwaitExpression();
     }
 }
 
@@ -329,7 +359,7 @@ IAstExpression *Parser::parseVarExpression() {
     if (_curTokenType != tok_identifier) {
         return Error("Expected identifier.");
     }
-    std::string identifier = _curToken->Value();
+    NameTable::NameId identifier = _curToken->Name();
     next(); // eat identifier
 
     if (_curTokenType == ':') { // "var x : int"
@@ -376,9 +406,10 @@ IAstExpression *Parser::parseIdentifierExpression() {
         return Error("Expected identifier.");
     }
     std::string identifier = _curToken->Value();
+    NameTable::NameId name = _curToken->Name();
     next(); // eat identifier
     if (_curTokenType != '(') { // standard identifier reference
-        return new AstVariableNode(identifier, _curToken->Line(), _curToken->Column());
+        return new AstVariableNode(name, _curToken->Line(), _curToken->Column());
     }
 
     // otherwise it's a call.
@@ -395,7 +426,61 @@ IAstExpression *Parser::parseIdentifierExpression() {
         return Error("Expected ')' in call.");
     }
     next(); // eat ')'
-    return new AstCallExpression(identifier, args, _curToken->Line(), _curToken->Column());
+    if (AstAtomicExpr::IsAtomicBuiltin(identifier)) {
+        return new AstAtomicExpr(identifier, args, _curToken->Line(), _curToken->Column());
+    }
+    return new AstCallExpression(name, args, _curToken->Line(), _curToken->Column());
+}
+
+// <spawnexpr>          ::= 'spawn' identifier '(' <expression>* ')'
+IAstExpression *Parser::parseSpawnExpression() {
+    if (_curTokenType != tok_spawn) {
+        return Error("Expected 'spawn'.");
+    }
+    next(); // eat 'spawn'
+    int line = _curToken->Line(), column = _curToken->Column();
+    IAstExpression *expr = parseIdentifierExpression();
+    AstCallExpression *call = AstCast<AstCallExpression>(expr);
+    if (call == nullptr) {
+        delete expr;
+        return Error("Expected a function call after 'spawn'.");
+    }
+    return new AstSpawnExpr(call, line, column);
+}
+
+// <arenaexpr>          ::= 'arena' '{' <blockexpr>* '}'
+IAstExpression *Parser::parseArenaExpression() {
+    int line = _curToken->Line(), column = _curToken->Column();
+    next(); // eat 'arena'
+    if (_curTokenType != '{') {
+        return Error("Expected '{' after 'arena'.");
+    }
+    next(); // eat '{'
+    std::vector<IAstExpression*> body;
+    while (_curTokenType != '}') {
+        IAstExpression *blockExpr = parseBlockExpression();
+        if (blockExpr == nullptr) {
+            while (!body.empty()) delete body.back(), body.pop_back();
+            return Error("Unexpected token.");
+        }
+        body.push_back(blockExpr);
+    }
+    next(); // eat '}'
+    return new AstArenaExpr(body, line, column);
+}
+
+// <awaitexpr>          ::= 'await' <primary>
+IAstExpression *Parser::parseAwaitExpression() {
+    if (_curTokenType != tok_await) {
+        return Error("Expected 'await'.");
+    }
+    next(); // eat 'await'
+    int line = _curToken->Line(), column = _curToken->Column();
+    IAstExpression *future = parsePrimary();
+    if (future == nullptr) {
+        return Error("Expected an expression after 'await'.");
+    }
+    return new AstAwaitExpr(future, line, column);
 }
 
 // <numberexpr>         ::= number_literal
@@ -527,6 +612,7 @@ IAstExpression *Parser::parseWhileExpression() {
 //                          <expression> ';'                        -- Condition
 //                          <expression> (',' <expression>)*        -- Afterthought
 //                          ')'         
+//                          <reduceclause>*                         -- Reductions
 //                          '{' <expression>* '}'                   -- Body
 IAstExpression *Parser::parseForExpression() {
     if (_curTokenType != tok_for) {
@@ -582,6 +668,14 @@ IAstExpression *Parser::parseForExpression() {
     }
     next(); // eat ')'
 
+    // Parse the for loop reduction clauses.
+    std::vector<AstReductionClause> reductions;
+    while (_curTokenType == tok_reduce) {
+        if (!parseReductionClause(reductions)) {
+            return nullptr;
+        }
+    }
+
     // Parse the for loop body.
     std::vector<IAstExpression*> body;
     if (_curTokenType != '{') { // Assume single statement for loop.
@@ -594,7 +688,79 @@ IAstExpression *Parser::parseForExpression() {
         }
         next(); // eat '}'
     }
-    return new AstForExpr(init, condition, afterthough, body, _curToken->Line(), _curToken->Column());
+    return new AstForExpr(init, condition, afterthough, body, reductions, _curToken->Line(), _curToken->Column());
+}
+
+// <reduceclause>       ::= 'reduce' '(' <reduceop> ':' identifier (',' identifier)* ')'
+// <reduceop>           ::= '+' | '*' | '&' | '|' | '^' | 'min' | 'max'
+bool Parser::parseReductionClause(std::vector<AstReductionClause> &reductions) {
+    if (_curTokenType != tok_reduce) {
+        Error("Expected 'reduce'.");
+        return false;
+    }
+    next(); // eat 'reduce'
+
+    if (_curTokenType != '(') {
+        Error("Expected '('.");
+        return false;
+    }
+    next(); // eat '('
+
+    std::string operStr = _curToken->Value();
+    TokenType oper;
+    switch (_curTokenType) {
+    default:
+        Error("Expected reduction operator, one of '+', '*', '&', '|', '^', 'min' or 'max'.");
+        return false;
+    case '+':
+    case '*':
+    case '&':
+    case '|':
+    case '^':
+        oper = (TokenType)_curTokenType;
+        break;
+    case tok_identifier:
+        if (operStr == "min") { oper = (TokenType)'<'; }
+        else if (operStr == "max") { oper = (TokenType)'>'; }
+        else {
+            Error("Expected reduction operator, one of '+', '*', '&', '|', '^', 'min' or 'max'.");
+            return false;
+        }
+        break;
+    }
+    next(); // eat operator
+
+    if (_curTokenType != ':') {
+        Error("Expected ':' after reduction operator.");
+        return false;
+    }
+    next(); // eat ':'
+
+    while (true) {
+        if (_curTokenType != tok_identifier) {
+            Error("Expected identifier in 'reduce' clause.");
+            return false;
+        }
+        AstReductionClause reduction;
+        reduction.Pos = PossiblePosition{ _curToken->Line(), _curToken->Column() };
+        reduction.Operator = oper;
+        reduction.OperatorString = operStr;
+        reduction.VariableName = _curToken->Value();
+        reduction.VariableType = node_default;
+        reductions.push_back(reduction);
+        next(); // eat identifier
+        if (_curTokenType != ',') {
+            break;
+        }
+        next(); // eat ','
+    }
+
+    if (_curTokenType != ')') {
+        Error("Expected ')'.");
+        return false;
+    }
+    next(); // eat ')'
+    return true;
 }
 
 // <arraysubscript>     ::= '[' <expression> ']'
@@ -620,11 +786,35 @@ IAstExpression *Parser::parseNewMallocExpression() {
     return new AstUnaryOperatorExpr("new", tok_new, newType, false, _curToken->Line(), _curToken->Column());
 }
 
-// <type>               ::= ( identifier | <reserved type> ) ( '[' <numberexpr>? ']' )?
+// <type>               ::= ( identifier | <reserved type> | 'atomic' '<' <reserved type> '>' ) ( '[' <numberexpr>? ']' )?
+//                      |   'soa' identifier '[' <numberexpr> ']'
 AstTypeNode *Parser::parseTypeNode() {
+    Token *following = peek(0);
+    bool isSoa = _curTokenType == tok_identifier && _curToken->Value() == "soa" // not reserved, 'soa' can still be a class name.
+        && following != nullptr && following->Type() == tok_identifier;
+    if (isSoa) {
+        next(); // eat 'soa'
+    }
+    bool isAtomic = _curTokenType == tok_atomic;
+    if (isAtomic) {
+        next(); // eat 'atomic'
+        if (_curTokenType != '<') {
+            return Error("Expected '<' after 'atomic'.");
+        }
+        next(); // eat '<'
+    }
     int tokType = _curTokenType;
     std::string typeName = _curToken->Value();
     next(); // eat type
+    if (isAtomic) {
+        if (tokType < tok_typeint8 || tokType > tok_typeuint64) {
+            return Error("Only integer types can be atomic, got '%s'.", typeName.c_str());
+        }
+        if (_curTokenType != '>') {
+            return Error("Expected '>' after atomic type.");
+        }
+        next(); // eat '>'
+    }
 
     AstNodeType nodeType;
     IAstExpression *subscript = nullptr;
@@ -636,7 +826,7 @@ AstTypeNode *Parser::parseTypeNode() {
     } 
     else if (_curTokenType == '[') {
         subscript = parseArraySubscript();
-        AstIntegerNode *size = dynamic_cast<AstIntegerNode*>(subscript);
+        AstIntegerNode *size = AstCast<AstIntegerNode>(subscript);
         if (size != nullptr) { // the subscript is a number, go ahead and assume this is a static array.
             arraySize = size->getValue();
             if (arraySize <= 0) {
@@ -668,14 +858,25 @@ AstTypeNode *Parser::parseTypeNode() {
 
     case tok_typestring: nodeType = node_string; break;
     }
+    AstTypeNode *typeNode;
     if (isArray && arraySize > 0) { // static sized array.
-        return new AstTypeNode(nodeType, typeName, isArray, arraySize, _curToken->Line(), _curToken->Column());
+        typeNode = new AstTypeNode(nodeType, typeName, isArray, arraySize, _curToken->Line(), _curToken->Column());
+    }
+    else if (isArray && arraySize == 0) { // 'new' array.
+        typeNode = new AstTypeNode(nodeType, typeName, isArray, subscript, _curToken->Line(), _curToken->Column());
     }
-    if (isArray && arraySize == 0) { // 'new' array.
-        return new AstTypeNode(nodeType, typeName, isArray, subscript, _curToken->Line(), _curToken->Column());
+    else { // Some other type.
+        typeNode = new AstTypeNode(nodeType, typeName, _curToken->Line(), _curToken->Column());
     }
-    // Some other type.
-    return new AstTypeNode(nodeType, typeName, _curToken->Line(), _curToken->Column());
+    typeNode->setIsAtomic(isAtomic);
+    if (isSoa) {
+        if (arraySize == 0) {
+            delete typeNode;
+            return Error("'soa' arrays must have a constant size.");
+        }
+        typeNode->setIsSoa(true);
+    }
+    return typeNode;
 }
 
 // Attempts to generate an AstTypeNode from the expression's type.
@@ -701,7 +902,21 @@ AstTypeNode *Parser::tryInferType(IAstExpression *expr) {
     }
 }
 
-// <functionast>        ::= <prototype>  '{' <expression>* '}'
+// Adds a function to the trees, a generic one keeps its tokens from 'start' on to be instantiated from.
+void Parser::addFunctionDefinition(TreeContainer *trees, FunctionAst *func, int start) {
+    if (func->getPrototype()->getTypeParameters().empty()) {
+        trees->FunctionDefinitions.push_back(func);
+        return;
+    }
+    int end = _curToken != nullptr ? _tokenIndex - 1 : _tokenIndex; // the current token follows the body.
+    std::vector<Token> tokens;
+    for (int i = start; i < end; ++i) {
+        tokens.push_back(*_tokens[i]);
+    }
+    trees->GenericFunctions.push_back(new GenericFunctionAst(func, tokens));
+}
+
+// <functionast>        ::= 'const'? <prototype>  '{' <expression>* '}'
 FunctionAst *Parser::parseFunctionDefinition() {
     PrototypeAst *proto = parsePrototype();
     if (proto == nullptr) {
@@ -730,7 +945,7 @@ FunctionAst *Parser::parseFunctionDefinition() {
 }
 
 // let id := identifier
-// <prototype>          ::= 'func' id '(' id ':' <type> (',' id ':' <type>)* ')' ':' <type>
+// <prototype>          ::= 'func' id ('<' id (',' id)* '>')? '(' id ':' <type> (',' id ':' <type>)* ')' ':' <type>
 PrototypeAst *Parser::parsePrototype() {
     if (_curTokenType != tok_func) {
         return Error("Expected 'func'.");
@@ -740,9 +955,26 @@ PrototypeAst *Parser::parsePrototype() {
     if (_curTokenType != tok_identifier) {
         return Error("Expected identifier in function prototype.");
     }
-    std::string functionIdentifier = _curToken->Value();
+    NameTable::NameId functionIdentifier = _curToken->Name();
     next(); // eat identifier
 
+    std::vector<std::string> typeParameters;
+    if (_curTokenType == '<') { // generic function.
+        next(); // eat '<'
+        while (_curTokenType == tok_identifier) {
+            typeParameters.push_back(_curToken->Value());
+            next(); // eat identifier
+            if (_curTokenType != ',') {
+                break;
+            }
+            next(); // eat ','
+        }
+        if (typeParameters.empty() || _curTokenType != '>') {
+            return Error("Expected type parameters and '>'.");
+        }
+        next(); // eat '>'
+    }
+
     if (_curTokenType != '(') {
         return Error("Expected '('.");
     }
@@ -783,7 +1015,9 @@ PrototypeAst *Parser::parsePrototype() {
         return Error("Expected function return type.");
     }
 
-    return new PrototypeAst(functionIdentifier, returnType, args, false, _curToken->Line(), _curToken->Column());
+    PrototypeAst *proto = new PrototypeAst(functionIdentifier, returnType, args, false, _curToken->Line(), _curToken->Column());
+    proto->setTypeParameters(typeParameters);
+    return proto;
 }
 
 // <extern>          ::= 'extern' 'func' id '(' (id ':')? <type> (',' (id ':')? <type>)* (',' '...')? ')' ':' <type>
@@ -801,7 +1035,7 @@ PrototypeAst *Parser::parseExternDeclaration() {
     if (_curTokenType != tok_identifier) {
         return Error("Expected function identifier in external declaration.");
     }
-    std::string functionIdentifier = _curToken->Value();
+    NameTable::NameId functionIdentifier = _curToken->Name();
     next(); // eat identifier
 
     if (_curTokenType != '(') {
@@ -858,15 +1092,21 @@ PrototypeAst *Parser::parseExternDeclaration() {
         return Error("Expected function return type.");
     }
 
-    return new PrototypeAst(functionIdentifier, returnType, args, isVarArgs, _curToken->Line(), _curToken->Column());
+    PrototypeAst *declaration = new PrototypeAst(functionIdentifier, returnType, args, isVarArgs, _curToken->Line(), _curToken->Column());
+    declaration->setIsExtern(true);
+    return declaration;
 }
 
+// <classdef>          ::= 'class' identifier ( 'packed' | 'ordered' )? '{' <member>* '}'
+// <member>             ::= ( 'public' | 'private' )? <varexpr>
+//                      |   ( 'public' | 'private' )? 'virtual'? <funcdef>
 ClassAst *Parser::parseClassDefinition() {
     if (_curTokenType != tok_class) {
         return Error("Expected 'class'.");
     }
     next(); // eat 'class'
     ClassAst *classAst = new ClassAst();
+    classAst->setPos(PossiblePosition{ _curToken->Line(), _curToken->Column() });
 
     if (_curTokenType != tok_identifier) {
         delete classAst;
@@ -875,6 +1115,20 @@ ClassAst *Parser::parseClassDefinition() {
     classAst->setName(_curToken->Value());
     next(); // eat identifier
 
+    if (_curTokenType == tok_identifier) { // layout attributes aren't reserved words, they only mean something here.
+        if (_curToken->Value() == "packed") {
+            classAst->setIsPacked(true);
+        }
+        else if (_curToken->Value() == "ordered") {
+            classAst->setIsOrdered(true);
+        }
+        else {
+            delete classAst;
+            return Error("Unknown class attribute '%s', expected 'packed' or 'ordered'.", _curToken->Value().c_str());
+        }
+        next(); // eat attribute
+    }
+
     if (_curTokenType != '{') {
         delete classAst;
         return Error("Expected '{'.");
@@ -886,17 +1140,27 @@ ClassAst *Parser::parseClassDefinition() {
         if (_curTokenType == tok_private || isPublic) {
             next(); // eat 'public' or 'private'
         }
+        Token *following = peek(0);
+        bool isVirtual = _curTokenType == tok_identifier && _curToken->Value() == "virtual" && following != nullptr && following->Type() == tok_func;
+        if (isVirtual) {
+            next(); // eat 'virtual'
+        }
         if (_curTokenType == tok_func) { // Member function
             FunctionAst *func = parseFunctionDefinition();
+            if (func == nullptr) {
+                delete classAst;
+                return nullptr;
+            }
+            func->getPrototype()->BindToClass(classAst->getName());
             if (isPublic) { 
-                classAst->pushPublicFunction(func);
+                classAst->pushPublicFunction(func, isVirtual);
             }
             else { // Assume that the default member type is 'private' even when not stated.
-                classAst->pushPrivateFunction(func);
+                classAst->pushPrivateFunction(func, isVirtual);
             }
         }
         else if (_curTokenType == tok_var) { // Member field
-            AstVarExpr *varExpr = dynamic_cast<AstVarExpr*>(parseVarExpression());
+            AstVarExpr *varExpr = AstCast<AstVarExpr>(parseVarExpression());
             if (_curTokenType == ';') { next(); }
             if (isPublic) {
                 classAst->pushPublicField(varExpr);
@@ -954,7 +1218,7 @@ ClassAst *Parser::parseClassDefinition() {
                 functionBody.push_back(blockExpr);
             }
             next(); // eat '}'
-            PrototypeAst *proto = new PrototypeAst(classAst->getName(), nullptr, args, false, _curToken->Line(), _curToken->Column());
+            PrototypeAst *proto = new PrototypeAst(NameTable::Intern(classAst->getName()), nullptr, args, false, _curToken->Line(), _curToken->Column());
             FunctionAst *ctor = new FunctionAst(proto, functionBody, _curToken->Line(), _curToken->Column());
             classAst->setConstructor(ctor);
         }
@@ -0,0 +1,163 @@
+#include "Runtime/DemiurgeFile.h"
+#include "Runtime/DemiurgeMemory.h"
+#include "Runtime/DemiurgeString.h"
+
+#include <fcntl.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+    // How much more is read at a time from files that can't be mapped.
+    const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+    struct File {
+        DemiStringOwner Owner; // the handle's reference, lines and mapped contents hold their own.
+        char *Data;
+        uint64_t Size;
+        uint64_t Offset; // of the next line.
+        bool IsMapped;   // otherwise 'Data' is malloc'd.
+    };
+
+    // Opens a string's path, returns -1 on failure.
+    int openPath(const DemiString *path) {
+        DemiString copy = DemiString();
+        int fd = open(demi_string_cstr(path, &copy), O_RDONLY);
+        demi_string_release(&copy);
+        return fd;
+    }
+
+    // Fills in the contents of an open file, returns false on failure.
+    bool readContents(int fd, File *file) {
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            return false;
+        }
+        if (S_ISREG(info.st_mode)) {
+            file->Size = info.st_size;
+            if (file->Size == 0) { // nothing to map.
+                file->Data = nullptr;
+                file->IsMapped = false;
+                return true;
+            }
+            void *memory = mmap(nullptr, file->Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory != MAP_FAILED) {
+                madvise(memory, file->Size, MADV_SEQUENTIAL);
+                file->Data = static_cast<char*>(memory);
+                file->IsMapped = true;
+                return true;
+            }
+        }
+        size_t capacity = READ_CHUNK_SIZE;
+        char *data = static_cast<char*>(demi_alloc(capacity));
+        size_t size = 0;
+        for (;;) {
+            if (size == capacity) {
+                capacity *= 2;
+                char *grown = static_cast<char*>(realloc(data, capacity));
+                if (grown == nullptr) {
+                    fprintf(stderr, "Out of memory reading %llu bytes of a file.\n", (unsigned long long)capacity);
+                    abort();
+                }
+                data = grown;
+            }
+            ssize_t count = read(fd, data + size, capacity - size);
+            if (count < 0) {
+                free(data);
+                return false;
+            }
+            if (count == 0) {
+                break;
+            }
+            size += count;
+        }
+        file->Data = data;
+        file->Size = size;
+        file->IsMapped = false;
+        return true;
+    }
+
+    // Unmaps or frees a file's contents once neither its handle nor a view of them is left.
+    void destroyFile(DemiStringOwner *owner) {
+        File *file = reinterpret_cast<File*>(owner);
+        if (file->IsMapped) {
+            munmap(file->Data, file->Size);
+        }
+        else {
+            free(file->Data);
+        }
+        file->Owner.RefCount.~atomic();
+        free(file);
+    }
+
+}
+
+extern "C" {
+
+    void *demi_file_open(const DemiString *path) {
+        int fd = openPath(path);
+        if (fd < 0) {
+            return nullptr;
+        }
+        File *file = static_cast<File*>(demi_alloc(sizeof(File)));
+        file->Offset = 0;
+        bool success = readContents(fd, file);
+        close(fd); // a mapping stays valid without the descriptor.
+        if (!success) {
+            free(file);
+            return nullptr;
+        }
+        new (&file->Owner.RefCount) std::atomic<uint64_t>(1);
+        file->Owner.Destroy = destroyFile;
+        return file;
+    }
+
+    void demi_file_read_line(void *handle, DemiString *line) {
+        File *file = static_cast<File*>(handle);
+        if (file == nullptr) {
+            *line = DemiString();
+            return;
+        }
+        const char *start = file->Data + file->Offset;
+        uint64_t remaining = file->Size - file->Offset;
+        if (remaining == 0) {
+            *line = DemiString();
+            return;
+        }
+        const char *newline = static_cast<const char*>(memchr(start, '\n', remaining));
+        uint64_t length = newline != nullptr ? newline - start : remaining;
+        file->Offset += newline != nullptr ? length + 1 : length;
+        if (length != 0 && start[length - 1] == '\r') {
+            length--;
+        }
+        demi_string_view(line, &file->Owner, start, length);
+    }
+
+    bool demi_file_eof(void *handle) {
+        File *file = static_cast<File*>(handle);
+        return file == nullptr || file->Offset == file->Size;
+    }
+
+    void demi_file_close(void *handle) {
+        File *file = static_cast<File*>(handle);
+        if (file != nullptr) { // the contents go with the last line read from them.
+            demi_string_owner_release(&file->Owner);
+        }
+    }
+
+    void demi_file_map(DemiString *result, const DemiString *path) {
+        File *file = static_cast<File*>(demi_file_open(path));
+        if (file == nullptr) {
+            *result = DemiString();
+            return;
+        }
+        demi_string_view(result, &file->Owner, file->Data, file->Size);
+        demi_string_owner_release(&file->Owner); // the contents go with the string.
+    }
+
+}
@@ -0,0 +1,358 @@
+#include "Runtime/DemiurgeGC.h"
+#include "Runtime/DemiurgeScheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+    const uint64_t BLOCK_SIZE = 1 << 20;
+    const uint64_t GRANULE = 16;
+    const uint64_t GRANULES_PER_BLOCK = BLOCK_SIZE / GRANULE;
+    // Objects bigger than this get a block of their own.
+    const uint64_t LARGE_OBJECT_SIZE = BLOCK_SIZE / 8;
+    // Bytes allocated before the first collection, afterwards twice what survived the last one.
+    const uint64_t INITIAL_THRESHOLD = 8 * BLOCK_SIZE;
+    // Empty blocks kept for reuse rather than freed.
+    const size_t MAX_FREE_BLOCKS = 32;
+    // Heaps with fewer blocks than this are marked by a single thread.
+    const size_t PARALLEL_MARK_BLOCKS = 8;
+    const unsigned MAX_MARKERS = 8;
+    // A marker with more work than this shares half of it.
+    const size_t SHARE_THRESHOLD = 256;
+
+    struct alignas(16) ObjectHeader {
+        const DemiTypeInfo *Type;
+        uint64_t Count;
+        uint64_t Size; // including the header, a multiple of GRANULE.
+        std::atomic<uint64_t> Mark;
+    };
+
+    inline char *payloadOf(ObjectHeader *header) {
+        return reinterpret_cast<char*>(header + 1);
+    }
+
+    struct Block {
+        char *Start;
+        char *Cursor; // objects are in [Start, Cursor).
+        char *End;
+        bool IsLarge;
+        uint64_t Starts[GRANULES_PER_BLOCK / 64]; // a bit per granule where an object starts, unused by large blocks.
+
+        void setStart(char *p, bool isStart) {
+            uint64_t granule = (p - Start) / GRANULE;
+            if (isStart) {
+                Starts[granule / 64] |= uint64_t(1) << (granule % 64);
+            }
+            else {
+                Starts[granule / 64] &= ~(uint64_t(1) << (granule % 64));
+            }
+        }
+        // Returns the object starting at or before 'p', or nullptr if there is none.
+        ObjectHeader *objectBefore(char *p) const {
+            uint64_t granule = (p - Start) / GRANULE;
+            int64_t word = granule / 64;
+            uint64_t bits = Starts[word] & (~uint64_t(0) >> (63 - granule % 64));
+            while (bits == 0) {
+                if (--word < 0) {
+                    return nullptr;
+                }
+                bits = Starts[word];
+            }
+            uint64_t found = word * 64 + (63 - __builtin_clzll(bits));
+            return reinterpret_cast<ObjectHeader*>(Start + found * GRANULE);
+        }
+    };
+
+    thread_local DemiGCFrame *frameChain = nullptr;
+
+    class Heap {
+        std::mutex _lock;
+        std::map<uintptr_t, Block*> _blocks; // by start address, for finding the object a pointer points into.
+        std::vector<Block*> _freeBlocks;
+        Block *_nursery;
+        uint64_t _allocatedSinceCollect;
+        uint64_t _threshold;
+
+        Block *newBlock(uint64_t size, bool isLarge);
+        void releaseBlock(Block *block);
+        void collectLocked();
+        void mark(std::vector<ObjectHeader*> &roots);
+        uint64_t sweep();
+    public:
+        Heap()
+            : _nursery(nullptr)
+            , _allocatedSinceCollect(0)
+            , _threshold(INITIAL_THRESHOLD) {
+        }
+        void *allocate(const DemiTypeInfo *type, uint64_t count);
+        void collect();
+        // Returns the object 'p' points into, or nullptr if it doesn't point into the heap.
+        ObjectHeader *findObject(void *p) const;
+        // Marks every unmarked object pointed to by the pointers in 'count' elements of a type and queues them.
+        void scan(char *base, const DemiTypeInfo *type, uint64_t count, std::vector<ObjectHeader*> &work) const;
+    };
+
+    Heap &getHeap() {
+        static Heap *heap = new Heap(); // never destroyed, objects may be used by other static destructors.
+        return *heap;
+    }
+
+    void *checkedMalloc(uint64_t size) {
+        void *memory = malloc(size);
+        if (memory == nullptr) {
+            fprintf(stderr, "Out of memory allocating %llu bytes.\n", (unsigned long long)size);
+            abort();
+        }
+        return memory;
+    }
+
+    Block *Heap::newBlock(uint64_t size, bool isLarge) {
+        Block *block;
+        if (!isLarge && !_freeBlocks.empty()) {
+            block = _freeBlocks.back();
+            _freeBlocks.pop_back();
+        }
+        else {
+            block = static_cast<Block*>(checkedMalloc(sizeof(Block)));
+            void *memory = nullptr;
+            if (posix_memalign(&memory, GRANULE, size) != 0) {
+                fprintf(stderr, "Out of memory allocating %llu bytes.\n", (unsigned long long)size);
+                abort();
+            }
+            block->Start = static_cast<char*>(memory);
+            block->End = block->Start + size;
+            block->IsLarge = isLarge;
+        }
+        block->Cursor = block->Start;
+        if (!isLarge) {
+            memset(block->Starts, 0, sizeof(block->Starts));
+        }
+        _blocks[reinterpret_cast<uintptr_t>(block->Start)] = block;
+        return block;
+    }
+
+    void Heap::releaseBlock(Block *block) {
+        _blocks.erase(reinterpret_cast<uintptr_t>(block->Start));
+        if (!block->IsLarge && _freeBlocks.size() < MAX_FREE_BLOCKS) {
+            _freeBlocks.push_back(block);
+            return;
+        }
+        free(block->Start);
+        free(block);
+    }
+
+    void *Heap::allocate(const DemiTypeInfo *type, uint64_t count) {
+        uint64_t payload = type->Size * count;
+        if (count != 0 && payload / count != type->Size) {
+            fprintf(stderr, "Allocation of %llu elements of %llu bytes overflows.\n", (unsigned long long)count, (unsigned long long)type->Size);
+            abort();
+        }
+        uint64_t size = (sizeof(ObjectHeader) + payload + GRANULE - 1) & ~(GRANULE - 1);
+
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_allocatedSinceCollect >= _threshold && demi_task_live() == 0) {
+            collectLocked();
+        }
+        _allocatedSinceCollect += size;
+        ObjectHeader *header;
+        if (size > LARGE_OBJECT_SIZE) {
+            Block *block = newBlock(size, true);
+            header = reinterpret_cast<ObjectHeader*>(block->Start);
+            block->Cursor = block->End;
+        }
+        else {
+            if (_nursery == nullptr || uint64_t(_nursery->End - _nursery->Cursor) < size) {
+                _nursery = newBlock(BLOCK_SIZE, false);
+            }
+            header = reinterpret_cast<ObjectHeader*>(_nursery->Cursor);
+            _nursery->setStart(_nursery->Cursor, true);
+            _nursery->Cursor += size;
+        }
+        header->Type = type;
+        header->Count = count;
+        header->Size = size;
+        header->Mark.store(0, std::memory_order_relaxed);
+        memset(payloadOf(header), 0, size - sizeof(ObjectHeader));
+        return payloadOf(header);
+    }
+
+    void Heap::collect() {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (demi_task_live() == 0) {
+            collectLocked();
+        }
+    }
+
+    ObjectHeader *Heap::findObject(void *p) const {
+        char *address = static_cast<char*>(p);
+        auto found = _blocks.upper_bound(reinterpret_cast<uintptr_t>(address));
+        if (found == _blocks.begin()) {
+            return nullptr;
+        }
+        Block *block = (--found)->second;
+        if (address >= block->Cursor) {
+            return nullptr;
+        }
+        ObjectHeader *header = block->IsLarge ? reinterpret_cast<ObjectHeader*>(block->Start) : block->objectBefore(address);
+        if (header == nullptr || address >= reinterpret_cast<char*>(header) + header->Size) {
+            return nullptr;
+        }
+        return header;
+    }
+
+    void Heap::scan(char *base, const DemiTypeInfo *type, uint64_t count, std::vector<ObjectHeader*> &work) const {
+        if (type == nullptr || type->PointerCount == 0) {
+            return;
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            char *element = base + i * type->Size;
+            for (uint64_t j = 0; j < type->PointerCount; ++j) {
+                void *p = *reinterpret_cast<void**>(element + type->Offsets[j]);
+                ObjectHeader *header = p != nullptr ? findObject(p) : nullptr;
+                if (header != nullptr && header->Mark.exchange(1, std::memory_order_relaxed) == 0) {
+                    work.push_back(header);
+                }
+            }
+        }
+    }
+
+    // Work shared between the marking threads.
+    struct MarkShared {
+        std::mutex Lock;
+        std::condition_variable HasWork;
+        std::vector<ObjectHeader*> Pool;
+        unsigned Markers;
+        unsigned Idle;
+        bool Done;
+    };
+
+    void markerLoop(const Heap &heap, MarkShared &shared) {
+        std::vector<ObjectHeader*> work;
+        while (true) {
+            while (!work.empty()) {
+                ObjectHeader *header = work.back();
+                work.pop_back();
+                heap.scan(payloadOf(header), header->Type, header->Count, work);
+                if (work.size() > SHARE_THRESHOLD) { // let idle markers help.
+                    std::lock_guard<std::mutex> guard(shared.Lock);
+                    shared.Pool.insert(shared.Pool.end(), work.begin() + work.size() / 2, work.end());
+                    work.resize(work.size() / 2);
+                    shared.HasWork.notify_all();
+                }
+            }
+            std::unique_lock<std::mutex> lock(shared.Lock);
+            if (shared.Pool.empty()) {
+                if (++shared.Idle == shared.Markers) { // everyone is out of work, marking is done.
+                    shared.Done = true;
+                    shared.HasWork.notify_all();
+                    return;
+                }
+                shared.HasWork.wait(lock, [&] { return !shared.Pool.empty() || shared.Done; });
+                if (shared.Done) {
+                    return;
+                }
+                --shared.Idle;
+            }
+            size_t take = std::min(shared.Pool.size(), SHARE_THRESHOLD / 2);
+            work.assign(shared.Pool.end() - take, shared.Pool.end());
+            shared.Pool.resize(shared.Pool.size() - take);
+        }
+    }
+
+    void Heap::mark(std::vector<ObjectHeader*> &roots) {
+        unsigned markers = 1;
+        if (_blocks.size() >= PARALLEL_MARK_BLOCKS) {
+            markers = std::max(1u, std::min(MAX_MARKERS, std::thread::hardware_concurrency()));
+        }
+        MarkShared shared;
+        shared.Pool.swap(roots);
+        shared.Markers = markers;
+        shared.Idle = 0;
+        shared.Done = false;
+        std::vector<std::thread> helpers;
+        for (unsigned i = 1; i < markers; ++i) {
+            helpers.push_back(std::thread(markerLoop, std::cref(*this), std::ref(shared)));
+        }
+        markerLoop(*this, shared);
+        for (auto helper = helpers.begin(); helper != helpers.end(); ++helper) {
+            helper->join();
+        }
+    }
+
+    // Frees dead objects by clearing their start bit, releases blocks with nothing live in them and clears the
+    // marks of the survivors. Returns the bytes which survived.
+    uint64_t Heap::sweep() {
+        uint64_t survived = 0;
+        std::vector<Block*> empty;
+        for (auto found = _blocks.begin(); found != _blocks.end(); ++found) {
+            Block *block = found->second;
+            uint64_t live = 0;
+            char *p = block->Start;
+            while (p < block->Cursor) {
+                ObjectHeader *header = reinterpret_cast<ObjectHeader*>(p);
+                if (header->Mark.load(std::memory_order_relaxed) != 0) {
+                    header->Mark.store(0, std::memory_order_relaxed);
+                    live += header->Size;
+                }
+                else if (!block->IsLarge) { // dead, stale pointers into it must not find it.
+                    block->setStart(p, false);
+                }
+                p += header->Size;
+            }
+            if (live == 0) {
+                empty.push_back(block);
+            }
+            survived += live;
+        }
+        for (auto block = empty.begin(); block != empty.end(); ++block) {
+            releaseBlock(*block);
+        }
+        return survived;
+    }
+
+    void Heap::collectLocked() {
+        std::vector<ObjectHeader*> roots;
+        for (DemiGCFrame *frame = frameChain; frame != nullptr; frame = frame->Prev) {
+            const DemiGCFrameMap *map = frame->Map;
+            for (uint64_t i = 0; i < map->RootCount; ++i) {
+                scan(reinterpret_cast<char*>(frame) + map->Roots[i].Offset, map->Roots[i].Type, 1, roots);
+            }
+        }
+        mark(roots);
+        _nursery = nullptr; // survivors stay where they are, new objects go to an empty block.
+        uint64_t survived = sweep();
+        _threshold = std::max(INITIAL_THRESHOLD, 2 * survived);
+        _allocatedSinceCollect = 0;
+    }
+
+}
+
+extern "C" {
+
+    void *demi_gc_alloc(const DemiTypeInfo *type, uint64_t count) {
+        return getHeap().allocate(type, count);
+    }
+
+    void demi_gc_push_frame(DemiGCFrame *frame) {
+        frame->Prev = frameChain;
+        frameChain = frame;
+    }
+
+    void demi_gc_pop_frame(DemiGCFrame *frame) {
+        frameChain = frame->Prev;
+    }
+
+    void demi_gc_collect() {
+        getHeap().collect();
+    }
+
+}
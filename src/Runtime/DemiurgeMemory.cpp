@@ -0,0 +1,129 @@
+#include "Runtime/DemiurgeMemory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+    // Size of an arena's chunks, allocations bigger than a quarter of it get a chunk of their own.
+    const uint64_t CHUNK_SIZE = 64 * 1024;
+    const uint64_t ALIGNMENT = 16;
+    // Default sized chunks kept per thread for the next arena instead of being freed.
+    const unsigned MAX_CACHED_CHUNKS = 16;
+
+    struct alignas(16) Chunk {
+        Chunk *Next;
+        uint64_t Size; // usable bytes after the header.
+    };
+
+    struct Arena {
+        Chunk *Chunks; // the chunk being bumped into is first.
+        char *Cursor;
+        char *Limit;
+    };
+
+    struct ChunkCache {
+        Chunk *Free;
+        unsigned Count;
+
+        ~ChunkCache() {
+            while (Free != nullptr) {
+                Chunk *next = Free->Next;
+                free(Free);
+                Free = next;
+            }
+        }
+    };
+    thread_local ChunkCache chunkCache;
+
+    void *checkedMalloc(uint64_t size) {
+        void *memory = malloc(size);
+        if (memory == nullptr) {
+            fprintf(stderr, "Out of memory allocating %llu bytes.\n", (unsigned long long)size);
+            abort();
+        }
+        return memory;
+    }
+
+    Chunk *newChunk(uint64_t size) {
+        if (size == CHUNK_SIZE && chunkCache.Free != nullptr) {
+            Chunk *chunk = chunkCache.Free;
+            chunkCache.Free = chunk->Next;
+            chunkCache.Count--;
+            return chunk;
+        }
+        Chunk *chunk = static_cast<Chunk*>(checkedMalloc(sizeof(Chunk) + size));
+        chunk->Size = size;
+        return chunk;
+    }
+
+    void freeChunk(Chunk *chunk) {
+        if (chunk->Size == CHUNK_SIZE && chunkCache.Count < MAX_CACHED_CHUNKS) {
+            chunk->Next = chunkCache.Free;
+            chunkCache.Free = chunk;
+            chunkCache.Count++;
+            return;
+        }
+        free(chunk);
+    }
+
+    inline char *chunkData(Chunk *chunk) {
+        return reinterpret_cast<char*>(chunk + 1);
+    }
+
+}
+
+extern "C" {
+
+    void *demi_alloc(uint64_t size) {
+        return checkedMalloc(size == 0 ? 1 : size);
+    }
+
+    void *demi_arena_create() {
+        Arena *arena = static_cast<Arena*>(checkedMalloc(sizeof(Arena)));
+        arena->Chunks = nullptr;
+        arena->Cursor = nullptr;
+        arena->Limit = nullptr;
+        return arena;
+    }
+
+    void *demi_arena_alloc(void *handle, uint64_t size) {
+        Arena *arena = static_cast<Arena*>(handle);
+        size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        if (size <= uint64_t(arena->Limit - arena->Cursor)) { // fast path, bump the cursor.
+            void *memory = arena->Cursor;
+            arena->Cursor += size;
+            return memory;
+        }
+        if (size > CHUNK_SIZE / 4) { // big allocations get their own chunk behind the current one.
+            Chunk *chunk = newChunk(size);
+            if (arena->Chunks == nullptr) {
+                chunk->Next = nullptr;
+                arena->Chunks = chunk;
+            }
+            else {
+                chunk->Next = arena->Chunks->Next;
+                arena->Chunks->Next = chunk;
+            }
+            return chunkData(chunk);
+        }
+        Chunk *chunk = newChunk(CHUNK_SIZE);
+        chunk->Next = arena->Chunks;
+        arena->Chunks = chunk;
+        arena->Cursor = chunkData(chunk) + size;
+        arena->Limit = chunkData(chunk) + CHUNK_SIZE;
+        return chunkData(chunk);
+    }
+
+    void demi_arena_destroy(void *handle) {
+        Arena *arena = static_cast<Arena*>(handle);
+        Chunk *chunk = arena->Chunks;
+        while (chunk != nullptr) {
+            Chunk *next = chunk->Next;
+            freeChunk(chunk);
+            chunk = next;
+        }
+        free(arena);
+    }
+
+}
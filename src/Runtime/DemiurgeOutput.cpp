@@ -0,0 +1,221 @@
+#include "Runtime/DemiurgeOutput.h"
+#include "Runtime/DemiurgeString.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+    const size_t BUFFER_SIZE = 64 * 1024;
+    // "%f" of doubles at least this big is left to snprintf, below it the integer part fits a uint64_t.
+    const double MAX_FAST_DOUBLE = 1e15;
+    // The fixed point the fraction of a double is written from, times 10 it still fits a uint64_t.
+    const int FRACTION_BITS = 60;
+
+    const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    struct OutputBuffer {
+        char *Data; // allocated on the first write.
+        size_t Length;
+
+        ~OutputBuffer() {
+            flush();
+            free(Data);
+        }
+
+        void flush() {
+            if (Length != 0) {
+                fwrite(Data, 1, Length, stdout);
+                fflush(stdout);
+                Length = 0;
+            }
+        }
+
+        // Returns room for at least 'size' bytes, 'size' is at most BUFFER_SIZE.
+        char *reserve(size_t size) {
+            if (Data == nullptr) {
+                Data = static_cast<char*>(malloc(BUFFER_SIZE));
+                if (Data == nullptr) {
+                    fprintf(stderr, "Out of memory allocating the output buffer.\n");
+                    abort();
+                }
+            }
+            if (BUFFER_SIZE - Length < size) {
+                flush();
+            }
+            return Data + Length;
+        }
+
+        void write(const char *chars, size_t size) {
+            if (size > BUFFER_SIZE / 2) { // big writes go straight out.
+                flush();
+                fwrite(chars, 1, size, stdout);
+                fflush(stdout);
+                return;
+            }
+            memcpy(reserve(size), chars, size);
+            Length += size;
+        }
+
+        void put(char c) {
+            *reserve(1) = c;
+            Length++;
+        }
+    };
+    thread_local OutputBuffer outputBuffer;
+
+    // Writes the digits of 'x' ending right before 'end', returns where they start.
+    char *formatUnsigned(uint64_t x, char *end) {
+        while (x >= 100) {
+            unsigned pair = unsigned(x % 100) * 2;
+            x /= 100;
+            *--end = DIGIT_PAIRS[pair + 1];
+            *--end = DIGIT_PAIRS[pair];
+        }
+        if (x >= 10) {
+            unsigned pair = unsigned(x) * 2;
+            *--end = DIGIT_PAIRS[pair + 1];
+            *--end = DIGIT_PAIRS[pair];
+        }
+        else {
+            *--end = char('0' + x);
+        }
+        return end;
+    }
+
+    void writeUnsigned(uint64_t x) {
+        char digits[20];
+        char *end = digits + sizeof(digits);
+        char *start = formatUnsigned(x, end);
+        outputBuffer.write(start, end - start);
+    }
+
+    void writeDoubleSlow(double x) {
+        char chars[512];
+        int size = snprintf(chars, sizeof(chars), "%f", x);
+        outputBuffer.write(chars, size);
+    }
+
+    // Writes 'x' with six decimals like "%f" does, rounding its exact value to nearest, ties to even.
+    void writeDouble(double x) {
+        double magnitude = fabs(x);
+        if (!(magnitude < MAX_FAST_DOUBLE)) { // infinities, NaNs and huge values.
+            writeDoubleSlow(x);
+            return;
+        }
+        uint64_t integer = uint64_t(magnitude);
+        // The fraction is exact in 60 bits of fixed point unless it has bits below 2^-60, which only values under
+        // 2^-8 can have. Then the digits are taken one at a time without rounding in between.
+        double fixed = ldexp(magnitude - double(integer), FRACTION_BITS);
+        if (fixed != floor(fixed)) {
+            writeDoubleSlow(x);
+            return;
+        }
+        const uint64_t fractionMask = (uint64_t(1) << FRACTION_BITS) - 1;
+        uint64_t remainder = uint64_t(fixed);
+        uint64_t fraction = 0;
+        for (int i = 0; i < 6; ++i) {
+            remainder *= 10;
+            fraction = fraction * 10 + (remainder >> FRACTION_BITS);
+            remainder &= fractionMask;
+        }
+        const uint64_t half = uint64_t(1) << (FRACTION_BITS - 1);
+        if (remainder > half || (remainder == half && (fraction & 1) != 0)) {
+            fraction++;
+        }
+        if (fraction >= 1000000) { // rounded up into the integer part.
+            fraction -= 1000000;
+            integer++;
+        }
+        char chars[32];
+        char *end = chars + sizeof(chars);
+        for (int i = 0; i < 6; ++i) {
+            *--end = char('0' + fraction % 10);
+            fraction /= 10;
+        }
+        *--end = '.';
+        char *start = formatUnsigned(integer, end);
+        if (signbit(x)) {
+            *--start = '-';
+        }
+        outputBuffer.write(start, chars + sizeof(chars) - start);
+    }
+
+}
+
+extern "C" {
+
+    void demi_output_flush() {
+        outputBuffer.flush();
+    }
+
+    int demi_output_printf(const char *format, ...) {
+        char *room = outputBuffer.reserve(BUFFER_SIZE / 2);
+        size_t available = BUFFER_SIZE - outputBuffer.Length;
+        va_list args;
+        va_start(args, format);
+        int size = vsnprintf(room, available, format, args);
+        va_end(args);
+        if (size < 0) {
+            return size;
+        }
+        if (size_t(size) < available) {
+            outputBuffer.Length += size;
+            return size;
+        }
+        // Didn't fit, format it again into memory of its own.
+        char *chars = static_cast<char*>(malloc(size + 1));
+        if (chars == nullptr) {
+            fprintf(stderr, "Out of memory formatting %d chars of output.\n", size);
+            abort();
+        }
+        va_start(args, format);
+        vsnprintf(chars, size + 1, format, args);
+        va_end(args);
+        outputBuffer.write(chars, size);
+        free(chars);
+        return size;
+    }
+
+    int print(const DemiString *string) {
+        uint64_t length = demi_string_length(string);
+        outputBuffer.write(demi_string_data(string), length);
+        return int(length);
+    }
+
+    int println(const DemiString *string) {
+        uint64_t length = demi_string_length(string);
+        outputBuffer.write(demi_string_data(string), length);
+        outputBuffer.put('\n');
+        return int(length);
+    }
+
+    double printd(double x) {
+        writeDouble(x);
+        return x;
+    }
+
+    uint64_t printi(uint64_t x) {
+        writeUnsigned(x);
+        return x;
+    }
+
+    uint64_t printc(uint64_t x) {
+        outputBuffer.put(char(x));
+        return x;
+    }
+
+}
@@ -0,0 +1,345 @@
+#include "Runtime/DemiurgeScheduler.h"
+#include "Runtime/DemiurgeOutput.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+
+namespace {
+
+    // Payloads at most this big are recycled through a per-thread free list instead of malloc'd.
+    const uint64_t SMALL_TASK_SIZE = 128;
+    // Failed steal rounds before an idle worker goes to sleep.
+    const unsigned STEAL_ROUNDS_BEFORE_SLEEP = 64;
+
+    // Tasks allocated and not yet freed.
+    std::atomic<uint64_t> liveTasks(0);
+
+    struct alignas(16) Task {
+        demi_task_fn Fn;
+        std::atomic<uint32_t> Done;
+        uint32_t IsSmall;
+        Task *NextFree;
+    };
+
+    inline Task *taskFromPayload(void *payload) {
+        return reinterpret_cast<Task*>(payload) - 1;
+    }
+    inline void *payloadFromTask(Task *task) {
+        return task + 1;
+    }
+
+    // Circular array backing a deque, grown by copying into a new array twice the size.
+    struct TaskArray {
+        int64_t Size;
+        std::atomic<Task*> *Buffer;
+
+        explicit TaskArray(int64_t size)
+            : Size(size)
+            , Buffer(new std::atomic<Task*>[size]) {
+        }
+        ~TaskArray() {
+            delete[] Buffer;
+        }
+        Task *get(int64_t i) const {
+            return Buffer[i & (Size - 1)].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, Task *task) {
+            Buffer[i & (Size - 1)].store(task, std::memory_order_relaxed);
+        }
+        TaskArray *grow(int64_t bottom, int64_t top) const {
+            TaskArray *bigger = new TaskArray(Size * 2);
+            for (int64_t i = top; i < bottom; ++i) {
+                bigger->put(i, get(i));
+            }
+            return bigger;
+        }
+    };
+
+    // Chase-Lev work-stealing deque, see "Correct and Efficient Work-Stealing for Weak Memory
+    // Models" (Le et al.). The owner pushes and takes at the bottom, thieves steal from the top.
+    class TaskDeque {
+        std::atomic<int64_t> _top;
+        char _padding[64]; // keeps the thieves' and the owner's index on separate cache lines.
+        std::atomic<int64_t> _bottom;
+        std::atomic<TaskArray*> _array;
+        // Arrays replaced by a grow, thieves may still be reading them so they live until exit.
+        std::vector<TaskArray*> _retired;
+    public:
+        TaskDeque()
+            : _top(0)
+            , _bottom(0)
+            , _array(new TaskArray(256)) {
+        }
+        ~TaskDeque() {
+            delete _array.load(std::memory_order_relaxed);
+            while (!_retired.empty()) delete _retired.back(), _retired.pop_back();
+        }
+
+        // Owner only.
+        void push(Task *task) {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            TaskArray *a = _array.load(std::memory_order_relaxed);
+            if (b - t > a->Size - 1) {
+                _retired.push_back(a);
+                a = a->grow(b, t);
+                _array.store(a, std::memory_order_relaxed);
+            }
+            a->put(b, task);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only.
+        Task *take() {
+            int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+            TaskArray *a = _array.load(std::memory_order_relaxed);
+            _bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            if (t > b) { // empty
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            Task *task = a->get(b);
+            if (t == b) { // last task, race the thieves for it.
+                if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    task = nullptr;
+                }
+                _bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        // Any thread.
+        Task *steal() {
+            int64_t t = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = _bottom.load(std::memory_order_acquire);
+            if (t >= b) {
+                return nullptr;
+            }
+            TaskArray *a = _array.load(std::memory_order_acquire);
+            Task *task = a->get(t);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return nullptr; // lost the race to another thief or the owner.
+            }
+            return task;
+        }
+    };
+
+    class Scheduler {
+        std::vector<TaskDeque*> _deques;
+        std::atomic<bool> _externalClaimed;
+        std::atomic<unsigned> _sleepers;
+        std::mutex _sleepMutex;
+        std::condition_variable _sleepCond;
+    public:
+        Scheduler();
+        unsigned workerCount() const { return _deques.size(); }
+        TaskDeque *deque(unsigned i) { return _deques[i]; }
+        bool claimExternalSlot() { return !_externalClaimed.exchange(true); }
+        void wakeOne();
+        void sleep();
+        void workerLoop(unsigned index);
+    };
+
+    struct ThreadState {
+        int WorkerIndex;
+        uint32_t Rng;
+        Task *FreeList;
+        ThreadState()
+            : WorkerIndex(-1)
+            , Rng(0)
+            , FreeList(nullptr) {
+        }
+    };
+    thread_local ThreadState threadState;
+
+    Scheduler &getScheduler() {
+        static Scheduler *scheduler = new Scheduler(); // never destroyed, workers outlive main.
+        return *scheduler;
+    }
+
+    inline uint32_t nextRandom() {
+        uint32_t x = threadState.Rng;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return threadState.Rng = x;
+    }
+
+    inline void runTask(Task *task) {
+        task->Fn(payloadFromTask(task));
+        demi_output_flush(); // the task's output comes before anything printed after awaiting it.
+        task->Done.store(1, std::memory_order_release);
+    }
+
+    // Returns a task stolen from a random victim other than 'self', or nullptr.
+    Task *stealAny(Scheduler &sched, unsigned self) {
+        unsigned n = sched.workerCount();
+        if (n < 2) {
+            return nullptr;
+        }
+        unsigned start = nextRandom() % n;
+        for (unsigned i = 0; i < n; ++i) {
+            unsigned victim = (start + i) % n;
+            if (victim == self) {
+                continue;
+            }
+            if (Task *task = sched.deque(victim)->steal()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    Scheduler::Scheduler()
+        : _externalClaimed(false)
+        , _sleepers(0) {
+        unsigned n = std::thread::hardware_concurrency();
+        if (const char *env = getenv("DEMI_WORKERS")) {
+            int requested = atoi(env);
+            if (requested > 0) {
+                n = requested;
+            }
+        }
+        if (n == 0) {
+            n = 1;
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            _deques.push_back(new TaskDeque());
+        }
+        // Slot 0 is left for the first external thread to use the runtime.
+        for (unsigned i = 1; i < n; ++i) {
+            std::thread(&Scheduler::workerLoop, this, i).detach();
+        }
+    }
+
+    void Scheduler::wakeOne() {
+        if (_sleepers.load(std::memory_order_relaxed) != 0) {
+            _sleepCond.notify_one();
+        }
+    }
+
+    void Scheduler::sleep() {
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _sleepers.fetch_add(1, std::memory_order_relaxed);
+        // Timed so that a wake racing with going to sleep only costs a millisecond.
+        _sleepCond.wait_for(lock, std::chrono::milliseconds(1));
+        _sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void Scheduler::workerLoop(unsigned index) {
+        threadState.WorkerIndex = index;
+        threadState.Rng = 0x9E3779B9u * (index + 1);
+        unsigned failedRounds = 0;
+        while (true) {
+            Task *task = _deques[index]->take();
+            if (task == nullptr) {
+                task = stealAny(*this, index);
+            }
+            if (task != nullptr) {
+                failedRounds = 0;
+                runTask(task);
+                continue;
+            }
+            if (++failedRounds < STEAL_ROUNDS_BEFORE_SLEEP) {
+                std::this_thread::yield();
+            }
+            else {
+                sleep();
+            }
+        }
+    }
+
+    // Returns this thread's worker index, or -1 if it may not push tasks.
+    int currentWorker(Scheduler &sched) {
+        if (threadState.WorkerIndex == -1 && sched.claimExternalSlot()) {
+            threadState.WorkerIndex = 0;
+            threadState.Rng = 0x9E3779B9u;
+        }
+        return threadState.WorkerIndex;
+    }
+
+}
+
+extern "C" {
+
+    void *demi_task_alloc(demi_task_fn fn, uint64_t payloadSize) {
+        Task *task;
+        bool isSmall = payloadSize <= SMALL_TASK_SIZE;
+        if (isSmall && threadState.FreeList != nullptr) {
+            task = threadState.FreeList;
+            threadState.FreeList = task->NextFree;
+        }
+        else {
+            task = static_cast<Task*>(malloc(sizeof(Task) + (isSmall ? SMALL_TASK_SIZE : payloadSize)));
+        }
+        task->Fn = fn;
+        task->Done.store(0, std::memory_order_relaxed);
+        task->IsSmall = isSmall;
+        task->NextFree = nullptr;
+        liveTasks.fetch_add(1, std::memory_order_relaxed);
+        return payloadFromTask(task);
+    }
+
+    void demi_task_spawn(void *payload) {
+        Task *task = taskFromPayload(payload);
+        // Another worker may run the task and flush its output at once, what this thread printed before the
+        // spawn has to be out first.
+        demi_output_flush();
+        Scheduler &sched = getScheduler();
+        int worker = currentWorker(sched);
+        if (worker == -1) { // a foreign thread, it has no deque so the task runs right away.
+            runTask(task);
+            return;
+        }
+        sched.deque(worker)->push(task);
+        sched.wakeOne();
+    }
+
+    void demi_task_await(void *payload) {
+        Task *task = taskFromPayload(payload);
+        if (task->Done.load(std::memory_order_acquire)) {
+            return;
+        }
+        Scheduler &sched = getScheduler();
+        int worker = currentWorker(sched);
+        // Rather than blocking, keep this thread busy until the task has been run: first with our
+        // own most recent tasks (usually the awaited task itself), then with stolen ones.
+        while (!task->Done.load(std::memory_order_acquire)) {
+            Task *other = worker == -1 ? nullptr : sched.deque(worker)->take();
+            if (other == nullptr) {
+                other = stealAny(sched, worker);
+            }
+            if (other != nullptr) {
+                runTask(other);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void demi_task_free(void *payload) {
+        Task *task = taskFromPayload(payload);
+        liveTasks.fetch_sub(1, std::memory_order_release);
+        if (task->IsSmall) {
+            task->NextFree = threadState.FreeList;
+            threadState.FreeList = task;
+        }
+        else {
+            free(task);
+        }
+    }
+
+    uint64_t demi_task_live() {
+        return liveTasks.load(std::memory_order_acquire);
+    }
+
+}
@@ -0,0 +1,213 @@
+#include "Runtime/DemiurgeString.h"
+#include "Runtime/DemiurgeMemory.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+    // Chars an inline string holds, the last two bytes are the NUL and the length.
+    const uint64_t INLINE_CAPACITY = sizeof(DemiString) - 2;
+    const uint64_t CAPACITY_MASK = ~(0xFFull << 56);
+    // Smallest capacity a heap buffer grows to.
+    const uint64_t MIN_HEAP_CAPACITY = 32;
+
+    // Header of a heap string's chars.
+    struct Buffer {
+        std::atomic<uint64_t> RefCount;
+    };
+
+    char *bytesOf(DemiString *str) {
+        return reinterpret_cast<char*>(str);
+    }
+    const char *bytesOf(const DemiString *str) {
+        return reinterpret_cast<const char*>(str);
+    }
+    bool isInline(const DemiString *str) {
+        return (str->Capacity & DEMI_STRING_KIND_MASK) == 0;
+    }
+    bool isHeap(const DemiString *str) {
+        return (str->Capacity & DEMI_STRING_KIND_MASK) == DEMI_STRING_KIND_HEAP;
+    }
+    bool isView(const DemiString *str) {
+        return (str->Capacity & DEMI_STRING_KIND_MASK) == DEMI_STRING_KIND_VIEW;
+    }
+    Buffer *bufferOf(const DemiString *str) {
+        return reinterpret_cast<Buffer*>(str->Data) - 1;
+    }
+    // User space addresses fit below the kind.
+    DemiStringOwner *ownerOf(const DemiString *str) {
+        return reinterpret_cast<DemiStringOwner*>(str->Capacity & CAPACITY_MASK);
+    }
+    uint64_t lengthOf(const DemiString *str) {
+        return isInline(str) ? (unsigned char)bytesOf(str)[sizeof(DemiString) - 1] : str->Length;
+    }
+    const char *charsOf(const DemiString *str) {
+        return isInline(str) ? bytesOf(str) : str->Data;
+    }
+    // Whether appending may write into the string's chars without anyone else seeing it.
+    bool isUnique(const DemiString *str) {
+        return isHeap(str) && bufferOf(str)->RefCount.load(std::memory_order_acquire) == 1;
+    }
+
+    void setInlineLength(DemiString *str, uint64_t length) {
+        bytesOf(str)[length] = '\0';
+        bytesOf(str)[sizeof(DemiString) - 1] = (char)length;
+    }
+
+    // Points 'str' at a new buffer referenced only by it, with room for 'capacity' chars.
+    char *allocateBuffer(DemiString *str, uint64_t capacity) {
+        Buffer *buffer = static_cast<Buffer*>(demi_alloc(sizeof(Buffer) + capacity + 1));
+        new (&buffer->RefCount) std::atomic<uint64_t>(1);
+        str->Data = reinterpret_cast<char*>(buffer + 1);
+        str->Capacity = DEMI_STRING_KIND_HEAP | capacity;
+        return str->Data;
+    }
+
+    // Builds 'lhs' followed by 'rhs' into 'result', with room for at least 'capacity' chars.
+    void build(DemiString *result, const char *lhs, uint64_t lhsLength, const char *rhs, uint64_t rhsLength, uint64_t capacity) {
+        uint64_t length = lhsLength + rhsLength;
+        DemiString built = DemiString();
+        char *chars;
+        if (capacity <= INLINE_CAPACITY) {
+            chars = bytesOf(&built);
+            setInlineLength(&built, length);
+        }
+        else {
+            chars = allocateBuffer(&built, capacity);
+            built.Length = length;
+            chars[length] = '\0';
+        }
+        memcpy(chars, lhs, lhsLength);
+        memcpy(chars + lhsLength, rhs, rhsLength);
+        *result = built;
+    }
+
+}
+
+extern "C" {
+
+    void demi_string_retain(const DemiString *str) {
+        if (isHeap(str)) {
+            bufferOf(str)->RefCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (isView(str) && ownerOf(str) != nullptr) {
+            ownerOf(str)->RefCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void demi_string_release(DemiString *str) {
+        if (isHeap(str)) {
+            Buffer *buffer = bufferOf(str);
+            if (buffer->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                buffer->RefCount.~atomic();
+                free(buffer);
+            }
+        }
+        else if (isView(str) && ownerOf(str) != nullptr) {
+            demi_string_owner_release(ownerOf(str));
+        }
+        *str = DemiString();
+    }
+
+    void demi_string_assign(DemiString *dst, const DemiString *src) {
+        if (dst == src) {
+            return;
+        }
+        demi_string_retain(src);
+        DemiString previous = *dst;
+        *dst = *src;
+        demi_string_release(&previous);
+    }
+
+    void demi_string_concat(DemiString *result, const DemiString *lhs, const DemiString *rhs) {
+        uint64_t lhsLength = lengthOf(lhs);
+        uint64_t rhsLength = lengthOf(rhs);
+        build(result, charsOf(lhs), lhsLength, charsOf(rhs), rhsLength, lhsLength + rhsLength);
+    }
+
+    void demi_string_append(DemiString *dst, const DemiString *src) {
+        uint64_t dstLength = lengthOf(dst);
+        uint64_t srcLength = lengthOf(src);
+        uint64_t length = dstLength + srcLength;
+        if (srcLength == 0) {
+            return;
+        }
+        if (isInline(dst) && length <= INLINE_CAPACITY) {
+            memcpy(bytesOf(dst) + dstLength, charsOf(src), srcLength);
+            setInlineLength(dst, length);
+            return;
+        }
+        if (isUnique(dst)) {
+            uint64_t capacity = dst->Capacity & CAPACITY_MASK;
+            if (length > capacity) { // grow geometrically so a loop of appends is linear.
+                capacity = capacity * 2 > length ? capacity * 2 : length;
+                bool appendingItself = src == dst;
+                Buffer *buffer = static_cast<Buffer*>(realloc(bufferOf(dst), sizeof(Buffer) + capacity + 1));
+                if (buffer == nullptr) {
+                    fprintf(stderr, "Out of memory growing a string to %llu bytes.\n", (unsigned long long)capacity);
+                    abort();
+                }
+                dst->Data = reinterpret_cast<char*>(buffer + 1);
+                dst->Capacity = DEMI_STRING_KIND_HEAP | capacity;
+                if (appendingItself) {
+                    src = dst;
+                }
+            }
+            memcpy(dst->Data + dstLength, charsOf(src), srcLength);
+            dst->Length = length;
+            dst->Data[length] = '\0';
+            return;
+        }
+        // inline strings that outgrew themselves, literals, views and shared buffers are copied first.
+        uint64_t capacity = dstLength * 2 > length ? dstLength * 2 : length;
+        if (capacity < MIN_HEAP_CAPACITY) {
+            capacity = MIN_HEAP_CAPACITY;
+        }
+        DemiString previous = *dst;
+        build(dst, charsOf(&previous), dstLength, charsOf(src == dst ? &previous : src), srcLength, capacity);
+        demi_string_release(&previous);
+    }
+
+    const char *demi_string_cstr(const DemiString *str, DemiString *copy) {
+        if (isView(str)) {
+            build(copy, str->Data, str->Length, "", 0, str->Length);
+            return charsOf(copy);
+        }
+        return charsOf(str);
+    }
+
+    uint64_t demi_string_length(const DemiString *str) {
+        return lengthOf(str);
+    }
+
+    const char *demi_string_data(const DemiString *str) {
+        return charsOf(str);
+    }
+
+    void demi_string_from_cstr(DemiString *result, const char *cstr) {
+        uint64_t length = cstr != nullptr ? strlen(cstr) : 0;
+        build(result, cstr, length, "", 0, length);
+    }
+
+    void demi_string_view(DemiString *result, DemiStringOwner *owner, const char *chars, uint64_t length) {
+        if (length == 0) { // nothing to keep alive.
+            *result = DemiString();
+            return;
+        }
+        owner->RefCount.fetch_add(1, std::memory_order_relaxed);
+        result->Data = const_cast<char*>(chars);
+        result->Length = length;
+        result->Capacity = DEMI_STRING_KIND_VIEW | reinterpret_cast<uint64_t>(owner);
+    }
+
+    void demi_string_owner_release(DemiStringOwner *owner) {
+        if (owner->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            owner->Destroy(owner);
+        }
+    }
+
+}
@@ -47,6 +47,25 @@ int main(int argc, char **argv) {
     //args.push_back("examples/whileloops.demi");
     //args.push_back("examples/for-loops.demi");
     //args.push_back("examples/dynamic-array.demi");
+    //args.push_back("examples/reduction.demi");
+    //args.push_back("examples/spawn.demi");
+    //args.push_back("examples/atomics.demi");
+    //args.push_back("examples/structs.demi");
+    //args.push_back("examples/soa.demi");
+    //args.push_back("examples/methods.demi");
+    //args.push_back("examples/arena.demi");
+    //args.push_back("examples/escape.demi");
+    //args.push_back("examples/gc.demi"); // with "-gc"
+    //args.push_back("examples/string-builder.demi");
+    //args.push_back("examples/literals.demi");
+    //args.push_back("examples/output.demi");
+    //args.push_back("examples/files.demi");
+    //args.push_back("examples/folding.demi");
+    //args.push_back("examples/const-func.demi");
+    //args.push_back("examples/generics.demi");
+    //args.push_back("examples/overloading.demi");
+    //args.push_back("examples/type-checking.demi");
+    //args.push_back("examples/shadowing.demi");
 
 
     //args.push_back("examples/tests/arithmetic.demi");